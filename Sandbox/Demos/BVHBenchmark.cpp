@@ -0,0 +1,209 @@
+#include "Demos/Common.h"
+
+#include <random>
+
+namespace SGL::Demo {
+
+    struct BenchmarkTriangle : sgl::Utility::BVHPrimitive {
+        glm::vec3 v0, v1, v2;
+
+        sgl::Utility::BoundingBoxAABB getBound() const noexcept override {
+            sgl::Utility::BoundingBoxAABB bound;
+            bound.append(v0);
+            bound.append(v1);
+            bound.append(v2);
+            return bound;
+        }
+
+        bool intersect(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, float* t) const noexcept override {
+            return sgl::Utility::intersectTriangle(rayOrigin, rayDir, v0, v1, v2, t);
+        }
+    };
+
+    struct BenchmarkResult {
+        std::string name;
+        double mraysPerSecond = 0.0;
+        uint32_t hitCount = 0;
+    };
+
+    struct BVHBenchmarkData {
+        int triangleCount = 200000;
+        int rayCount = 500000;
+        std::vector<BenchmarkTriangle> triangles;
+        std::vector<std::pair<glm::vec3, glm::vec3>> rays;
+        sgl::Utility::BVHBuildStats buildStats;
+        std::vector<BenchmarkResult> results;
+        uint32_t mismatchCount = 0;
+    };
+
+    template<typename Accel>
+    static BenchmarkResult runTraversal(std::string const& name, BVHBenchmarkData const* userData, Accel const& accel, std::vector<float>& hits) noexcept {
+        BenchmarkResult result;
+        result.name = name;
+        hits.assign(userData->rays.size(), INFINITY);
+
+        sgl::Timer timer;
+        for (size_t i = 0; i < userData->rays.size(); ++i) {
+            auto const& ray = userData->rays[i];
+            if (sgl::Utility::intersectBVH(ray.first, ray.second, accel, &hits[i])) {
+                ++result.hitCount;
+            }
+        }
+        timer.update();
+        result.mraysPerSecond = userData->rays.size() / timer.getDeltaTime() * 1e-6;
+        return result;
+    }
+
+    static void runBenchmark(BVHBenchmarkData* userData) noexcept {
+        userData->triangleCount = std::max(userData->triangleCount, 1);
+        userData->rayCount = std::max(userData->rayCount, 1);
+
+        // incoherent rays through a random triangle soup
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        userData->triangles.resize(userData->triangleCount);
+        for (auto& tri : userData->triangles) {
+            glm::vec3 center = glm::vec3(dist(rng), dist(rng), dist(rng)) * 10.0f;
+            tri.v0 = center + glm::vec3(dist(rng), dist(rng), dist(rng)) * 0.2f;
+            tri.v1 = center + glm::vec3(dist(rng), dist(rng), dist(rng)) * 0.2f;
+            tri.v2 = center + glm::vec3(dist(rng), dist(rng), dist(rng)) * 0.2f;
+        }
+        userData->rays.resize(userData->rayCount);
+        for (auto& ray : userData->rays) {
+            ray.first = glm::vec3(dist(rng), dist(rng), dist(rng)) * 12.0f;
+            ray.second = glm::normalize(glm::vec3(dist(rng), dist(rng), dist(rng)));
+        }
+
+        std::vector<sgl::Utility::BVHPrimitive*> prims(userData->triangles.size());
+        for (size_t i = 0; i < prims.size(); ++i) {
+            prims[i] = &userData->triangles[i];
+        }
+
+        auto bvh = sgl::Utility::BVH::build(prims);
+        auto flat = sgl::Utility::FlatBVH::flatten(*bvh);
+        auto wide = sgl::Utility::BVH4::collapse(*bvh);
+
+        std::vector<sgl::Utility::BVHTriangle> typedTriangles(userData->triangles.size());
+        for (size_t i = 0; i < typedTriangles.size(); ++i) {
+            auto const& tri = userData->triangles[i];
+            typedTriangles[i] = { tri.v0, tri.v1, tri.v2 };
+        }
+        auto typed = sgl::Utility::TypedBVH<sgl::Utility::BVHTriangle>::build(typedTriangles);
+
+        std::vector<glm::vec3> vertices;
+        vertices.reserve(userData->triangles.size() * 3);
+        for (auto const& tri : userData->triangles) {
+            vertices.insert(vertices.end(), { tri.v0, tri.v1, tri.v2 });
+        }
+        auto packed = sgl::Utility::TriangleBVH::build(vertices);
+        userData->buildStats = bvh->stats;
+
+        std::vector<float> reference, hits;
+        userData->results.clear();
+        userData->results.push_back(runTraversal("Binary", userData, *bvh, reference));
+        userData->mismatchCount = 0;
+        auto compare = [&]() {
+            for (size_t i = 0; i < hits.size(); ++i) {
+                if (hits[i] != reference[i]) ++userData->mismatchCount;
+            }
+        };
+        userData->results.push_back(runTraversal("Flat", userData, *flat, hits));
+        compare();
+        userData->results.push_back(runTraversal("BVH4", userData, *wide, hits));
+        compare();
+        userData->results.push_back(runTraversal("Typed", userData, *typed, hits));
+        compare();
+        userData->results.push_back(runTraversal("Packed", userData, *packed, hits));
+        compare();
+
+        {
+            std::vector<sgl::Utility::Ray> streamRays(userData->rays.size());
+            for (size_t i = 0; i < streamRays.size(); ++i) {
+                streamRays[i] = { userData->rays[i].first, userData->rays[i].second };
+            }
+            // single threaded so the row compares with the others
+            sgl::Utility::RayStreamOption streamOption;
+            streamOption.parallel = false;
+            std::vector<sgl::Utility::RayHit> streamHits;
+
+            BenchmarkResult result;
+            result.name = "Stream";
+            sgl::Timer timer;
+            sgl::Utility::intersectStream(*packed, streamRays, streamHits, streamOption);
+            timer.update();
+            result.mraysPerSecond = streamRays.size() / timer.getDeltaTime() * 1e-6;
+            for (size_t i = 0; i < streamHits.size(); ++i) {
+                hits[i] = streamHits[i].t;
+                if (streamHits[i].isHit()) ++result.hitCount;
+            }
+            userData->results.push_back(result);
+            compare();
+        }
+
+        for (auto const& result : userData->results) {
+            SGL_LOG_INFO("{0}: {1:.2f} Mrays/s, {2} hits", result.name, result.mraysPerSecond, result.hitCount);
+        }
+        if (userData->mismatchCount > 0) {
+            SGL_LOG_WARN("{0} rays differ from the binary layout", userData->mismatchCount);
+        }
+    }
+
+    BVHBenchmark::BVHBenchmark() noexcept {
+        sgl::WindowOption opt = {};
+        opt.name = "BVHBenchmark";
+        opt.width = 800;
+        opt.height = 600;
+        opt.vsync = true;
+        opt.fullscreen = false;
+        opt.resizable = true;
+
+        createWindow(opt);
+
+        window->windowData.framebufferSizeCallbacks.push_back(
+            [](int width, int height) {
+                glViewport(0, 0, width, height);
+            });
+
+        data = new BVHBenchmarkData();
+    }
+
+    BVHBenchmark::~BVHBenchmark() noexcept {
+        auto userData = (BVHBenchmarkData*)data;
+        delete userData;
+    }
+
+    void BVHBenchmark::init() noexcept {
+        auto userData = (BVHBenchmarkData*)data;
+        runBenchmark(userData);
+    }
+
+    void BVHBenchmark::update(double deltaTime) noexcept {
+        auto userData = (BVHBenchmarkData*)data;
+
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        ImGui::Begin("BVH Benchmark");
+        ImGui::InputInt("Triangles", &userData->triangleCount);
+        ImGui::InputInt("Rays", &userData->rayCount);
+        if (ImGui::Button("Run")) {
+            runBenchmark(userData);
+        }
+        ImGui::Separator();
+        ImGui::Text("Build: %.3f s, SAH cost %.2f, %u nodes, depth %u",
+            userData->buildStats.buildTime,
+            userData->buildStats.sahCost,
+            userData->buildStats.nodeCount,
+            userData->buildStats.maxDepth);
+        for (auto const& result : userData->results) {
+            ImGui::Text("%-8s %8.2f Mrays/s  %u hits", result.name.c_str(), result.mraysPerSecond, result.hitCount);
+        }
+        ImGui::Text("Mismatches: %u", userData->mismatchCount);
+        ImGui::End();
+    }
+
+    void BVHBenchmark::fixedUpdate() noexcept {
+
+    }
+
+}
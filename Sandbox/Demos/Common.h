@@ -29,5 +29,6 @@ namespace SGL::Demo {
     REGISTER_DEMO(HelloTriangle);
     REGISTER_DEMO(GeometryShader);
     REGISTER_DEMO(NormalVector);
+    REGISTER_DEMO(BVHBenchmark);
 
 }
@@ -7,6 +7,7 @@ int main() {
     //auto app = demo::HelloTriangle();
     //auto app = demo::GeometryShader();
     auto app = demo::NormalVector();
+    //auto app = demo::BVHBenchmark();
     app.run();
 
     return 0;
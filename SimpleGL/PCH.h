@@ -13,6 +13,7 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <array>
 #include <stack>
 #include <unordered_map>
 #include <unordered_set>
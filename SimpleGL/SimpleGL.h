@@ -6,6 +6,8 @@
 #include "SimpleGL/Core/Log.h"
 #include "SimpleGL/Core/IO.h"
 #include "SimpleGL/Core/Timer.h"
+#include "SimpleGL/Core/ThreadPool.h"
+#include "SimpleGL/Core/MappedFile.h"
 #include "SimpleGL/Core/Maths.h"
 
 #include "SimpleGL/Core/Window.h"
@@ -15,11 +17,28 @@
 #include "SimpleGL/Core/Buffer.h"
 #include "SimpleGL/Core/Texture.h"
 #include "SimpleGL/Core/Mesh.h"
+#include "SimpleGL/Core/GeometryPool.h"
 #include "SimpleGL/Core/Model.h"
+#include "SimpleGL/Core/ModelCache.h"
 
 #include "SimpleGL/Core/ImGuiHelper.h"
 
 #include "SimpleGL/Utility/BVH.h"
+#include "SimpleGL/Utility/BVHCache.h"
+#include "SimpleGL/Utility/WideBVH.h"
+#include "SimpleGL/Utility/TwoLevelBVH.h"
+#include "SimpleGL/Utility/TriangleBVH.h"
+#include "SimpleGL/Utility/TypedBVH.h"
+#include "SimpleGL/Utility/RayQuery.h"
+#include "SimpleGL/Utility/Culling.h"
+#include "SimpleGL/Utility/DistanceQuery.h"
+#include "SimpleGL/Utility/CollisionQuery.h"
+#include "SimpleGL/Utility/GPUBVH.h"
+#include "SimpleGL/Utility/GPUBVHBuilder.h"
+#include "SimpleGL/Utility/PathTracer.h"
+#include "SimpleGL/Utility/AOBaker.h"
+#include "SimpleGL/Utility/MeshOptimizer.h"
+#include "SimpleGL/Utility/VertexPacking.h"
 #include "SimpleGL/Utility/Intersect.h"
 #include "SimpleGL/Utility/Camera.h"
 #include "SimpleGL/Utility/CameraController.h"
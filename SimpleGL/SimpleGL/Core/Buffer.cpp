@@ -22,6 +22,19 @@ namespace SGL {
         glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, rOffset, wOffset, size);
     }
 
+    uint32_t Buffer::getSize() const noexcept {
+        GLint size = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, handle);
+        glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+        return static_cast<uint32_t>(size);
+    }
+
+    void Buffer::getData(void* data, uint32_t offset, uint32_t size) const noexcept {
+        // the copy binding leaves the element buffer of the bound vertex array alone
+        glBindBuffer(GL_COPY_READ_BUFFER, handle);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, offset, size, data);
+    }
+
     VertexBufferLayout::VertexBufferLayout(std::initializer_list<BufferElementItem> const& list) {
         std::vector temp(list);
         for (auto& element : temp) {
@@ -61,33 +74,69 @@ namespace SGL {
         glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
+    /*
+    *   Integer types go through glVertexAttribIPointer so the shader sees the integers, not integers converted to floats
+    */
+    static void setVertexAttribute(unsigned int location, BufferElementItem const& element, uint32_t stride) noexcept {
+        void const* offset = (void*)(size_t)element.offset;
+        switch (element.type) {
+        case DataType::Float:
+            glVertexAttribPointer(location, 1, GL_FLOAT, GL_FALSE, stride, offset); break;
+        case DataType::Float2:
+            glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, stride, offset); break;
+        case DataType::Float3:
+            glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride, offset); break;
+        case DataType::Float4:
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, offset); break;
+        case DataType::Int:
+            glVertexAttribIPointer(location, 1, GL_INT, stride, offset); break;
+        case DataType::Int2:
+            glVertexAttribIPointer(location, 2, GL_INT, stride, offset); break;
+        case DataType::Int3:
+            glVertexAttribIPointer(location, 3, GL_INT, stride, offset); break;
+        case DataType::Int4:
+            glVertexAttribIPointer(location, 4, GL_INT, stride, offset); break;
+        case DataType::Bool:
+            glVertexAttribIPointer(location, 1, GL_UNSIGNED_BYTE, stride, offset); break;
+        case DataType::UInt:
+            glVertexAttribIPointer(location, 1, GL_UNSIGNED_INT, stride, offset); break;
+        case DataType::UInt2:
+            glVertexAttribIPointer(location, 2, GL_UNSIGNED_INT, stride, offset); break;
+        case DataType::UInt3:
+            glVertexAttribIPointer(location, 3, GL_UNSIGNED_INT, stride, offset); break;
+        case DataType::UInt4:
+            glVertexAttribIPointer(location, 4, GL_UNSIGNED_INT, stride, offset); break;
+        case DataType::UByte4:
+            glVertexAttribIPointer(location, 4, GL_UNSIGNED_BYTE, stride, offset); break;
+        case DataType::Byte4N:
+            glVertexAttribPointer(location, 4, GL_BYTE, GL_TRUE, stride, offset); break;
+        case DataType::UByte4N:
+            glVertexAttribPointer(location, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, offset); break;
+        case DataType::Short2N:
+            glVertexAttribPointer(location, 2, GL_SHORT, GL_TRUE, stride, offset); break;
+        case DataType::Short4N:
+            glVertexAttribPointer(location, 4, GL_SHORT, GL_TRUE, stride, offset); break;
+        case DataType::UShort2N:
+            glVertexAttribPointer(location, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, offset); break;
+        case DataType::UShort4N:
+            glVertexAttribPointer(location, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, offset); break;
+        case DataType::Half2:
+            glVertexAttribPointer(location, 2, GL_HALF_FLOAT, GL_FALSE, stride, offset); break;
+        case DataType::Half4:
+            glVertexAttribPointer(location, 4, GL_HALF_FLOAT, GL_FALSE, stride, offset); break;
+        case DataType::Int2101010N:
+            glVertexAttribPointer(location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, offset); break;
+        default:
+            break;
+        }
+    }
+
     void VertexBuffer::bindAttributes() const noexcept {
         glBindBuffer(GL_ARRAY_BUFFER, handle);
         unsigned int location = 0;
         for (auto const& element : layout.elements) {
             glEnableVertexAttribArray(location);
-            switch (element.type) {
-            case DataType::Float:
-                glVertexAttribPointer(location, 1, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Float2:
-                glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Float3:
-                glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Float4:
-                glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Int:
-                glVertexAttribPointer(location, 1, GL_INT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Int2:
-                glVertexAttribPointer(location, 2, GL_INT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Int3:
-                glVertexAttribPointer(location, 3, GL_INT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Int4:
-                glVertexAttribPointer(location, 4, GL_INT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Bool:
-                glVertexAttribPointer(location, 1, GL_BOOL, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            default:
-                break;
-            }
+            setVertexAttribute(location, element, layout.stride);
             location++;
         }
         glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -98,29 +147,7 @@ namespace SGL {
         unsigned int location = start;
         for (auto const& element : layout.elements) {
             glEnableVertexAttribArray(location);
-            switch (element.type)
-            {
-            case DataType::Float:
-                glVertexAttribPointer(location, 1, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Float2:
-                glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Float3:
-                glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Float4:
-                glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Int:
-                glVertexAttribPointer(location, 1, GL_INT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Int2:
-                glVertexAttribPointer(location, 2, GL_INT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Int3:
-                glVertexAttribPointer(location, 3, GL_INT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Int4:
-                glVertexAttribPointer(location, 4, GL_INT, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            case DataType::Bool:
-                glVertexAttribPointer(location, 1, GL_BOOL, GL_FALSE, layout.stride, (void*)(size_t)element.offset); break;
-            default:
-                break;
-            }
+            setVertexAttribute(location, element, layout.stride);
             glVertexAttribDivisor(location, divisor);
             location++;
         }
@@ -128,14 +155,21 @@ namespace SGL {
     }
 
     ElementBuffer::ElementBuffer(void* data, uint32_t size, BufferUsageType behavior) {
+        // whole words, so storage buffer views of an odd number of 16 bit indices stay in bounds
+        uint32_t const allocated = (size + 3) / 4 * 4;
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, handle);
         switch (behavior) {
         case BufferUsageType::Static:
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, GL_STATIC_DRAW); break;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, allocated, allocated == size ? data : nullptr, GL_STATIC_DRAW); break;
         case BufferUsageType::Dynamic:
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, GL_DYNAMIC_DRAW); break;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, allocated, allocated == size ? data : nullptr, GL_DYNAMIC_DRAW); break;
         case BufferUsageType::Stream:
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, GL_STREAM_DRAW); break;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, allocated, allocated == size ? data : nullptr, GL_STREAM_DRAW); break;
+        }
+        if (allocated != size && data) {
+            uint32_t const zero = 0;
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, size, data);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, size, allocated - size, &zero);
         }
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
@@ -227,6 +261,31 @@ namespace SGL {
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     }
 
+    IndirectBuffer::IndirectBuffer(void* data, uint32_t _size, BufferUsageType behavior)
+        : size(_size)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, handle);
+        switch (behavior) {
+        case BufferUsageType::Static:
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, size, data, GL_STATIC_DRAW); break;
+        case BufferUsageType::Dynamic:
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, size, data, GL_DYNAMIC_DRAW); break;
+        case BufferUsageType::Stream:
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, size, data, GL_STREAM_DRAW); break;
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    void IndirectBuffer::bind() const noexcept {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, handle);
+    }
+
+    void IndirectBuffer::update(void* data, uint32_t offset, uint32_t _size) const noexcept {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, handle);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offset, _size, data);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
     FrameBufferLayout::FrameBufferLayout(std::initializer_list<AttachmentElement> const& list)
         : elements(list) {}
 
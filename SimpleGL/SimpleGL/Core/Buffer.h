@@ -29,6 +29,12 @@ namespace SGL {
 
         void copyTo(Buffer const& other, uint32_t rOffset, uint32_t wOffset, uint32_t size) const noexcept;
 
+        uint32_t getSize() const noexcept;
+        /*
+        *   Read size bytes at offset back to the CPU, waits for the GPU to finish writing the buffer
+        */
+        void getData(void* data, uint32_t offset, uint32_t size) const noexcept;
+
     };
 
     struct BufferElementItem {
@@ -157,6 +163,35 @@ namespace SGL {
 
     };
 
+    /*
+    *   Commands of the indirect draw calls, bound to GL_DRAW_INDIRECT_BUFFER
+    */
+    struct IndirectBuffer : public Buffer {
+
+        uint32_t size;
+
+        IndirectBuffer(void* data, uint32_t _size, BufferUsageType behavior = BufferUsageType::Static);
+
+        IndirectBuffer(IndirectBuffer const&) = delete;
+        IndirectBuffer(IndirectBuffer&& other) noexcept {
+            size = other.size;
+            handle = other.handle;
+            other.handle = 0;
+        }
+
+        IndirectBuffer& operator=(IndirectBuffer const& other) = delete;
+        IndirectBuffer& operator=(IndirectBuffer&& other) noexcept {
+            size = other.size;
+            handle = other.handle;
+            other.handle = 0;
+            return *this;
+        }
+
+        void bind() const noexcept;
+        void update(void* data, uint32_t offset, uint32_t _size) const noexcept;
+
+    };
+
     struct AttachmentElement {
 
         AttachmentType type;
@@ -0,0 +1,175 @@
+#include "PCH.h"
+
+#include "SimpleGL/Core/GeometryPool.h"
+#include "SimpleGL/Core/Mesh.h"
+#include "SimpleGL/Core/Shader.h"
+#include "glad/glad.h"
+
+namespace SGL {
+
+    static char const* const drawDataSource = R"GLSL(
+#ifndef SGL_GEOMETRY_POOL_GLSL
+#define SGL_GEOMETRY_POOL_GLSL
+
+#if __VERSION__ < 460
+#extension GL_ARB_shader_draw_parameters : require
+#define SGL_DRAW_ID gl_DrawIDARB
+#else
+#define SGL_DRAW_ID gl_DrawID
+#endif
+
+#ifndef SGL_DRAW_DATA_BINDING
+#define SGL_DRAW_DATA_BINDING 7
+#endif
+
+// GeometryDrawData
+struct SGLDraw {
+    vec3 boundMin;
+    uint mesh;
+    vec3 boundMax;
+    uint node;
+};
+
+layout(std430, binding = SGL_DRAW_DATA_BINDING) readonly buffer SGLDrawData { SGLDraw sglDraws[]; };
+
+// first command of the current multi draw
+uniform int uDrawOffset;
+
+SGLDraw sglGetDraw(int drawID) {
+    return sglDraws[uDrawOffset + drawID];
+}
+
+#endif
+)GLSL";
+
+    static_assert(sizeof(GeometryDrawData) == 32 && offsetof(GeometryDrawData, boundMax) == 16, "GeometryDrawData should match SGLDraw");
+    static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand should match the GL command");
+
+    static inline GLenum getGLPrimitiveType(PrimitiveType type) noexcept {
+        switch (type) {
+        case PrimitiveType::Points:                 return GL_POINTS;
+        case PrimitiveType::LineStrip:              return GL_LINE_STRIP;
+        case PrimitiveType::Lines:                  return GL_LINES;
+        case PrimitiveType::LineStripAdjacency:     return GL_LINE_STRIP_ADJACENCY;
+        case PrimitiveType::LinesAdjacency:         return GL_LINES_ADJACENCY;
+        case PrimitiveType::TriangleStrip:          return GL_TRIANGLE_STRIP;
+        case PrimitiveType::TriangleFan:            return GL_TRIANGLE_FAN;
+        case PrimitiveType::Triangles:              return GL_TRIANGLES;
+        case PrimitiveType::TriangleStripAdjacency: return GL_TRIANGLE_STRIP_ADJACENCY;
+        case PrimitiveType::TrianglesAdjacency:     return GL_TRIANGLES_ADJACENCY;
+        case PrimitiveType::Patches:                return GL_PATCHES;
+        }
+        return GL_TRIANGLES;
+    }
+
+    GeometryPool::~GeometryPool() {
+        if (handle == 0) return;
+        glDeleteVertexArrays(1, &handle);
+    }
+
+    bool GeometryPool::isCompatible(Mesh const& mesh, Mesh const& reference) noexcept {
+        auto const& a = mesh.vertexBuffer.layout;
+        auto const& b = reference.vertexBuffer.layout;
+        if (mesh.type != reference.type || a.stride != b.stride || a.elements.size() != b.elements.size()) return false;
+        for (size_t i = 0; i < a.elements.size(); ++i) {
+            if (a.elements[i].type != b.elements[i].type || a.elements[i].offset != b.elements[i].offset) return false;
+        }
+        return true;
+    }
+
+    std::unique_ptr<GeometryPool> GeometryPool::build(std::vector<Mesh const*> const& meshes) noexcept {
+        if (meshes.empty()) return nullptr;
+        addShaderInclude();
+
+        auto pool = std::make_unique<GeometryPool>();
+        pool->meshes = meshes;
+        pool->ranges.resize(meshes.size());
+        pool->type = meshes[0]->type;
+        pool->indexType = IndexType::UInt16;
+        uint32_t const stride = meshes[0]->vertexBuffer.layout.stride;
+
+        uint64_t vertexCount = 0;
+        uint64_t indexCount = 0;
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            if (!isCompatible(*meshes[i], *meshes[0])) {
+                SGL_LOG_ERROR("GeometryPool: mesh {0} has a different vertex layout or primitive type", i);
+                return nullptr;
+            }
+            auto& range = pool->ranges[i];
+            range.vertexCount = meshes[i]->vertexBuffer.getSize() / stride;
+            range.indexCount = meshes[i]->elementCount;
+            range.baseVertex = static_cast<int32_t>(std::min<uint64_t>(vertexCount, std::numeric_limits<int32_t>::max()));
+            range.firstIndex = static_cast<uint32_t>(std::min<uint64_t>(indexCount, std::numeric_limits<uint32_t>::max()));
+            vertexCount += range.vertexCount;
+            indexCount += range.indexCount;
+            if (meshes[i]->indexType == IndexType::UInt32) pool->indexType = IndexType::UInt32;
+        }
+        uint32_t const indexSize = getIndexTypeSize(pool->indexType);
+        if (vertexCount * stride > std::numeric_limits<uint32_t>::max() || indexCount * indexSize > std::numeric_limits<uint32_t>::max()
+            || vertexCount > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) {
+            SGL_LOG_ERROR("GeometryPool: {0} vertices and {1} indices do not fit a buffer", vertexCount, indexCount);
+            return nullptr;
+        }
+
+        pool->vertexBuffer = std::make_unique<VertexBuffer>(nullptr, static_cast<uint32_t>(vertexCount * stride), meshes[0]->vertexBuffer.layout);
+        pool->elementBuffer = std::make_unique<ElementBuffer>(nullptr, static_cast<uint32_t>(indexCount * indexSize));
+        std::vector<uint16_t> shortIndices;
+        std::vector<uint32_t> longIndices;
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            auto const& range = pool->ranges[i];
+            meshes[i]->vertexBuffer.copyTo(*pool->vertexBuffer, 0, range.baseVertex * stride, range.vertexCount * stride);
+            if (meshes[i]->indexType == pool->indexType) {
+                meshes[i]->elementBuffer.copyTo(*pool->elementBuffer, 0, range.firstIndex * indexSize, range.indexCount * indexSize);
+                continue;
+            }
+            // 16 bit indices of a 32 bit pool go through the CPU
+            shortIndices.resize(range.indexCount);
+            meshes[i]->elementBuffer.getData(shortIndices.data(), 0, range.indexCount * sizeof(uint16_t));
+            longIndices.assign(shortIndices.begin(), shortIndices.end());
+            glBindBuffer(GL_COPY_WRITE_BUFFER, pool->elementBuffer->handle);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstIndex * indexSize, range.indexCount * indexSize, longIndices.data());
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+
+        glGenVertexArrays(1, &pool->handle);
+        glBindVertexArray(pool->handle);
+        glBindBuffer(GL_ARRAY_BUFFER, pool->vertexBuffer->handle);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool->elementBuffer->handle);
+        pool->vertexBuffer->bindAttributes();
+        glBindVertexArray(0);
+        return pool;
+    }
+
+    void GeometryPool::addShaderInclude() noexcept {
+        static bool const added = (Shader::addInclude(ShaderInclude, drawDataSource), true);
+        (void)added;
+    }
+
+    char const* GeometryPool::getShaderSource() noexcept {
+        return drawDataSource;
+    }
+
+    DrawElementsIndirectCommand GeometryPool::getCommand(uint32_t range, uint32_t baseInstance, uint32_t instanceCount) const noexcept {
+        DrawElementsIndirectCommand command;
+        command.count = ranges[range].indexCount;
+        command.instanceCount = instanceCount;
+        command.firstIndex = ranges[range].firstIndex;
+        command.baseVertex = ranges[range].baseVertex;
+        command.baseInstance = baseInstance;
+        return command;
+    }
+
+    void GeometryPool::bind() const noexcept {
+        glBindVertexArray(handle);
+    }
+
+    void GeometryPool::multiDraw(uint32_t first, uint32_t count) const noexcept {
+        glMultiDrawElementsIndirect(
+            getGLPrimitiveType(type),
+            indexType == IndexType::UInt16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+            (void*)(size_t)(first * sizeof(DrawElementsIndirectCommand)),
+            count,
+            sizeof(DrawElementsIndirectCommand));
+    }
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "SimpleGL/Core/Types.h"
+#include "SimpleGL/Core/Buffer.h"
+#include "glm/glm.hpp"
+
+namespace SGL {
+
+    struct Mesh;
+
+    /*
+    *   Command of glMultiDrawElementsIndirect, the layout is fixed by GL
+    */
+    struct DrawElementsIndirectCommand {
+        uint32_t count = 0;
+        uint32_t instanceCount = 1;
+        uint32_t firstIndex = 0;
+        int32_t baseVertex = 0;
+        uint32_t baseInstance = 0;
+    };
+
+    /*
+    *   Per draw data of a multi draw, std430 layout of SGLDraw in the shader include
+    *   mesh and node are free for the caller, Model puts the index in its drawList and the index of the node there
+    */
+    struct GeometryDrawData {
+        glm::vec3 boundMin = glm::vec3(0.0f);
+        uint32_t mesh = 0;
+        glm::vec3 boundMax = glm::vec3(0.0f);
+        uint32_t node = 0;
+    };
+
+    /*
+    *   Meshes of one vertex layout and primitive type copied into a single vertex and index buffer,
+    *   each one drawn from its range by base vertex, so a whole set of them goes out in one glMultiDrawElementsIndirect
+    *   The copies are made on the GPU, the meshes keep their own buffers for per mesh draws, BVH builds and cache files
+    *
+    *   Shaders read the data of the current draw through
+    *       #include "SimpleGL/GeometryPool.glsl"
+    *   which declares sglGetDraw(), the GeometryDrawData of the command being drawn, bound to SGL_DRAW_DATA_BINDING, 7 unless defined before the include
+    *   Include it right after #version and before any other include or declaration, below GLSL 4.60 it enables
+    *   ARB_shader_draw_parameters and strict compilers reject an #extension after code
+    *   Only vertex shaders have a draw id, they call sglGetDraw(SGL_DRAW_ID) and pass on what later stages need
+    *   gl_DrawID restarts at every multi draw, so the index of its first command is passed in the uniform uDrawOffset
+    */
+    struct GeometryPool {
+
+        static constexpr char const* ShaderInclude = "SimpleGL/GeometryPool.glsl";
+        static constexpr uint32_t DefaultDrawDataBinding = 7;
+
+        struct Range {
+            uint32_t firstIndex = 0;
+            uint32_t indexCount = 0;
+            int32_t baseVertex = 0;
+            uint32_t vertexCount = 0;
+        };
+
+        unsigned int handle = 0;
+        std::unique_ptr<VertexBuffer> vertexBuffer;
+        std::unique_ptr<ElementBuffer> elementBuffer;
+        PrimitiveType type = PrimitiveType::Triangles;
+        /*
+        *   16 bit only if every mesh has 16 bit indices, the others are widened
+        */
+        IndexType indexType = IndexType::UInt32;
+        std::vector<Mesh const*> meshes;
+        std::vector<Range> ranges;
+
+        GeometryPool() = default;
+        ~GeometryPool();
+
+        GeometryPool(GeometryPool const&) = delete;
+        GeometryPool(GeometryPool&& other) = delete;
+
+        GeometryPool& operator=(GeometryPool const&) = delete;
+        GeometryPool& operator=(GeometryPool&& other) = delete;
+
+        /*
+        *   Meshes of the same model or of a whole scene, range i belongs to meshes[i]
+        *   Fails if the meshes do not share a layout and primitive type or exceed the 4GB a buffer can address
+        */
+        static std::unique_ptr<GeometryPool> build(std::vector<Mesh const*> const& meshes) noexcept;
+
+        /*
+        *   Whether a mesh can join a pool of reference, the same vertex layout and primitive type
+        */
+        static bool isCompatible(Mesh const& mesh, Mesh const& reference) noexcept;
+
+        /*
+        *   Registers the shader source with Shader::addInclude, needed only for shaders loaded before the first build
+        */
+        static void addShaderInclude() noexcept;
+        static char const* getShaderSource() noexcept;
+
+        DrawElementsIndirectCommand getCommand(uint32_t range, uint32_t baseInstance = 0, uint32_t instanceCount = 1) const noexcept;
+
+        void bind() const noexcept;
+        /*
+        *   count commands from first on of the bound GL_DRAW_INDIRECT_BUFFER
+        */
+        void multiDraw(uint32_t first, uint32_t count) const noexcept;
+
+    };
+
+}
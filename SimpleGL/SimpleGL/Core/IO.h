@@ -4,6 +4,7 @@
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <vector>
 
 #include "SimpleGL/Core/Log.h"
 
@@ -42,7 +43,7 @@ namespace SGL {
     }
 
     inline auto writeFile(Filepath const& path, void* data, size_t size) noexcept -> bool {
-        std::ofstream ofs(path.string().c_str(), std::ifstream::out);
+        std::ofstream ofs(path.string().c_str(), std::ofstream::out | std::ofstream::binary);
         if (ofs.is_open()) {
             ofs.write((char*)data, size);
             ofs.close();
@@ -54,6 +55,24 @@ namespace SGL {
         return false;
     }
 
+    /*
+    *   FNV-1a, for keys of on-disk caches, chain calls by passing the previous hash
+    */
+    inline auto hashBytes(void const* data, size_t size, uint64_t hash = 14695981039346656037ULL) noexcept -> uint64_t {
+        auto bytes = static_cast<uint8_t const*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    template<typename T>
+    inline auto hashArray(std::vector<T> const& data, uint64_t hash = 14695981039346656037ULL) noexcept -> uint64_t {
+        uint64_t const count = data.size();
+        hash = hashBytes(&count, sizeof(count), hash);
+        return hashBytes(data.data(), data.size() * sizeof(T), hash);
+    }
+
 #pragma region Mouse Button Codes
     #define BUTTON_PRESSED      GLFW_PRESS
     #define BUTTON_RELEASED     GLFW_RELEASE
@@ -0,0 +1,61 @@
+#include "PCH.h"
+
+#include "SimpleGL/Core/MappedFile.h"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace SGL {
+
+    MappedFile::~MappedFile() noexcept {
+        if (!data) return;
+#if defined(_WIN32)
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<void*>(data), size);
+#endif
+    }
+
+    std::unique_ptr<MappedFile> MappedFile::open(Filepath const& path) noexcept {
+        void* view = nullptr;
+        size_t size = 0;
+#if defined(_WIN32)
+        HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return nullptr;
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+            // the view keeps the mapping alive, so both handles can be closed right away
+            HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                size = static_cast<size_t>(fileSize.QuadPart);
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#else
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) return nullptr;
+        struct stat fileStat;
+        if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0) {
+            size = static_cast<size_t>(fileStat.st_size);
+            view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (view == MAP_FAILED) view = nullptr;
+        }
+        ::close(file);
+#endif
+        if (!view) {
+            SGL_LOG_ERROR("Failed to map file: {0}", path.string());
+            return nullptr;
+        }
+        auto mapped = std::make_unique<MappedFile>();
+        mapped->data = view;
+        mapped->size = size;
+        return mapped;
+    }
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "SimpleGL/Core/IO.h"
+
+namespace SGL {
+
+    /*
+    *   Read only mapping of a whole file, pages are read from disk on first access and shared with the file cache
+    */
+    struct MappedFile {
+
+        void const* data = nullptr;
+        size_t size = 0;
+
+        MappedFile() = default;
+        ~MappedFile() noexcept;
+
+        MappedFile(MappedFile const&) = delete;
+        MappedFile(MappedFile&& other) = delete;
+
+        MappedFile& operator=(MappedFile const&) = delete;
+        MappedFile& operator=(MappedFile&& other) = delete;
+
+        /*
+        *   Returns nullptr if the file cannot be opened or is empty
+        */
+        static std::unique_ptr<MappedFile> open(Filepath const& path) noexcept;
+
+    };
+
+}
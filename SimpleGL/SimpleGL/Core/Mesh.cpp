@@ -1,15 +1,17 @@
 #include "PCH.h"
 
 #include "SimpleGL/Core/Mesh.h"
+#include "SimpleGL/Utility/Intersect.h"
 #include "glad/glad.h"
 
 namespace SGL {
 
-    Mesh::Mesh(float* vdata, uint32_t vsize, VertexBufferLayout const& layout, uint32_t* idata, uint32_t isize, PrimitiveType _type)
-        : elementCount(isize / sizeof(uint32_t))
+    Mesh::Mesh(void* vdata, uint32_t vsize, VertexBufferLayout const& layout, void* idata, uint32_t isize, PrimitiveType _type, IndexType _indexType)
+        : elementCount(isize / getIndexTypeSize(_indexType))
         , vertexBuffer(vdata, vsize, layout)
         , elementBuffer(idata, isize)
         , type(_type)
+        , indexType(_indexType)
     {
         glGenVertexArrays(1, &handle);
         glBindVertexArray(handle);
@@ -20,34 +22,54 @@ namespace SGL {
         glBindVertexArray(0);
     }
 
+    bool Mesh::raycast(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        float* t,
+        uint32_t* triangle,
+        glm::vec2* barycentric) const noexcept {
+        if (type != PrimitiveType::Triangles || indices.size() < 3) return false;
+        std::call_once(*bvhBuilt, [this]() {
+            if (bvh) return;
+            std::vector<glm::vec3> vertices(indices.size() / 3 * 3);
+            for (size_t i = 0; i < vertices.size(); ++i) {
+                vertices[i] = positions[indices[i]];
+            }
+            bvh = Utility::TriangleBVH::build(vertices);
+        });
+        if (!bvh) return false;
+        return Utility::intersectBVH(rayOrigin, rayDir, *bvh, t, triangle, barycentric);
+    }
+
     void Mesh::bind() const noexcept {
         glBindVertexArray(handle);
     }
 
     void Mesh::draw() const noexcept {
+        GLenum const glIndexType = indexType == IndexType::UInt16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
         switch (type) {
         case PrimitiveType::Points:
-            glDrawElements(GL_POINTS, elementCount, GL_UNSIGNED_INT, 0); break;
+            glDrawElements(GL_POINTS, elementCount, glIndexType, 0); break;
         case PrimitiveType::Lines:
-            glDrawElements(GL_LINES, elementCount, GL_UNSIGNED_INT, 0); break;
+            glDrawElements(GL_LINES, elementCount, glIndexType, 0); break;
         case PrimitiveType::LineStrip:
-            glDrawElements(GL_LINE_STRIP, elementCount, GL_UNSIGNED_INT, 0); break;
+            glDrawElements(GL_LINE_STRIP, elementCount, glIndexType, 0); break;
         case PrimitiveType::LineStripAdjacency:
-            glDrawElements(GL_LINE_STRIP_ADJACENCY, elementCount, GL_UNSIGNED_INT, 0); break;
+            glDrawElements(GL_LINE_STRIP_ADJACENCY, elementCount, glIndexType, 0); break;
         case PrimitiveType::LinesAdjacency:
-            glDrawElements(GL_LINES_ADJACENCY, elementCount, GL_UNSIGNED_INT, 0); break;
+            glDrawElements(GL_LINES_ADJACENCY, elementCount, glIndexType, 0); break;
         case PrimitiveType::TriangleStrip:
-            glDrawElements(GL_TRIANGLE_STRIP, elementCount, GL_UNSIGNED_INT, 0); break;
+            glDrawElements(GL_TRIANGLE_STRIP, elementCount, glIndexType, 0); break;
         case PrimitiveType::TriangleFan:
-            glDrawElements(GL_TRIANGLE_FAN, elementCount, GL_UNSIGNED_INT, 0); break;
+            glDrawElements(GL_TRIANGLE_FAN, elementCount, glIndexType, 0); break;
         case PrimitiveType::Triangles:
-            glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, 0); break;
+            glDrawElements(GL_TRIANGLES, elementCount, glIndexType, 0); break;
         case PrimitiveType::TriangleStripAdjacency:
-            glDrawElements(GL_TRIANGLE_STRIP_ADJACENCY, elementCount, GL_UNSIGNED_INT, 0); break;
+            glDrawElements(GL_TRIANGLE_STRIP_ADJACENCY, elementCount, glIndexType, 0); break;
         case PrimitiveType::TrianglesAdjacency:
-            glDrawElements(GL_TRIANGLES_ADJACENCY, elementCount, GL_UNSIGNED_INT, 0); break;
+            glDrawElements(GL_TRIANGLES_ADJACENCY, elementCount, glIndexType, 0); break;
         case PrimitiveType::Patches:
-            glDrawElements(GL_PATCHES, elementCount, GL_UNSIGNED_INT, 0); break;
+            glDrawElements(GL_PATCHES, elementCount, glIndexType, 0); break;
         }
     }
 
@@ -56,27 +78,28 @@ namespace SGL {
             instanceBuffer->bindInstanceAttributes(start, divisor);
         }
 
+        GLenum const glIndexType = indexType == IndexType::UInt16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
         switch (type) {
         case PrimitiveType::Points:
-            glDrawElementsInstanced(GL_POINTS, elementCount, GL_UNSIGNED_INT, 0, num); break;
+            glDrawElementsInstanced(GL_POINTS, elementCount, glIndexType, 0, num); break;
         case PrimitiveType::Lines:
-            glDrawElementsInstanced(GL_LINES, elementCount, GL_UNSIGNED_INT, 0, num); break;
+            glDrawElementsInstanced(GL_LINES, elementCount, glIndexType, 0, num); break;
         case PrimitiveType::LineStrip:
-            glDrawElementsInstanced(GL_LINE_STRIP, elementCount, GL_UNSIGNED_INT, 0, num); break;
+            glDrawElementsInstanced(GL_LINE_STRIP, elementCount, glIndexType, 0, num); break;
         case PrimitiveType::LineStripAdjacency:
-            glDrawElementsInstanced(GL_LINE_STRIP_ADJACENCY, elementCount, GL_UNSIGNED_INT, 0, num); break;
+            glDrawElementsInstanced(GL_LINE_STRIP_ADJACENCY, elementCount, glIndexType, 0, num); break;
         case PrimitiveType::LinesAdjacency:
-            glDrawElementsInstanced(GL_LINES_ADJACENCY, elementCount, GL_UNSIGNED_INT, 0, num); break;
+            glDrawElementsInstanced(GL_LINES_ADJACENCY, elementCount, glIndexType, 0, num); break;
         case PrimitiveType::TriangleStrip:
-            glDrawElementsInstanced(GL_TRIANGLE_STRIP, elementCount, GL_UNSIGNED_INT, 0, num); break;
+            glDrawElementsInstanced(GL_TRIANGLE_STRIP, elementCount, glIndexType, 0, num); break;
         case PrimitiveType::TriangleFan:
-            glDrawElementsInstanced(GL_TRIANGLE_FAN, elementCount, GL_UNSIGNED_INT, 0, num); break;
+            glDrawElementsInstanced(GL_TRIANGLE_FAN, elementCount, glIndexType, 0, num); break;
         case PrimitiveType::Triangles:
-            glDrawElementsInstanced(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, 0, num); break;
+            glDrawElementsInstanced(GL_TRIANGLES, elementCount, glIndexType, 0, num); break;
         case PrimitiveType::TriangleStripAdjacency:
-            glDrawElementsInstanced(GL_TRIANGLE_STRIP_ADJACENCY, elementCount, GL_UNSIGNED_INT, 0, num); break;
+            glDrawElementsInstanced(GL_TRIANGLE_STRIP_ADJACENCY, elementCount, glIndexType, 0, num); break;
         case PrimitiveType::TrianglesAdjacency:
-            glDrawElementsInstanced(GL_TRIANGLES_ADJACENCY, elementCount, GL_UNSIGNED_INT, 0, num); break;
+            glDrawElementsInstanced(GL_TRIANGLES_ADJACENCY, elementCount, glIndexType, 0, num); break;
         }
     }
 
@@ -2,6 +2,9 @@
 
 #include "SimpleGL/Core/Types.h"
 #include "SimpleGL/Core/Buffer.h"
+#include "SimpleGL/Utility/TriangleBVH.h"
+
+#include <mutex>
 
 namespace SGL {
 
@@ -12,8 +15,28 @@ namespace SGL {
         VertexBuffer vertexBuffer;
         ElementBuffer elementBuffer;
         PrimitiveType type;
-
-        Mesh(float* vdata, uint32_t vsize, VertexBufferLayout const& layout, uint32_t* idata, uint32_t isize, PrimitiveType type = PrimitiveType::Triangles);
+        IndexType indexType;
+        /*
+        *   Mesh space bound of the vertices, filled by the model loaders for culling
+        */
+        Utility::BoundingBoxAABB bound;
+        /*
+        *   CPU copy of the positions, texcoords and triangle indices, only kept when retained at load for picking and baking
+        */
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texcoords;
+        std::vector<uint32_t> indices;
+        /*
+        *   Built from positions and indices on the first raycast, once even when several threads raycast together
+        *   A once_flag can neither move nor reset, so every move gives the target a fresh one along with the bvh of the source
+        */
+        mutable std::unique_ptr<Utility::TriangleBVH> bvh;
+        std::unique_ptr<std::once_flag> bvhBuilt = std::make_unique<std::once_flag>();
+
+        /*
+        *   isize is in bytes, indices are 16 or 32 bit as given by indexType
+        */
+        Mesh(void* vdata, uint32_t vsize, VertexBufferLayout const& layout, void* idata, uint32_t isize, PrimitiveType type = PrimitiveType::Triangles, IndexType indexType = IndexType::UInt32);
 
         Mesh(Mesh const&) = delete;
         Mesh(Mesh&& other) noexcept
@@ -21,6 +44,12 @@ namespace SGL {
             , vertexBuffer(std::move(other.vertexBuffer))
             , elementBuffer(std::move(other.elementBuffer))
             , type(other.type)
+            , indexType(other.indexType)
+            , bound(other.bound)
+            , positions(std::move(other.positions))
+            , texcoords(std::move(other.texcoords))
+            , indices(std::move(other.indices))
+            , bvh(std::move(other.bvh))
         {
             handle = other.handle;
             other.handle = 0;
@@ -32,6 +61,13 @@ namespace SGL {
             vertexBuffer = std::move(other.vertexBuffer);
             elementBuffer = std::move(other.elementBuffer);
             type = other.type;
+            indexType = other.indexType;
+            bound = other.bound;
+            positions = std::move(other.positions);
+            texcoords = std::move(other.texcoords);
+            indices = std::move(other.indices);
+            bvh = std::move(other.bvh);
+            bvhBuilt = std::make_unique<std::once_flag>();
             handle = other.handle;
             other.handle = 0;
             return *this;
@@ -41,6 +77,17 @@ namespace SGL {
         void draw() const noexcept;
         void drawInstanced(uint32_t num, VertexBuffer* instanceBuffer = nullptr, unsigned int start = 0, unsigned int divisor = 0) const noexcept;
 
+        /*
+        *   Closest triangle hit in mesh space, fails if the mesh has no retained triangles
+        *       triangle is the index of the first of its three entries in indices divided by 3
+        */
+        bool raycast(
+            glm::vec3 const& rayOrigin,
+            glm::vec3 const& rayDir,
+            float* t = nullptr,
+            uint32_t* triangle = nullptr,
+            glm::vec2* barycentric = nullptr) const noexcept;
+
     };
 
     struct VertexArray {
@@ -2,6 +2,10 @@
 
 #include "SimpleGL/Core/Model.h"
 #include "SimpleGL/Core/Texture.h"
+#include "SimpleGL/Core/ThreadPool.h"
+#include "SimpleGL/Core/ModelCache.h"
+#include "SimpleGL/Core/MappedFile.h"
+#include "SimpleGL/Utility/VertexPacking.h"
 #include "assimp/Importer.hpp"
 #include "assimp/scene.h"
 #include "assimp/postprocess.h"
@@ -55,8 +59,37 @@ namespace SGL {
         }
     };
 
+    /*
+    *   Commands [0, count) of the bound buffers, entries maps them to the drawList, null when they are the whole drawList
+    */
+    static void drawPooledBatches(Shader* shader, Model::PooledGeometry const& pooled, std::vector<std::pair<Model::Node*, Mesh*>> const& drawList, uint32_t const* entries, uint32_t count) noexcept {
+        uint32_t first = 0;
+        while (first < count) {
+            uint32_t const entry = entries ? entries[first] : first;
+            uint32_t last = first + 1;
+            while (last < count && pooled.drawBatches[entries ? entries[last] : last] == pooled.drawBatches[entry]) {
+                ++last;
+            }
+            Model::Node* node = drawList[entry].first;
+            for (uint32_t j = 0; j < node->textures.size(); ++j) {
+                node->textures[j].second->bind(shader, node->textures[j].first, j);
+            }
+            auto const& pool = pooled.pools[pooled.drawPools[entry]];
+            pool->bind();
+            shader->setInt("uDrawOffset", static_cast<int>(first));
+            pool->multiDraw(first, last - first);
+            first = last;
+        }
+    }
+
     void Model::draw(Shader* shader) noexcept {
         shader->setMat4("uModel", transform);
+        if (pooledGeometry) {
+            pooledGeometry->commandBuffer->bind();
+            pooledGeometry->drawDataBuffer->bind(GeometryPool::DefaultDrawDataBinding);
+            drawPooledBatches(shader, *pooledGeometry, drawList, nullptr, static_cast<uint32_t>(drawList.size()));
+            return;
+        }
         drawNode(shader, rootNode);
     }
 
@@ -65,26 +98,645 @@ namespace SGL {
         drawNodeInstanced(shader, rootNode, num, instanceBuffer, divisor);
     }
 
+    static void collectNodeMeshes(Model::Node* node, std::vector<std::pair<Model::Node*, Mesh*>>& drawList) noexcept {
+        for (auto mesh : node->meshes) {
+            drawList.emplace_back(node, mesh);
+        }
+        for (auto child : node->children) {
+            collectNodeMeshes(child, drawList);
+        }
+    }
+
+    void Model::draw(Shader* shader, Utility::Camera const& camera) noexcept {
+        if (!rootNode) return;
+        if (!cullingBVH) {
+            drawList.clear();
+            collectNodeMeshes(rootNode, drawList);
+            std::vector<Utility::BVHBox> boxes(drawList.size());
+            for (size_t i = 0; i < drawList.size(); ++i) {
+                boxes[i].bound = drawList[i].second->bound;
+            }
+            cullingBVH = Utility::TypedBVH<Utility::BVHBox>::build(boxes);
+        }
+
+        Utility::queryFrustum(*cullingBVH, Utility::Frustum::fromMatrix(camera.getProjView() * transform), visibleMeshes);
+        // draw in node order so the textures of a node are bound once
+        std::sort(visibleMeshes.begin(), visibleMeshes.end());
+
+        shader->setMat4("uModel", transform);
+        if (pooledGeometry) {
+            if (visibleMeshes.empty()) return;
+            auto& pooled = *pooledGeometry;
+            uint32_t const count = static_cast<uint32_t>(visibleMeshes.size());
+            for (uint32_t i = 0; i < count; ++i) {
+                pooled.visibleCommands[i] = pooled.commands[visibleMeshes[i]];
+                pooled.visibleDrawData[i] = pooled.drawData[visibleMeshes[i]];
+            }
+            pooled.visibleCommandBuffer->update(pooled.visibleCommands.data(), 0, count * sizeof(DrawElementsIndirectCommand));
+            pooled.visibleDrawDataBuffer->update(pooled.visibleDrawData.data(), 0, count * sizeof(GeometryDrawData));
+            pooled.visibleCommandBuffer->bind();
+            pooled.visibleDrawDataBuffer->bind(GeometryPool::DefaultDrawDataBinding);
+            drawPooledBatches(shader, pooled, drawList, visibleMeshes.data(), count);
+            return;
+        }
+        Node* boundNode = nullptr;
+        for (uint32_t i : visibleMeshes) {
+            auto [node, mesh] = drawList[i];
+            if (node != boundNode) {
+                for (uint32_t j = 0; j < node->textures.size(); ++j) {
+                    node->textures[j].second->bind(shader, node->textures[j].first, j);
+                }
+                boundNode = node;
+            }
+            mesh->bind();
+            mesh->draw();
+        }
+    }
+
+    void Model::buildGeometryPools() noexcept {
+        pooledGeometry.reset();
+        if (!rootNode) return;
+        // the culling BVH indexes the drawList, so both are rebuilt together
+        drawList.clear();
+        collectNodeMeshes(rootNode, drawList);
+        cullingBVH.reset();
+        if (drawList.empty()) return;
+
+        auto pooled = std::make_unique<PooledGeometry>();
+        // one pool per vertex layout and primitive type, in order of first use
+        std::vector<std::vector<Mesh const*>> groups;
+        std::vector<uint32_t> ranges(drawList.size());
+        pooled->drawPools.resize(drawList.size());
+        for (size_t i = 0; i < drawList.size(); ++i) {
+            Mesh const* mesh = drawList[i].second;
+            uint32_t group = 0;
+            while (group < groups.size() && !GeometryPool::isCompatible(*mesh, *groups[group][0])) {
+                ++group;
+            }
+            if (group == groups.size()) {
+                groups.emplace_back();
+            }
+            pooled->drawPools[i] = group;
+            ranges[i] = static_cast<uint32_t>(groups[group].size());
+            groups[group].push_back(mesh);
+        }
+        for (auto const& group : groups) {
+            auto pool = GeometryPool::build(group);
+            if (!pool) {
+                SGL_LOG_WARN("Model: geometry pools of {0} are not built, meshes are drawn one by one", directory);
+                return;
+            }
+            pooled->pools.push_back(std::move(pool));
+        }
+
+        pooled->drawBatches.resize(drawList.size());
+        pooled->commands.resize(drawList.size());
+        pooled->drawData.resize(drawList.size());
+        uint32_t batch = 0;
+        uint32_t nodeIndex = 0;
+        for (size_t i = 0; i < drawList.size(); ++i) {
+            auto [node, mesh] = drawList[i];
+            if (i > 0) {
+                Node const* previous = drawList[i - 1].first;
+                bool const sameTextures = node == previous || node->textures == previous->textures;
+                if (pooled->drawPools[i] != pooled->drawPools[i - 1] || !sameTextures) ++batch;
+                if (node != previous) ++nodeIndex;
+            }
+            pooled->drawBatches[i] = batch;
+            pooled->commands[i] = pooled->pools[pooled->drawPools[i]]->getCommand(ranges[i], static_cast<uint32_t>(i));
+            auto& data = pooled->drawData[i];
+            data.boundMin = mesh->bound.min;
+            data.boundMax = mesh->bound.max;
+            data.mesh = static_cast<uint32_t>(i);
+            data.node = nodeIndex;
+        }
+
+        uint32_t const commandSize = static_cast<uint32_t>(drawList.size() * sizeof(DrawElementsIndirectCommand));
+        uint32_t const drawDataSize = static_cast<uint32_t>(drawList.size() * sizeof(GeometryDrawData));
+        pooled->commandBuffer = std::make_unique<IndirectBuffer>(pooled->commands.data(), commandSize);
+        pooled->drawDataBuffer = std::make_unique<StorageBuffer>(pooled->drawData.data(), drawDataSize);
+        pooled->visibleCommands.resize(drawList.size());
+        pooled->visibleDrawData.resize(drawList.size());
+        pooled->visibleCommandBuffer = std::make_unique<IndirectBuffer>(nullptr, commandSize, BufferUsageType::Dynamic);
+        pooled->visibleDrawDataBuffer = std::make_unique<StorageBuffer>(nullptr, drawDataSize, BufferUsageType::Dynamic);
+        pooledGeometry = std::move(pooled);
+    }
+
+    static bool raycastNode(Model::Node* node, glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, float& tt, Model::RaycastHit& hit) noexcept {
+        bool isHit = false;
+        for (auto mesh : node->meshes) {
+            uint32_t triangle;
+            glm::vec2 barycentric;
+            if (mesh->raycast(rayOrigin, rayDir, &tt, &triangle, &barycentric)) {
+                isHit = true;
+                hit.node = node;
+                hit.mesh = mesh;
+                hit.triangle = triangle;
+                hit.barycentric = barycentric;
+            }
+        }
+        for (auto child : node->children) {
+            isHit |= raycastNode(child, rayOrigin, rayDir, tt, hit);
+        }
+        return isHit;
+    }
+
+    bool Model::raycast(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, RaycastHit* hit) const noexcept {
+        if (!rootNode) return false;
+        // the direction is not normalized after the transform, so t stays a world space distance
+        glm::mat4 const invTransform = glm::inverse(transform);
+        glm::vec3 const localOrigin = glm::vec3(invTransform * glm::vec4(rayOrigin, 1.0f));
+        glm::vec3 const localDir = glm::vec3(invTransform * glm::vec4(rayDir, 0.0f));
+
+        float tt = INFINITY;
+        RaycastHit result;
+        if (!raycastNode(rootNode, localOrigin, localDir, tt, result)) return false;
+        if (hit) {
+            auto const& indices = result.mesh->indices;
+            auto const& positions = result.mesh->positions;
+            glm::vec3 const v0 = positions[indices[result.triangle * 3 + 0]];
+            glm::vec3 const v1 = positions[indices[result.triangle * 3 + 1]];
+            glm::vec3 const v2 = positions[indices[result.triangle * 3 + 2]];
+            glm::vec3 const localNormal = glm::cross(v1 - v0, v2 - v0);
+            result.t = tt;
+            result.point = rayOrigin + rayDir * tt;
+            result.normal = glm::normalize(glm::vec3(glm::transpose(invTransform) * glm::vec4(localNormal, 0.0f)));
+            *hit = result;
+        }
+        return true;
+    }
+
+    static void getNodeTriangles(Model::Node const* node, glm::mat4 const& transform, std::vector<glm::vec3>& vertices) noexcept {
+        for (auto mesh : node->meshes) {
+            if (mesh->type != PrimitiveType::Triangles) continue;
+            for (size_t i = 0; i + 2 < mesh->indices.size(); i += 3) {
+                for (size_t j = 0; j < 3; ++j) {
+                    vertices.push_back(glm::vec3(transform * glm::vec4(mesh->positions[mesh->indices[i + j]], 1.0f)));
+                }
+            }
+        }
+        for (auto child : node->children) {
+            getNodeTriangles(child, transform, vertices);
+        }
+    }
+
+    void Model::getRetainedTriangles(std::vector<glm::vec3>& vertices, glm::mat4 const& vertexTransform) const noexcept {
+        if (rootNode) {
+            getNodeTriangles(rootNode, vertexTransform, vertices);
+        }
+    }
+
+    template<typename Vertex>
+    static void computeMeshBound(Mesh* mesh, std::vector<Vertex> const& vertices) noexcept {
+        mesh->bound.reset();
+        for (auto const& vertex : vertices) {
+            mesh->bound.append(vertex.position);
+        }
+    }
+
+    /*
+    *   Packed texcoords are retained as the shader reads them, the same values a cache file gives back
+    */
+    template<typename Vertex>
+    static void retainMeshGeometry(Mesh* mesh, std::vector<Vertex> const& vertices, std::vector<uint32_t> const& indices) noexcept {
+        DataType const texcoordType = mesh->vertexBuffer.layout.elements[2].type;
+        mesh->positions.resize(vertices.size());
+        mesh->texcoords.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            mesh->positions[i] = vertices[i].position;
+            mesh->texcoords[i] = texcoordType == DataType::Float2
+                ? vertices[i].texcoord
+                : Utility::unpackTexcoord(Utility::packTexcoord(vertices[i].texcoord, texcoordType), texcoordType);
+        }
+        mesh->indices = indices;
+    }
+
+    /*
+    *   Vertex of ModelLoadOption::quantizeVertices, texcoord is UShort2N or Half2 depending on the range of the mesh
+    */
+    struct PackedVertex {
+        glm::vec3 position;
+        uint32_t normal;
+        uint32_t texcoord;
+        uint32_t tangent;
+    };
+
+    /*
+    *   Uploads a triangle mesh of loader vertices in the vertex and index format chosen by option
+    */
+    template<typename Vertex>
+    static Mesh* createModelMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, ModelLoadOption const& option) noexcept {
+        IndexType indexType = IndexType::UInt32;
+        void* indexData = indices.data();
+        std::vector<uint16_t> shortIndices;
+        if (option.shortIndices && vertices.size() <= 65536) {
+            indexType = IndexType::UInt16;
+            shortIndices.assign(indices.begin(), indices.end());
+            indexData = shortIndices.data();
+        }
+        uint32_t const indexSize = static_cast<uint32_t>(indices.size() * getIndexTypeSize(indexType));
+
+        if (!option.quantizeVertices) {
+            return new Mesh(
+                vertices.data(),
+                static_cast<uint32_t>(vertices.size() * sizeof(Vertex)),
+                VertexBufferLayout{
+                    {DataType::Float3},
+                    {DataType::Float3},
+                    {DataType::Float2},
+                    {DataType::Float3},
+                    {DataType::Float3}
+                },
+                indexData,
+                indexSize,
+                PrimitiveType::Triangles,
+                indexType);
+        }
+
+        Utility::addVertexPackingShaderInclude();
+        glm::vec2 texcoordMin(0.0f);
+        glm::vec2 texcoordMax(0.0f);
+        for (auto const& vertex : vertices) {
+            texcoordMin = glm::min(texcoordMin, vertex.texcoord);
+            texcoordMax = glm::max(texcoordMax, vertex.texcoord);
+        }
+        DataType const texcoordType = Utility::getTexcoordType(texcoordMin, texcoordMax);
+
+        std::vector<PackedVertex> packed(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            packed[i].position = vertices[i].position;
+            packed[i].normal = Utility::packNormal(vertices[i].normal);
+            packed[i].texcoord = Utility::packTexcoord(vertices[i].texcoord, texcoordType);
+            packed[i].tangent = Utility::packTangent(vertices[i].normal, vertices[i].tangent, vertices[i].bitangent);
+        }
+        return new Mesh(
+            packed.data(),
+            static_cast<uint32_t>(packed.size() * sizeof(PackedVertex)),
+            VertexBufferLayout{
+                {DataType::Float3},
+                {DataType::Short2N},
+                {texcoordType},
+                {DataType::Int2101010N}
+            },
+            indexData,
+            indexSize,
+            PrimitiveType::Triangles,
+            indexType);
+    }
+
+    static void logMeshOptimizeStats(std::string const& path, Utility::MeshOptimizeStats const& stats) noexcept {
+        SGL_LOG_INFO("Optimized {0}: ACMR {1:.3f} -> {2:.3f}, ATVR {3:.3f} -> {4:.3f}",
+            path, stats.before.getACMR(), stats.after.getACMR(), stats.before.getATVR(), stats.after.getATVR());
+    }
+
     static inline std::string getAssimpTextureFilename(aiMaterial* mat, uint32_t i, aiTextureType type) noexcept {
         aiString filename;
         mat->GetTexture(type, i, &filename);
         return std::string(filename.C_Str());
     }
 
-    static std::vector<std::pair<std::string, Texture*>> processAssimpMaterialTextures(Model* model, aiMaterial* mat, aiTextureType type, std::string const& name) noexcept {
-        std::vector<std::pair<std::string, Texture*>> textures;
+    /*
+    *   Textures of an import or a cached model, decoded while the nodes are processed and uploaded once all meshes are built
+    *   Node entries are filled with null textures first and patched after the upload
+    */
+    struct ModelTextureStage {
+
+        bool parallel = true;
+        std::string directory;
+        std::vector<std::string> filenames;
+        std::vector<std::future<TextureImage>> images;
+        std::unordered_map<std::string, uint32_t> slots;
+        // node, index in its textures and slot of the texture
+        std::vector<std::tuple<Model::Node*, size_t, uint32_t>> bindings;
+
+        uint32_t request(std::string const& filename) noexcept {
+            auto it = slots.find(filename);
+            if (it != slots.end()) return it->second;
+
+            uint32_t const slot = static_cast<uint32_t>(filenames.size());
+            slots.emplace(filename, slot);
+            filenames.push_back(filename);
+            std::string path = directory + filename;
+            auto decode = [path = std::move(path)]() { return TextureImage::decode(path); };
+            images.push_back(parallel ? ThreadPool::instance().submit(std::move(decode)) : std::async(std::launch::deferred, std::move(decode)));
+            return slot;
+        }
+
+    };
+
+    static aiTextureType const assimpTextureTypes[] = { aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_NORMALS, aiTextureType_HEIGHT };
+
+    static void requestAssimpTextures(ModelTextureStage& stage, const aiScene* scene) noexcept {
+        std::vector<bool> used(scene->mNumMaterials, false);
+        for (uint32_t i = 0; i < scene->mNumMeshes; ++i) {
+            used[scene->mMeshes[i]->mMaterialIndex] = true;
+        }
+        for (uint32_t i = 0; i < scene->mNumMaterials; ++i) {
+            if (!used[i]) continue;
+            for (auto type : assimpTextureTypes) {
+                for (uint32_t j = 0; j < scene->mMaterials[i]->GetTextureCount(type); ++j) {
+                    stage.request(getAssimpTextureFilename(scene->mMaterials[i], j, type));
+                }
+            }
+        }
+    }
+
+    static std::vector<std::pair<std::string, uint32_t>> processAssimpMaterialTextures(ModelTextureStage& stage, aiMaterial* mat, aiTextureType type, std::string const& name) noexcept {
+        std::vector<std::pair<std::string, uint32_t>> textures;
         for (uint32_t i = 0; i < mat->GetTextureCount(type); i++) {
             auto filename = getAssimpTextureFilename(mat, i, type);
-            if (model->textures.find(filename) == model->textures.end()) {
-                Texture* texture = new Texture2D(model->directory + filename);
-                model->textures.insert(std::make_pair(filename, texture));
-            }
-            textures.emplace_back(std::make_pair(name + std::to_string(i), model->textures[filename]));
+            textures.emplace_back(std::make_pair(name + std::to_string(i), stage.request(filename)));
         }
         return textures;
     }
 
-    static void processAssimpMesh(Model* model, Model::Node* mNode, aiMesh* mesh, const aiScene* scene) noexcept {
+    static void uploadModelTextures(Model* model, ModelTextureStage& stage) noexcept {
+        // tasks run in submission order, so waiting in the same order uploads each image about as soon as it is ready
+        std::vector<Texture*> textures(stage.filenames.size());
+        for (size_t i = 0; i < stage.filenames.size(); ++i) {
+            textures[i] = new Texture2D(stage.images[i].get());
+            model->textures.insert(std::make_pair(stage.filenames[i], textures[i]));
+        }
+        for (auto const& [node, index, slot] : stage.bindings) {
+            node->textures[index].second = textures[slot];
+        }
+    }
+
+    /*
+    *   Key of the model file mixed with the options that change the uploaded geometry, 0 without a cache directory
+    */
+    static uint64_t getCacheKey(std::string const& path, ModelCacheSource source, ModelLoadOption const& option) noexcept {
+        if (option.cacheDirectory.empty()) return 0;
+        uint64_t key = getModelCacheKey(path, source);
+        if (key == 0) return 0;
+        key = hashBytes(&option.optimizeMeshes, sizeof(option.optimizeMeshes), key);
+        if (option.optimizeMeshes) {
+            key = hashBytes(&option.optimizeOption.cacheSize, sizeof(option.optimizeOption.cacheSize), key);
+            key = hashBytes(&option.optimizeOption.optimizeOverdraw, sizeof(option.optimizeOption.optimizeOverdraw), key);
+            key = hashBytes(&option.optimizeOption.overdrawThreshold, sizeof(option.optimizeOption.overdrawThreshold), key);
+            key = hashBytes(&option.optimizeOption.optimizeVertexFetch, sizeof(option.optimizeOption.optimizeVertexFetch), key);
+        }
+        key = hashBytes(&option.quantizeVertices, sizeof(option.quantizeVertices), key);
+        key = hashBytes(&option.shortIndices, sizeof(option.shortIndices), key);
+        return key != 0 ? key : 1;
+    }
+
+    static inline ModelCacheString appendCacheString(std::string& strings, std::string const& str) noexcept {
+        ModelCacheString range;
+        range.offset = static_cast<uint32_t>(strings.size());
+        range.length = static_cast<uint32_t>(str.size());
+        strings += str;
+        return range;
+    }
+
+    static bool collectCacheNode(Model::Node const* node, std::unordered_map<Texture const*, uint32_t> const& textureIndices, ModelCacheData& data) noexcept {
+        ModelCacheNode record;
+        record.childCount = static_cast<uint32_t>(node->children.size());
+        record.meshBegin = static_cast<uint32_t>(data.meshes.size());
+        record.meshCount = static_cast<uint32_t>(node->meshes.size());
+        record.textureBegin = static_cast<uint32_t>(data.nodeTextures.size());
+        record.textureCount = static_cast<uint32_t>(node->textures.size());
+        data.nodes.push_back(record);
+
+        for (auto const& [name, texture] : node->textures) {
+            auto it = textureIndices.find(texture);
+            if (it == textureIndices.end()) return false;
+            ModelCacheNodeTexture nodeTexture;
+            nodeTexture.name = appendCacheString(data.strings, name);
+            nodeTexture.texture = it->second;
+            data.nodeTextures.push_back(nodeTexture);
+        }
+
+        for (auto mesh : node->meshes) {
+            ModelCacheMesh meshRecord;
+            // read back what was uploaded, so the file keeps the GPU layout whatever the loader built
+            meshRecord.vertexOffset = (data.vertices.size() + 15) / 16 * 16;
+            meshRecord.vertexSize = mesh->vertexBuffer.getSize();
+            meshRecord.indexOffset = (data.indices.size() + 3) / 4 * 4;
+            meshRecord.indexSize = static_cast<uint64_t>(mesh->elementCount) * getIndexTypeSize(mesh->indexType);
+            meshRecord.elementBegin = static_cast<uint32_t>(data.elements.size());
+            meshRecord.elementCount = static_cast<uint32_t>(mesh->vertexBuffer.layout.elements.size());
+            meshRecord.stride = mesh->vertexBuffer.layout.stride;
+            meshRecord.type = mesh->type;
+            meshRecord.indexType = mesh->indexType;
+            meshRecord.boundMin = mesh->bound.min;
+            meshRecord.boundMax = mesh->bound.max;
+
+            data.vertices.resize(meshRecord.vertexOffset + meshRecord.vertexSize);
+            data.indices.resize(meshRecord.indexOffset + meshRecord.indexSize);
+            mesh->vertexBuffer.getData(data.vertices.data() + meshRecord.vertexOffset, 0, static_cast<uint32_t>(meshRecord.vertexSize));
+            mesh->elementBuffer.getData(data.indices.data() + meshRecord.indexOffset, 0, static_cast<uint32_t>(meshRecord.indexSize));
+            for (auto const& element : mesh->vertexBuffer.layout.elements) {
+                ModelCacheElement elementRecord;
+                elementRecord.type = element.type;
+                elementRecord.offset = element.offset;
+                data.elements.push_back(elementRecord);
+            }
+            data.meshes.push_back(meshRecord);
+        }
+
+        for (auto child : node->children) {
+            if (!collectCacheNode(child, textureIndices, data)) return false;
+        }
+        return true;
+    }
+
+    static void saveCachedModel(Model const* model, Filepath const& directory, uint64_t key) noexcept {
+        ModelCacheData data;
+        std::unordered_map<Texture const*, uint32_t> textureIndices;
+        for (auto const& [filename, texture] : model->textures) {
+            textureIndices.emplace(texture, static_cast<uint32_t>(data.textures.size()));
+            data.textures.push_back(appendCacheString(data.strings, filename));
+        }
+        if (!collectCacheNode(model->rootNode, textureIndices, data)) {
+            SGL_LOG_WARN("Model uses textures it does not own, not cached");
+            return;
+        }
+        saveModelCache(directory, key, data);
+    }
+
+    /*
+    *   Positions are the first element, texcoords the first Float2, UShort2N or Half2 element, as the loaders lay them out
+    */
+    static void retainCachedGeometry(Mesh* mesh, uint8_t const* vertices, uint8_t const* indices, ModelCacheMesh const& record, ModelCacheElement const* elements) noexcept {
+        if (record.elementCount == 0 || elements[0].type != DataType::Float3) return;
+        size_t const vertexCount = record.vertexSize / record.stride;
+        ModelCacheElement const* texcoord = nullptr;
+        for (uint32_t i = 1; i < record.elementCount && !texcoord; ++i) {
+            if (elements[i].type == DataType::Float2 || elements[i].type == DataType::UShort2N || elements[i].type == DataType::Half2) {
+                texcoord = &elements[i];
+            }
+        }
+        mesh->positions.resize(vertexCount);
+        mesh->texcoords.resize(vertexCount, glm::vec2(0.0f));
+        for (size_t i = 0; i < vertexCount; ++i) {
+            std::memcpy(&mesh->positions[i], vertices + i * record.stride + elements[0].offset, sizeof(glm::vec3));
+            if (!texcoord) continue;
+            if (texcoord->type == DataType::Float2) {
+                std::memcpy(&mesh->texcoords[i], vertices + i * record.stride + texcoord->offset, sizeof(glm::vec2));
+            }
+            else {
+                uint32_t packed;
+                std::memcpy(&packed, vertices + i * record.stride + texcoord->offset, sizeof(packed));
+                mesh->texcoords[i] = Utility::unpackTexcoord(packed, texcoord->type);
+            }
+        }
+        if (record.indexType == IndexType::UInt16) {
+            auto const shortIndices = reinterpret_cast<uint16_t const*>(indices);
+            mesh->indices.assign(shortIndices, shortIndices + record.indexSize / sizeof(uint16_t));
+        }
+        else {
+            auto const longIndices = reinterpret_cast<uint32_t const*>(indices);
+            mesh->indices.assign(longIndices, longIndices + record.indexSize / sizeof(uint32_t));
+        }
+    }
+
+    /*
+    *   Builds the nodes of model from a cache file, the vertex and index buffers are uploaded straight from the mapped pages
+    *   Every range is checked before the first GL object is created, so a damaged file leaves model untouched
+    */
+    static bool loadCachedModel(Model* model, ModelLoadOption const& option, uint64_t key) noexcept {
+        ModelCacheHeader header;
+        auto file = openModelCache(option.cacheDirectory, key, header);
+        if (!file) return false;
+
+        size_t nodeCount, meshCount, elementCount, nodeTextureCount, textureCount, stringSize, vertexSize, indexSize;
+        auto nodes = getModelCacheSection<ModelCacheNode>(file->data, header, ModelCacheSection::Nodes, nodeCount);
+        auto meshes = getModelCacheSection<ModelCacheMesh>(file->data, header, ModelCacheSection::Meshes, meshCount);
+        auto elements = getModelCacheSection<ModelCacheElement>(file->data, header, ModelCacheSection::Elements, elementCount);
+        auto nodeTextures = getModelCacheSection<ModelCacheNodeTexture>(file->data, header, ModelCacheSection::NodeTextures, nodeTextureCount);
+        auto textures = getModelCacheSection<ModelCacheString>(file->data, header, ModelCacheSection::Textures, textureCount);
+        auto strings = getModelCacheSection<char>(file->data, header, ModelCacheSection::Strings, stringSize);
+        auto vertices = getModelCacheSection<uint8_t>(file->data, header, ModelCacheSection::Vertices, vertexSize);
+        auto indices = getModelCacheSection<uint8_t>(file->data, header, ModelCacheSection::Indices, indexSize);
+
+        auto validString = [&](ModelCacheString const& str) {
+            return str.offset <= stringSize && str.length <= stringSize - str.offset;
+        };
+        bool valid = nodeCount > 0;
+        for (size_t i = 0; valid && i < textureCount; ++i) {
+            valid = validString(textures[i]);
+        }
+        for (size_t i = 0; valid && i < nodeTextureCount; ++i) {
+            valid = validString(nodeTextures[i].name) && nodeTextures[i].texture < textureCount;
+        }
+        for (size_t i = 0; valid && i < meshCount; ++i) {
+            auto const& mesh = meshes[i];
+            valid = mesh.stride > 0
+                && mesh.vertexOffset % sizeof(float) == 0
+                && mesh.vertexOffset <= vertexSize && mesh.vertexSize <= vertexSize - mesh.vertexOffset
+                && mesh.vertexSize <= std::numeric_limits<uint32_t>::max()
+                && (mesh.indexType == IndexType::UInt16 || mesh.indexType == IndexType::UInt32)
+                && mesh.indexOffset % getIndexTypeSize(mesh.indexType) == 0 && mesh.indexSize % getIndexTypeSize(mesh.indexType) == 0
+                && mesh.indexOffset <= indexSize && mesh.indexSize <= indexSize - mesh.indexOffset
+                && mesh.indexSize <= std::numeric_limits<uint32_t>::max()
+                && mesh.elementBegin <= elementCount && mesh.elementCount <= elementCount - mesh.elementBegin;
+            for (uint32_t j = 0; valid && j < mesh.elementCount; ++j) {
+                auto const& element = elements[mesh.elementBegin + j];
+                valid = element.offset < mesh.stride && getDataTypeSize(element.type) <= mesh.stride - element.offset;
+            }
+            // draws, raycasts and bakes index the vertices without a check
+            if (valid) {
+                uint64_t const vertexCount = mesh.vertexSize / mesh.stride;
+                uint64_t maxIndex = 0;
+                if (mesh.indexType == IndexType::UInt16) {
+                    auto const shortIndices = reinterpret_cast<uint16_t const*>(indices + mesh.indexOffset);
+                    for (uint64_t j = 0; j < mesh.indexSize / sizeof(uint16_t); ++j) {
+                        maxIndex = std::max<uint64_t>(maxIndex, shortIndices[j]);
+                    }
+                }
+                else {
+                    auto const longIndices = reinterpret_cast<uint32_t const*>(indices + mesh.indexOffset);
+                    for (uint64_t j = 0; j < mesh.indexSize / sizeof(uint32_t); ++j) {
+                        maxIndex = std::max<uint64_t>(maxIndex, longIndices[j]);
+                    }
+                }
+                valid = mesh.indexSize == 0 || maxIndex < vertexCount;
+            }
+        }
+        for (size_t i = 0; valid && i < nodeCount; ++i) {
+            valid = nodes[i].meshBegin <= meshCount && nodes[i].meshCount <= meshCount - nodes[i].meshBegin
+                && nodes[i].textureBegin <= nodeTextureCount && nodes[i].textureCount <= nodeTextureCount - nodes[i].textureBegin;
+        }
+        // the child counts have to describe exactly one depth first tree over all nodes
+        if (valid) {
+            std::vector<uint32_t> pending = { 1 };
+            size_t next = 0;
+            while (valid && !pending.empty()) {
+                if (pending.back() == 0) {
+                    pending.pop_back();
+                    continue;
+                }
+                --pending.back();
+                valid = next < nodeCount;
+                if (valid) pending.push_back(nodes[next++].childCount);
+            }
+            valid = valid && next == nodeCount;
+        }
+        if (!valid) {
+            SGL_LOG_WARN("Ignoring damaged model cache {0:x}", key);
+            return false;
+        }
+
+        if (option.quantizeVertices) {
+            Utility::addVertexPackingShaderInclude();
+        }
+
+        // start decoding before the meshes are uploaded, slots follow the texture table
+        ModelTextureStage stage;
+        stage.parallel = option.parallelTextureDecode;
+        stage.directory = model->directory;
+        for (size_t i = 0; i < textureCount; ++i) {
+            stage.request(std::string(strings + textures[i].offset, textures[i].length));
+        }
+
+        std::vector<std::pair<Model::Node*, uint32_t>> parents;
+        for (size_t i = 0; i < nodeCount; ++i) {
+            Model::Node* node = model->rootNode;
+            if (i > 0) {
+                node = new Model::Node();
+                while (parents.back().second == 0) parents.pop_back();
+                parents.back().first->children.push_back(node);
+                --parents.back().second;
+            }
+
+            for (uint32_t j = 0; j < nodes[i].textureCount; ++j) {
+                auto const& nodeTexture = nodeTextures[nodes[i].textureBegin + j];
+                stage.bindings.emplace_back(node, node->textures.size(), nodeTexture.texture);
+                node->textures.emplace_back(std::string(strings + nodeTexture.name.offset, nodeTexture.name.length), nullptr);
+            }
+
+            for (uint32_t j = 0; j < nodes[i].meshCount; ++j) {
+                auto const& record = meshes[nodes[i].meshBegin + j];
+                VertexBufferLayout layout{};
+                layout.stride = record.stride;
+                for (uint32_t k = 0; k < record.elementCount; ++k) {
+                    layout.elements.emplace_back(elements[record.elementBegin + k].type, elements[record.elementBegin + k].offset);
+                }
+                node->meshes.push_back(new Mesh(
+                    const_cast<uint8_t*>(vertices + record.vertexOffset),
+                    static_cast<uint32_t>(record.vertexSize),
+                    layout,
+                    const_cast<uint8_t*>(indices + record.indexOffset),
+                    static_cast<uint32_t>(record.indexSize),
+                    record.type,
+                    record.indexType));
+                node->meshes.back()->bound.min = record.boundMin;
+                node->meshes.back()->bound.max = record.boundMax;
+
+                if (option.retainGeometry) {
+                    retainCachedGeometry(node->meshes.back(), vertices + record.vertexOffset, indices + record.indexOffset, record, elements + record.elementBegin);
+                }
+            }
+
+            parents.emplace_back(node, nodes[i].childCount);
+        }
+
+        uploadModelTextures(model, stage);
+        return true;
+    }
+
+    static void processAssimpMesh(ModelTextureStage& stage, Utility::MeshOptimizeStats& stats, Model::Node* mNode, aiMesh* mesh, const aiScene* scene, ModelLoadOption const& option) noexcept {
         struct Vertex {
             glm::vec3 position;
             glm::vec3 normal;
@@ -95,7 +747,7 @@ namespace SGL {
 
         std::vector<Vertex> vertices;
         std::vector<uint32_t> indices;
-        std::vector<std::pair<std::string, Texture*>> textures;
+        std::vector<std::pair<std::string, uint32_t>> textures;
 
         for (size_t i = 0; i < mesh->mNumVertices; i++) {
             Vertex vertex = {};
@@ -147,53 +799,61 @@ namespace SGL {
                 indices.push_back(face.mIndices[j]);
         }
 
+        if (option.optimizeMeshes) {
+            stats.append(Utility::optimizeMesh(vertices.data(), static_cast<uint32_t>(vertices.size()), sizeof(Vertex), offsetof(Vertex, position), indices, option.optimizeOption));
+        }
+
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 
-        auto diffuseMaps = processAssimpMaterialTextures(model, material, aiTextureType_DIFFUSE, "uDiffuseMap");
-        mNode->textures.insert(mNode->textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        auto diffuseMaps = processAssimpMaterialTextures(stage, material, aiTextureType_DIFFUSE, "uDiffuseMap");
+        for (auto const& [name, slot] : diffuseMaps) {
+            stage.bindings.emplace_back(mNode, mNode->textures.size(), slot);
+            mNode->textures.emplace_back(name, nullptr);
+        }
 
-        auto specularMaps = processAssimpMaterialTextures(model, material, aiTextureType_SPECULAR, "uSpecularMap");
+        auto specularMaps = processAssimpMaterialTextures(stage, material, aiTextureType_SPECULAR, "uSpecularMap");
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 
-        auto normalMaps = processAssimpMaterialTextures(model, material, aiTextureType_NORMALS, "uNormalMap");
+        auto normalMaps = processAssimpMaterialTextures(stage, material, aiTextureType_NORMALS, "uNormalMap");
         textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
 
-        auto heightMaps = processAssimpMaterialTextures(model, material, aiTextureType_HEIGHT, "uHeightMap");
+        auto heightMaps = processAssimpMaterialTextures(stage, material, aiTextureType_HEIGHT, "uHeightMap");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
-        mNode->meshes.push_back(new Mesh(
-            (float*)vertices.data(),
-            static_cast<uint32_t>(vertices.size() * sizeof(Vertex)),
-            VertexBufferLayout{
-                {DataType::Float3},
-                {DataType::Float3},
-                {DataType::Float2},
-                {DataType::Float3},
-                {DataType::Float3}
-            },
-            indices.data(),
-            static_cast<uint32_t>(indices.size() * sizeof(uint32_t)),
-            PrimitiveType::Triangles));
+        mNode->meshes.push_back(createModelMesh(vertices, indices, option));
+        computeMeshBound(mNode->meshes.back(), vertices);
+
+        if (option.retainGeometry) {
+            retainMeshGeometry(mNode->meshes.back(), vertices, indices);
+        }
     }
 
-    static void processAssimpNode(Model* model, Model::Node* mNode, aiNode* node, const aiScene* scene) noexcept {
+    static void processAssimpNode(ModelTextureStage& stage, Utility::MeshOptimizeStats& stats, Model::Node* mNode, aiNode* node, const aiScene* scene, ModelLoadOption const& option) noexcept {
         for (size_t i = 0; i < node->mNumMeshes; i++) {
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            processAssimpMesh(model, mNode, mesh, scene);
+            processAssimpMesh(stage, stats, mNode, mesh, scene, option);
         }
 
         for (size_t i = 0; i < node->mNumChildren; i++) {
             auto newNode = new Model::Node();
             mNode->children.push_back(newNode);
-            processAssimpNode(model, newNode, node->mChildren[i], scene);
+            processAssimpNode(stage, stats, newNode, node->mChildren[i], scene, option);
         }
     }
 
-    std::unique_ptr<Model> Model::loadAssimp(std::string const& path) noexcept {
+    std::unique_ptr<Model> Model::loadAssimp(std::string const& path, ModelLoadOption const& option) noexcept {
         auto model = std::make_unique<Model>();
         model->directory = path.substr(0, path.find_last_of('/') + 1);
         model->rootNode = new Node();
 
+        uint64_t const cacheKey = getCacheKey(path, ModelCacheSource::Assimp, option);
+        if (cacheKey != 0 && loadCachedModel(model.get(), option, cacheKey)) {
+            if (option.poolGeometry) {
+                model->buildGeometryPools();
+            }
+            return model;
+        }
+
         Assimp::Importer importer;
         aiScene const* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
 
@@ -202,12 +862,30 @@ namespace SGL {
             return model;
         }
 
-        processAssimpNode(model.get(), model->rootNode, scene->mRootNode, scene);
+        // decoding starts before the node walk and overlaps with building the meshes
+        ModelTextureStage stage;
+        stage.parallel = option.parallelTextureDecode;
+        stage.directory = model->directory;
+        requestAssimpTextures(stage, scene);
+        Utility::MeshOptimizeStats stats;
+        processAssimpNode(stage, stats, model->rootNode, scene->mRootNode, scene, option);
+        uploadModelTextures(model.get(), stage);
+        if (option.optimizeMeshes) {
+            logMeshOptimizeStats(path, stats);
+        }
+
+        if (cacheKey != 0) {
+            saveCachedModel(model.get(), option.cacheDirectory, cacheKey);
+        }
+
+        if (option.poolGeometry) {
+            model->buildGeometryPools();
+        }
 
         return model;
     }
 
-    std::unique_ptr<Model> Model::loadTinyObjLoader(std::string const& path) noexcept {
+    std::unique_ptr<Model> Model::loadTinyObjLoader(std::string const& path, ModelLoadOption const& option) noexcept {
         struct Vertex {
             glm::vec3 position;
             glm::vec3 normal;
@@ -220,6 +898,14 @@ namespace SGL {
         model->directory = path.substr(0, path.find_last_of('/') + 1);
         model->rootNode = new Node();
 
+        uint64_t const cacheKey = getCacheKey(path, ModelCacheSource::TinyObjLoader, option);
+        if (cacheKey != 0 && loadCachedModel(model.get(), option, cacheKey)) {
+            if (option.poolGeometry) {
+                model->buildGeometryPools();
+            }
+            return model;
+        }
+
         tinyobj::ObjReaderConfig readerConfig;
         readerConfig.mtl_search_path = model->directory;
         tinyobj::ObjReader reader;
@@ -282,19 +968,25 @@ namespace SGL {
             }
         }
 
-        model->rootNode->meshes.push_back(new Mesh(
-            (float*)vertices.data(),
-            static_cast<uint32_t>(vertices.size() * sizeof(Vertex)),
-            VertexBufferLayout{
-                {DataType::Float3},
-                {DataType::Float3},
-                {DataType::Float2},
-                {DataType::Float3},
-                {DataType::Float3}
-            },
-            indices.data(),
-            static_cast<uint32_t>(indices.size() * sizeof(uint32_t)),
-            PrimitiveType::Triangles));
+        if (option.optimizeMeshes) {
+            auto stats = Utility::optimizeMesh(vertices.data(), static_cast<uint32_t>(vertices.size()), sizeof(Vertex), offsetof(Vertex, position), indices, option.optimizeOption);
+            logMeshOptimizeStats(path, stats);
+        }
+
+        model->rootNode->meshes.push_back(createModelMesh(vertices, indices, option));
+        computeMeshBound(model->rootNode->meshes.back(), vertices);
+
+        if (option.retainGeometry) {
+            retainMeshGeometry(model->rootNode->meshes.back(), vertices, indices);
+        }
+
+        if (cacheKey != 0) {
+            saveCachedModel(model.get(), option.cacheDirectory, cacheKey);
+        }
+
+        if (option.poolGeometry) {
+            model->buildGeometryPools();
+        }
 
         return model;
     }
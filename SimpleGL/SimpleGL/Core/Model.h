@@ -3,6 +3,10 @@
 #include "SimpleGL/Core/Texture.h"
 #include "SimpleGL/Core/Shader.h"
 #include "SimpleGL/Core/Mesh.h"
+#include "SimpleGL/Core/GeometryPool.h"
+#include "SimpleGL/Utility/Culling.h"
+#include "SimpleGL/Utility/Camera.h"
+#include "SimpleGL/Utility/MeshOptimizer.h"
 
 namespace SGL {
 
@@ -13,6 +17,39 @@ namespace SGL {
 
     };
 
+    struct ModelLoadOption {
+        /*
+        *   Keep positions, texcoords and indices of each mesh on the CPU, needed by Model::raycast and the AO baker
+        */
+        bool retainGeometry = false;
+        /*
+        *   Decode the textures on ThreadPool::instance() while the meshes are built, uploads stay on the calling thread
+        */
+        bool parallelTextureDecode = true;
+        /*
+        *   Reorder the triangles and vertices of each mesh for the vertex cache, overdraw and vertex fetch, the ACMR and ATVR are logged
+        */
+        bool optimizeMeshes = true;
+        Utility::MeshOptimizeOption optimizeOption;
+        /*
+        *   Upload 24 byte packed vertices instead of 56 byte float ones, see Model::draw for the attributes
+        */
+        bool quantizeVertices = false;
+        /*
+        *   16 bit index buffers for meshes of at most 65536 vertices
+        */
+        bool shortIndices = true;
+        /*
+        *   Copy the meshes into shared buffers after loading and draw them with glMultiDrawElementsIndirect, see Model::buildGeometryPools
+        */
+        bool poolGeometry = false;
+        /*
+        *   Directory of compiled model files, empty disables them
+        *   A file is keyed by a hash of the model file, so it is rebuilt when the model changes but not when a material file beside it does
+        */
+        Filepath cacheDirectory;
+    };
+
     struct Model {
 
         glm::mat4 transform = glm::mat4(1.0f);
@@ -36,9 +73,58 @@ namespace SGL {
 
         };
 
+        struct RaycastHit {
+
+            Node* node = nullptr;
+            Mesh* mesh = nullptr;
+            /*
+            *   Triangle of the mesh, see Mesh::raycast
+            */
+            uint32_t triangle = 0;
+            glm::vec2 barycentric = glm::vec2(0.0f);
+            /*
+            *   Distance along the world space ray, point and normal are in world space as well
+            */
+            float t = INFINITY;
+            glm::vec3 point = glm::vec3(0.0f);
+            glm::vec3 normal = glm::vec3(0.0f);
+
+        };
+
         std::string directory;
         Node* rootNode = nullptr;
 
+        /*
+        *   Every mesh with its node in draw order, and a BVH over their mesh bounds, built on the first culled draw
+        */
+        std::vector<std::pair<Node*, Mesh*>> drawList;
+        std::unique_ptr<Utility::TypedBVH<Utility::BVHBox>> cullingBVH;
+        std::vector<uint32_t> visibleMeshes;
+
+        /*
+        *   Draw state of the geometry pools, entry i of each vector belongs to drawList[i]
+        *   Neighbours of the same batch share a pool and the textures of their nodes, so one multi draw covers them
+        */
+        struct PooledGeometry {
+
+            std::vector<std::unique_ptr<GeometryPool>> pools;
+            std::vector<uint32_t> drawPools;
+            std::vector<uint32_t> drawBatches;
+            std::vector<DrawElementsIndirectCommand> commands;
+            std::vector<GeometryDrawData> drawData;
+            std::unique_ptr<IndirectBuffer> commandBuffer;
+            std::unique_ptr<StorageBuffer> drawDataBuffer;
+            /*
+            *   Compacted commands and draw data of the visible meshes, uploaded by every culled draw
+            */
+            std::vector<DrawElementsIndirectCommand> visibleCommands;
+            std::vector<GeometryDrawData> visibleDrawData;
+            std::unique_ptr<IndirectBuffer> visibleCommandBuffer;
+            std::unique_ptr<StorageBuffer> visibleDrawDataBuffer;
+
+        };
+        std::unique_ptr<PooledGeometry> pooledGeometry;
+
         Model() = default;
         ~Model() noexcept;
 
@@ -55,6 +141,12 @@ namespace SGL {
         *   layout (location = 2) in vec2 aTexcoord;
         *   layout (location = 3) in vec3 aTangent;
         *   layout (location = 4) in vec3 aBitangent;
+        * With ModelLoadOption::quantizeVertices there is no bitangent and the rest is packed,
+        * the functions of #include "SimpleGL/VertexPacking.glsl" decode them, it is registered by the first such load:
+        *   layout (location = 0) in vec3 aPosition;
+        *   layout (location = 1) in vec2 aNormal;      // sglUnpackNormal(aNormal)
+        *   layout (location = 2) in vec2 aTexcoord;
+        *   layout (location = 3) in vec4 aTangent;     // sglUnpackTangent(aTangent), then sglGetBitangent(normal, tangent)
         * Also it will automatically bind the following textures:
         *   uniform sampler2D uDiffuseMap0;
         *   uniform sampler2D uDiffuseMap1;
@@ -67,12 +159,43 @@ namespace SGL {
         *   ...
         * Meanwhile, it will set the following uniforms:
         *   uniform mat4 uModel;
+        * With geometry pools the draw data of each mesh comes from #include "SimpleGL/GeometryPool.glsl",
+        * its mesh is the index in drawList and its node the index of the node in draw order
+        * The include has to come right after #version, ahead of other includes, as it may enable ARB_shader_draw_parameters:
+        *   SGLDraw draw = sglGetDraw(SGL_DRAW_ID);     // vertex shader only
         */
         void draw(Shader* shader) noexcept;
+        /*
+        *   Always per mesh, pools have no instance attributes
+        */
         void drawInstanced(Shader* shader, uint32_t num, VertexBuffer* instanceBuffer = nullptr, uint32_t divisor = 0) noexcept;
 
-        static std::unique_ptr<Model> loadAssimp(std::string const& path) noexcept;
-        static std::unique_ptr<Model> loadTinyObjLoader(std::string const& path) noexcept;
+        /*
+        *   Same as draw, but only meshes whose bound overlaps the view frustum of the camera are drawn
+        *   Culling runs in model space, so moving the model does not rebuild anything, nodes should not change after the first call
+        */
+        void draw(Shader* shader, Utility::Camera const& camera) noexcept;
+
+        /*
+        *   Copies the meshes of every vertex layout into one GeometryPool and builds their indirect commands, needs GL 4.3
+        *   Both draws then issue one glMultiDrawElementsIndirect per batch instead of a bind and a draw per mesh
+        *   The meshes keep their own buffers, call it again after changing the nodes, a failed pool falls back to per mesh draws
+        */
+        void buildGeometryPools() noexcept;
+
+        /*
+        *   Closest hit of a world space ray against the retained geometry of all meshes, nodes share the model transform
+        *   The BVH of a mesh is built on its first query, so the first pick of a large model is slower
+        */
+        bool raycast(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, RaycastHit* hit = nullptr) const noexcept;
+
+        /*
+        *   Append the retained triangles of all meshes as vertex triples, moved by the given transform
+        */
+        void getRetainedTriangles(std::vector<glm::vec3>& vertices, glm::mat4 const& vertexTransform = glm::mat4(1.0f)) const noexcept;
+
+        static std::unique_ptr<Model> loadAssimp(std::string const& path, ModelLoadOption const& option = ModelLoadOption()) noexcept;
+        static std::unique_ptr<Model> loadTinyObjLoader(std::string const& path, ModelLoadOption const& option = ModelLoadOption()) noexcept;
 
     };
 
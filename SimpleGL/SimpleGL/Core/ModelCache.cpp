@@ -0,0 +1,122 @@
+#include "PCH.h"
+
+#include "SimpleGL/Core/ModelCache.h"
+#include "SimpleGL/Core/MappedFile.h"
+
+namespace SGL {
+
+    static constexpr uint64_t MODEL_CACHE_ALIGNMENT = 64;
+    static constexpr uint32_t MODEL_CACHE_SECTION_COUNT = static_cast<uint32_t>(ModelCacheSection::Count);
+
+    static inline uint64_t alignCacheOffset(uint64_t offset) noexcept {
+        return (offset + MODEL_CACHE_ALIGNMENT - 1) / MODEL_CACHE_ALIGNMENT * MODEL_CACHE_ALIGNMENT;
+    }
+
+    static Filepath getModelCachePath(Filepath const& directory, uint64_t key) noexcept {
+        char name[32];
+        std::snprintf(name, sizeof(name), "model_%016llx.bin", static_cast<unsigned long long>(key));
+        return directory / name;
+    }
+
+    uint64_t getModelCacheKey(Filepath const& path, ModelCacheSource source) noexcept {
+        auto file = MappedFile::open(path);
+        if (!file) return 0;
+
+        uint32_t const version = ModelCacheHeader().version;
+        uint64_t key = hashBytes(&version, sizeof(version));
+        key = hashBytes(&source, sizeof(source), key);
+        uint64_t const size = file->size;
+        key = hashBytes(&size, sizeof(size), key);
+        key = hashBytes(file->data, file->size, key);
+        // 0 means no key
+        return key != 0 ? key : 1;
+    }
+
+    std::shared_ptr<MappedFile> openModelCache(Filepath const& directory, uint64_t key, ModelCacheHeader& header) noexcept {
+        if (directory.empty()) return nullptr;
+        Filepath const path = getModelCachePath(directory, key);
+        std::error_code error;
+        if (!std::filesystem::exists(path, error)) return nullptr;
+
+        std::shared_ptr<MappedFile> file = MappedFile::open(path);
+        if (!file || file->size < sizeof(ModelCacheHeader)) return nullptr;
+        std::memcpy(&header, file->data, sizeof(header));
+
+        ModelCacheHeader const expected;
+        bool valid = header.magic == expected.magic
+            && header.version == expected.version
+            && header.key == key;
+        for (uint32_t i = 0; valid && i < MODEL_CACHE_SECTION_COUNT; ++i) {
+            valid = header.offsets[i] % MODEL_CACHE_ALIGNMENT == 0
+                && header.offsets[i] <= file->size
+                && header.sizes[i] <= file->size - header.offsets[i];
+        }
+        if (!valid) {
+            SGL_LOG_WARN("Ignoring invalid model cache {0}", path.string());
+            return nullptr;
+        }
+        return file;
+    }
+
+    bool saveModelCache(Filepath const& directory, uint64_t key, ModelCacheData const& data) noexcept {
+        if (directory.empty()) return false;
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+
+        void const* sections[MODEL_CACHE_SECTION_COUNT] = {
+            data.nodes.data(),
+            data.meshes.data(),
+            data.elements.data(),
+            data.nodeTextures.data(),
+            data.textures.data(),
+            data.strings.data(),
+            data.vertices.data(),
+            data.indices.data(),
+        };
+        ModelCacheHeader header;
+        header.key = key;
+        header.sizes[static_cast<uint32_t>(ModelCacheSection::Nodes)] = data.nodes.size() * sizeof(ModelCacheNode);
+        header.sizes[static_cast<uint32_t>(ModelCacheSection::Meshes)] = data.meshes.size() * sizeof(ModelCacheMesh);
+        header.sizes[static_cast<uint32_t>(ModelCacheSection::Elements)] = data.elements.size() * sizeof(ModelCacheElement);
+        header.sizes[static_cast<uint32_t>(ModelCacheSection::NodeTextures)] = data.nodeTextures.size() * sizeof(ModelCacheNodeTexture);
+        header.sizes[static_cast<uint32_t>(ModelCacheSection::Textures)] = data.textures.size() * sizeof(ModelCacheString);
+        header.sizes[static_cast<uint32_t>(ModelCacheSection::Strings)] = data.strings.size();
+        header.sizes[static_cast<uint32_t>(ModelCacheSection::Vertices)] = data.vertices.size();
+        header.sizes[static_cast<uint32_t>(ModelCacheSection::Indices)] = data.indices.size();
+        uint64_t offset = alignCacheOffset(sizeof(ModelCacheHeader));
+        for (uint32_t i = 0; i < MODEL_CACHE_SECTION_COUNT; ++i) {
+            header.offsets[i] = offset;
+            offset = alignCacheOffset(offset + header.sizes[i]);
+        }
+
+        Filepath const path = getModelCachePath(directory, key);
+        Filepath temp = path;
+        temp += ".tmp";
+        {
+            std::ofstream ofs(temp.string().c_str(), std::ofstream::out | std::ofstream::binary);
+            if (!ofs.is_open()) {
+                SGL_LOG_ERROR("Failed to write file: {0}", temp.string());
+                return false;
+            }
+            char const padding[MODEL_CACHE_ALIGNMENT] = {};
+            ofs.write(reinterpret_cast<char const*>(&header), sizeof(header));
+            uint64_t written = sizeof(header);
+            for (uint32_t i = 0; i < MODEL_CACHE_SECTION_COUNT; ++i) {
+                ofs.write(padding, header.offsets[i] - written);
+                ofs.write(static_cast<char const*>(sections[i]), header.sizes[i]);
+                written = header.offsets[i] + header.sizes[i];
+            }
+            if (!ofs) {
+                SGL_LOG_ERROR("Failed to write file: {0}", temp.string());
+                return false;
+            }
+        }
+        std::filesystem::rename(temp, path, error);
+        if (error) {
+            std::filesystem::remove(temp, error);
+            return false;
+        }
+        return true;
+    }
+
+}
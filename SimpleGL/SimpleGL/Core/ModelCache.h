@@ -0,0 +1,129 @@
+#pragma once
+
+#include "SimpleGL/Core/Types.h"
+#include "SimpleGL/Core/IO.h"
+#include "glm/glm.hpp"
+
+namespace SGL {
+
+    struct MappedFile;
+
+    enum struct ModelCacheSource : uint32_t {
+        Assimp = 0,
+        TinyObjLoader = 1,
+    };
+
+    enum struct ModelCacheSection : uint32_t {
+        Nodes = 0,
+        Meshes,
+        Elements,
+        NodeTextures,
+        Textures,
+        Strings,
+        Vertices,
+        Indices,
+        Count,
+    };
+
+    /*
+    *   Layout of a compiled model file, every section starts on a 64 byte boundary so the mapped file is used in place
+    *   Files are only valid on machines with the same endianness and structure layout, a version bump invalidates them
+    */
+    struct ModelCacheHeader {
+        uint32_t magic = 0x444D4753; // "SGMD"
+        uint32_t version = 2;
+        uint64_t key = 0;
+        /*
+        *   Byte offset and size of each section
+        */
+        uint64_t offsets[static_cast<uint32_t>(ModelCacheSection::Count)] = {};
+        uint64_t sizes[static_cast<uint32_t>(ModelCacheSection::Count)] = {};
+    };
+
+    /*
+    *   Nodes in depth first order, children follow their parent
+    */
+    struct ModelCacheNode {
+        uint32_t childCount = 0;
+        uint32_t meshBegin = 0;
+        uint32_t meshCount = 0;
+        uint32_t textureBegin = 0;
+        uint32_t textureCount = 0;
+    };
+
+    /*
+    *   Vertex bytes in the GPU layout given by its elements and stride, index bytes of indexType
+    */
+    struct ModelCacheMesh {
+        uint64_t vertexOffset = 0;
+        uint64_t vertexSize = 0;
+        uint64_t indexOffset = 0;
+        uint64_t indexSize = 0;
+        uint32_t elementBegin = 0;
+        uint32_t elementCount = 0;
+        uint32_t stride = 0;
+        PrimitiveType type = PrimitiveType::Triangles;
+        IndexType indexType = IndexType::UInt32;
+        glm::vec3 boundMin = glm::vec3(0.0f);
+        glm::vec3 boundMax = glm::vec3(0.0f);
+    };
+
+    struct ModelCacheElement {
+        DataType type = DataType::None;
+        uint32_t offset = 0;
+    };
+
+    /*
+    *   Strings are ranges of the string section, texture names are relative to the model directory
+    */
+    struct ModelCacheString {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    struct ModelCacheNodeTexture {
+        ModelCacheString name;
+        uint32_t texture = 0;
+    };
+
+    /*
+    *   Content of a file to write, vertex and index offsets of the meshes are relative to their sections
+    */
+    struct ModelCacheData {
+        std::vector<ModelCacheNode> nodes;
+        std::vector<ModelCacheMesh> meshes;
+        std::vector<ModelCacheElement> elements;
+        std::vector<ModelCacheNodeTexture> nodeTextures;
+        std::vector<ModelCacheString> textures;
+        std::string strings;
+        std::vector<uint8_t> vertices;
+        std::vector<uint8_t> indices;
+    };
+
+    /*
+    *   Key of a model file, hashed from its content, so edits to the file regenerate the cache but moving it does not
+    *   Returns 0 if the file cannot be read
+    */
+    uint64_t getModelCacheKey(Filepath const& path, ModelCacheSource source) noexcept;
+
+    /*
+    *   Map the cache file of key, nullptr on a miss or if the header does not match the key or the file size
+    */
+    std::shared_ptr<MappedFile> openModelCache(Filepath const& directory, uint64_t key, ModelCacheHeader& header) noexcept;
+
+    /*
+    *   The file is written next to its final name and renamed so readers never see it partially
+    */
+    bool saveModelCache(Filepath const& directory, uint64_t key, ModelCacheData const& data) noexcept;
+
+    /*
+    *   Records of a section of an opened cache file, count is in records
+    */
+    template<typename T>
+    inline T const* getModelCacheSection(void const* file, ModelCacheHeader const& header, ModelCacheSection section, size_t& count) noexcept {
+        uint32_t const i = static_cast<uint32_t>(section);
+        count = header.sizes[i] / sizeof(T);
+        return reinterpret_cast<T const*>(static_cast<uint8_t const*>(file) + header.offsets[i]);
+    }
+
+}
@@ -83,6 +83,49 @@ namespace SGL {
         return DataType::None;
     }
 
+    static std::unordered_map<std::string, std::string>& getIncludes() noexcept {
+        static std::unordered_map<std::string, std::string> includes;
+        return includes;
+    }
+
+    /*
+    *   Replace '#include "name"' lines by the registered source of that name or the file relative to directory
+    */
+    static std::string expandIncludes(std::string const& code, Filepath const& directory, uint32_t depth = 0) {
+        if (depth > 16) {
+            SGL_LOG_ERROR("Shader includes nested too deep, recursive include?");
+            return std::string();
+        }
+        std::string result;
+        std::istringstream lines(code);
+        std::string line;
+        while (std::getline(lines, line)) {
+            size_t const first = line.find_first_not_of(" \t");
+            if (first == std::string::npos || line.compare(first, 8, "#include") != 0) {
+                result += line;
+                result += '\n';
+                continue;
+            }
+            size_t const nameBeg = line.find_first_of("\"<", first + 8);
+            size_t const nameEnd = nameBeg == std::string::npos ? nameBeg : line.find_first_of("\">", nameBeg + 1);
+            if (nameEnd == std::string::npos) {
+                SGL_LOG_ERROR("Malformed shader include: {0}", line);
+                continue;
+            }
+            auto const name = line.substr(nameBeg + 1, nameEnd - nameBeg - 1);
+            auto const& includes = getIncludes();
+            auto it = includes.find(name);
+            if (it != includes.end()) {
+                result += expandIncludes(it->second, directory, depth + 1);
+            }
+            else {
+                auto const path = directory / name;
+                result += expandIncludes(readFile(path), path.parent_path(), depth + 1);
+            }
+        }
+        return result;
+    }
+
     ShaderModule::~ShaderModule() {
         if (handle == 0) return;
         glDeleteShader(handle);
@@ -117,7 +160,7 @@ namespace SGL {
             size_t bracketEnd = findPairedBrackets(code, bracketBeg);
             auto src = code.substr(bracketBeg + 1, bracketEnd - bracketBeg - 1);
 
-            src = uniforms + src;
+            src = expandIncludes(uniforms + src, Filepath(path).parent_path());
 
             SGL_LOG_INFO("Loading shader stage [{0}] from file {1}", type, path);
             shaders.push_back(new ShaderModule(src.c_str(), typeToShaderStage(type)));
@@ -129,6 +172,10 @@ namespace SGL {
         linkShader(shaders);
     }
 
+    void Shader::addInclude(std::string const& name, std::string const& code) noexcept {
+        getIncludes()[name] = code;
+    }
+
     Shader::Shader(std::initializer_list<ShaderModule*> shaders) noexcept {
         handle = glCreateProgram();
         linkShader(shaders);
@@ -177,6 +224,7 @@ namespace SGL {
             case DataType::Float4: setVec4(uniforms[index].location, *(glm::vec4*)data); return;
             case DataType::Mat3: setMat3(uniforms[index].location, *(glm::mat3*)data); return;
             case DataType::Mat4: setMat4(uniforms[index].location, *(glm::mat4*)data); return;
+            default: break;
             }
             SGL_LOG_WARN("Uniform {0} with unknown or unsupported DataType", name);
         }
@@ -193,6 +241,7 @@ namespace SGL {
             case DataType::Sampler2D:
             case DataType::SamplerCube:
                 setInt(uniforms[index].location, binding); return;
+            default: break;
             }
             SGL_LOG_WARN("Uniform {0} with unknown or unsupported DataType", name);
         }
@@ -245,6 +294,7 @@ namespace SGL {
             case DataType::Sampler2D:
             case DataType::SamplerCube:
                 glGetUniformiv(handle, uniforms[index].location, (GLint*)ptr); return;
+            default: break;
             }
         }
         else {
@@ -283,7 +333,8 @@ namespace SGL {
             switch (uniforms[index].type) {
             case DataType::Sampler2D:
             case DataType::SamplerCube:
-                glGetUniformiv(handle, uniforms[index].location, (GLint*)&binding);
+                glGetUniformiv(handle, uniforms[index].location, (GLint*)&binding); break;
+            default: break;
             }
         }
         else {
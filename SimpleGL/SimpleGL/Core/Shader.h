@@ -57,6 +57,12 @@ namespace SGL {
         Shader(Shader&& other) noexcept;
         ~Shader();
 
+        /*
+        *   Shader files replace '#include "name"' lines by the source registered here under name,
+        *   other names are read relative to the including file
+        */
+        static void addInclude(std::string const& name, std::string const& code) noexcept;
+
         void bind() const noexcept;
         void bind(StorageBuffer const& buffer, uint32_t index, std::string const& name) const noexcept;
         void bind(UniformBuffer const& buffer, uint32_t index, std::string const& name) const noexcept;
@@ -2,6 +2,7 @@
 
 #include "SimpleGL/Core/Texture.h"
 #include "SimpleGL/Core/Shader.h"
+#include "SimpleGL/Core/ThreadPool.h"
 #include "glad/glad.h"
 #include "stb/stb_image.h"
 #include "stb/stb_image_write.h"
@@ -39,66 +40,57 @@ namespace SGL {
         shader->setInt(name.c_str(), binding);
     }
 
-    Texture2D::Texture2D(std::string const& filename, bool hdr, bool genMipmap, bool flipY) noexcept {
-        type = TextureType::Texture2D;
-        glBindTexture(GL_TEXTURE_2D, handle);
+    void TextureImage::PixelDeleter::operator()(void* pixels) const noexcept {
+        stbi_image_free(pixels);
+    }
 
-        int width, height, nrChannels;
-        stbi_set_flip_vertically_on_load(flipY);
+    TextureImage TextureImage::decode(std::string const& filename, bool hdr, bool flipY) noexcept {
+        TextureImage image;
+        image.hdr = hdr;
+        // the thread local flag keeps concurrent decodes from racing on the global one
+        stbi_set_flip_vertically_on_load_thread(flipY);
         if (hdr) {
-            float* data = stbi_loadf(filename.c_str(), &width, &height, &nrChannels, 0);
-            if (data) {
-                switch (nrChannels) {
-                case 4:
-                    // about gamma correction:
-                    // not recommend to correct automatically because normal map and specular map are almost always in linear space
-                    // glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, data);
-                    break;
-                case 3:
-                    // glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data);
-                    break;
-                case 1:
-                    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_FLOAT, data);
-                    break;
-                default:
-                    break;
-                }
-                stbi_image_free(data);
-            }
-            else {
-                SGL_LOG_ERROR("Failed to load file: {0}", filename);
-                stbi_image_free(data);
-            }
+            image.pixels.reset(stbi_loadf(filename.c_str(), &image.width, &image.height, &image.channels, 0));
         }
         else {
-            unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrChannels, 0);
-            if (data) {
-                switch (nrChannels) {
-                case 4:
-                    // about gamma correction:
-                    // not recommend to correct automatically because normal map and specular map are almost always in linear space
-                    // glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-                    break;
-                case 3:
-                    // glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-                    break;
-                case 1:
-                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, data);
-                    break;
-                default:
-                    break;
-                }
-                stbi_image_free(data);
-            }
-            else {
-                SGL_LOG_ERROR("Failed to load file: {0}", filename);
-                stbi_image_free(data);
-            }
+            image.pixels.reset(stbi_load(filename.c_str(), &image.width, &image.height, &image.channels, 0));
         }
+        if (!image.pixels) {
+            SGL_LOG_ERROR("Failed to load file: {0}", filename);
+        }
+        return image;
+    }
+
+    static void uploadImage(GLenum target, TextureImage const& image) noexcept {
+        if (!image.pixels) return;
+        GLenum const type = image.hdr ? GL_FLOAT : GL_UNSIGNED_BYTE;
+        // about gamma correction:
+        // not recommend to correct automatically because normal map and specular map are almost always in linear space
+        // glTexImage2D(target, 0, GL_SRGB_ALPHA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        switch (image.channels) {
+        case 4:
+            glTexImage2D(target, 0, image.hdr ? GL_RGBA16F : GL_RGBA, image.width, image.height, 0, GL_RGBA, type, image.pixels.get());
+            break;
+        case 3:
+            glTexImage2D(target, 0, image.hdr ? GL_RGB16F : GL_RGB, image.width, image.height, 0, GL_RGB, type, image.pixels.get());
+            break;
+        case 1:
+            glTexImage2D(target, 0, image.hdr ? GL_R16F : GL_RED, image.width, image.height, 0, GL_RED, type, image.pixels.get());
+            break;
+        default:
+            break;
+        }
+    }
+
+    Texture2D::Texture2D(std::string const& filename, bool hdr, bool genMipmap, bool flipY) noexcept
+        : Texture2D(TextureImage::decode(filename, hdr, flipY), genMipmap) {
+    }
+
+    Texture2D::Texture2D(TextureImage const& image, bool genMipmap) noexcept {
+        type = TextureType::Texture2D;
+        glBindTexture(GL_TEXTURE_2D, handle);
+
+        uploadImage(GL_TEXTURE_2D, image);
 
         if (genMipmap) {
             glGenerateMipmap(GL_TEXTURE_2D);
@@ -142,31 +134,26 @@ namespace SGL {
         glBindTexture(GL_TEXTURE_2D, 0);
     }
 
-    TextureCube::TextureCube(std::vector<std::string> const& filenames, bool genMipmap, bool flipY) noexcept {
+    static std::vector<TextureImage> decodeFaces(std::vector<std::string> const& filenames, bool flipY) noexcept {
+        std::vector<TextureImage> faces(filenames.size());
+        ThreadPool::instance().parallelFor(0, static_cast<uint32_t>(filenames.size()), 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                faces[i] = TextureImage::decode(filenames[i], false, flipY);
+            }
+        });
+        return faces;
+    }
+
+    TextureCube::TextureCube(std::vector<std::string> const& filenames, bool genMipmap, bool flipY) noexcept
+        : TextureCube(decodeFaces(filenames, flipY), genMipmap) {
+    }
+
+    TextureCube::TextureCube(std::vector<TextureImage> const& faces, bool genMipmap) noexcept {
         type = TextureType::TextureCube;
         glBindTexture(GL_TEXTURE_CUBE_MAP, handle);
 
-        int width, height, nrChannels;
-        stbi_set_flip_vertically_on_load(flipY);
-        for (uint32_t i = 0; i < filenames.size(); i++) {
-            unsigned char* data = stbi_load(filenames[i].c_str(), &width, &height, &nrChannels, 0);
-            if (data) {
-                if (nrChannels == 4) {
-                    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                        0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data
-                    );
-                }
-                else {
-                    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                        0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
-                    );
-                }
-                stbi_image_free(data);
-            }
-            else {
-                SGL_LOG_ERROR("Failed to load file: {0}", filenames[i]);
-                stbi_image_free(data);
-            }
+        for (uint32_t i = 0; i < faces.size(); i++) {
+            uploadImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, faces[i]);
         }
         if (genMipmap) {
             glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
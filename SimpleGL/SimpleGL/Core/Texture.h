@@ -6,6 +6,26 @@ namespace SGL {
 
     struct Shader;
 
+    /*
+    *   Pixels of an image file decoded by stb, decoding touches no GL state so it can run on any thread
+    *   8 bit channels, or floats when hdr, channels is 1, 3 or 4 and pixels is null when the file failed to load
+    */
+    struct TextureImage {
+
+        struct PixelDeleter {
+            void operator()(void* pixels) const noexcept;
+        };
+
+        std::unique_ptr<void, PixelDeleter> pixels;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        bool hdr = false;
+
+        static TextureImage decode(std::string const& filename, bool hdr = false, bool flipY = true) noexcept;
+
+    };
+
     struct Texture {
 
         uint32_t handle;
@@ -36,10 +56,18 @@ namespace SGL {
     struct Texture2D : public Texture {
         Texture2D(std::string const& filename, bool hdr = false, bool genMipmap = false, bool flipY = true) noexcept;
         Texture2D(uint32_t width, uint32_t height, InternalFormat format, void* data = NULL) noexcept;
+        /*
+        *   Upload an image decoded earlier, must be called on the thread of the GL context
+        */
+        Texture2D(TextureImage const& image, bool genMipmap = false) noexcept;
     };
 
     struct TextureCube : public Texture {
+        /*
+        *   The faces are decoded in parallel on ThreadPool::instance()
+        */
         TextureCube(std::vector<std::string> const& filenames, bool genMipmap = true, bool flipY = false) noexcept;
+        TextureCube(std::vector<TextureImage> const& faces, bool genMipmap = true) noexcept;
     };
 
     void saveSnapshot(std::string const& path, int w, int h) noexcept;
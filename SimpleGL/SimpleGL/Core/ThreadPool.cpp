@@ -0,0 +1,87 @@
+#include "PCH.h"
+
+#include "SimpleGL/Core/ThreadPool.h"
+
+namespace SGL {
+
+    ThreadPool::ThreadPool(uint32_t threadCount) noexcept {
+        if (threadCount == 0) {
+            uint32_t hardwareCount = std::thread::hardware_concurrency();
+            threadCount = hardwareCount > 1 ? hardwareCount - 1 : 1;
+        }
+        workers.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; ++i) {
+            workers.emplace_back([this]() {
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                        if (stopping && tasks.empty()) return;
+                        task = std::move(tasks.front());
+                        tasks.pop_front();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    ThreadPool::~ThreadPool() noexcept {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::parallelFor(uint32_t begin, uint32_t end, uint32_t grain, std::function<void(uint32_t, uint32_t)> const& func) noexcept {
+        if (begin >= end) return;
+        grain = std::max(grain, 1U);
+        uint32_t chunkCount = (end - begin + grain - 1) / grain;
+        if (chunkCount == 1) {
+            func(begin, end);
+            return;
+        }
+
+        // shared with helper tasks which may only start after this call returned
+        struct State {
+            std::atomic<uint32_t> next{ 0 };
+            std::atomic<uint32_t> done{ 0 };
+            std::mutex mutex;
+            std::condition_variable condition;
+        };
+        auto state = std::make_shared<State>();
+
+        auto work = [state, begin, end, grain, chunkCount, &func]() {
+            uint32_t chunk;
+            while ((chunk = state->next.fetch_add(1)) < chunkCount) {
+                uint32_t chunkBegin = begin + chunk * grain;
+                func(chunkBegin, std::min(chunkBegin + grain, end));
+                if (state->done.fetch_add(1) + 1 == chunkCount) {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->condition.notify_all();
+                }
+            }
+        };
+
+        uint32_t helperCount = std::min(getThreadCount(), chunkCount - 1);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (uint32_t i = 0; i < helperCount; ++i) {
+                // helpers only touch func while chunks are left, which the caller waits for
+                tasks.emplace_back(work);
+            }
+        }
+        condition.notify_all();
+
+        work();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->condition.wait(lock, [&]() { return state->done.load() == chunkCount; });
+    }
+
+}
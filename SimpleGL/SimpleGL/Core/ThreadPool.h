@@ -0,0 +1,67 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <deque>
+
+namespace SGL {
+
+    struct ThreadPool {
+
+        /*
+        *   threadCount of 0 uses one worker per hardware thread except the calling one
+        */
+        ThreadPool(uint32_t threadCount = 0) noexcept;
+        ~ThreadPool() noexcept;
+
+        ThreadPool(ThreadPool const&) = delete;
+        ThreadPool(ThreadPool&&) = delete;
+
+        ThreadPool& operator=(ThreadPool const&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+
+        uint32_t getThreadCount() const noexcept { return static_cast<uint32_t>(workers.size()); }
+
+        /*
+        *   Queue a task, the returned future is ready once the task has run
+        */
+        template<typename F>
+        auto submit(F&& func) -> std::future<decltype(func())> {
+            using R = decltype(func());
+            auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(func));
+            auto future = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.emplace_back([task]() { (*task)(); });
+            }
+            condition.notify_one();
+            return future;
+        }
+
+        /*
+        *   Run func(chunkBegin, chunkEnd) over [begin, end) in chunks of grain and wait for all of them,
+        *   the calling thread takes chunks as well, so it can be used from inside a pool task
+        */
+        void parallelFor(uint32_t begin, uint32_t end, uint32_t grain, std::function<void(uint32_t, uint32_t)> const& func) noexcept;
+
+        /*
+        *   Shared pool used by the library
+        */
+        static ThreadPool& instance() noexcept {
+            static ThreadPool pool;
+            return pool;
+        }
+
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping = false;
+
+    };
+
+}
@@ -35,6 +35,27 @@ namespace SGL {
         Mat4,
         Sampler2D,
         SamplerCube,
+        /*
+        *   Vertex attribute only types, integer ones reach the shader as ivec or uvec,
+        *   N ones are normalized to [-1, 1] if signed and [0, 1] if not, Half ones are 16 bit floats
+        */
+        UInt,
+        UInt2,
+        UInt3,
+        UInt4,
+        UByte4,
+        Byte4N,
+        UByte4N,
+        Short2N,
+        Short4N,
+        UShort2N,
+        UShort4N,
+        Half2,
+        Half4,
+        /*
+        *   GL_INT_2_10_10_10_REV, 10 bit x, y, z and 2 bit w in one 32 bit word, x in the low bits
+        */
+        Int2101010N,
     };
 
     constexpr inline uint32_t getDataTypeSize(DataType type) noexcept {
@@ -51,6 +72,20 @@ namespace SGL {
         case DataType::Bool:    return 1;
         case DataType::Mat3:    return 4 * 3 * 3;
         case DataType::Mat4:    return 4 * 4 * 4;
+        case DataType::UInt:    return 4;
+        case DataType::UInt2:   return 4 * 2;
+        case DataType::UInt3:   return 4 * 3;
+        case DataType::UInt4:   return 4 * 4;
+        case DataType::UByte4:  return 4;
+        case DataType::Byte4N:  return 4;
+        case DataType::UByte4N: return 4;
+        case DataType::Short2N: return 2 * 2;
+        case DataType::Short4N: return 2 * 4;
+        case DataType::UShort2N: return 2 * 2;
+        case DataType::UShort4N: return 2 * 4;
+        case DataType::Half2:   return 2 * 2;
+        case DataType::Half4:   return 2 * 4;
+        case DataType::Int2101010N: return 4;
         default:                return 0;
         }
     }
@@ -89,6 +124,15 @@ namespace SGL {
         Stream,
     };
 
+    enum struct IndexType {
+        UInt16,
+        UInt32,
+    };
+
+    constexpr inline uint32_t getIndexTypeSize(IndexType type) noexcept {
+        return type == IndexType::UInt16 ? 2 : 4;
+    }
+
     enum struct PrimitiveType {
         Points,
         LineStrip,
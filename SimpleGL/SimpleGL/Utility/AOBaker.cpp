@@ -0,0 +1,277 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/AOBaker.h"
+#include "SimpleGL/Utility/RayQuery.h"
+#include "SimpleGL/Utility/Sampling.h"
+#include "SimpleGL/Core/Model.h"
+#include "SimpleGL/Core/ThreadPool.h"
+#include "SimpleGL/Core/Timer.h"
+
+namespace SGL::Utility {
+
+    struct AOCacheHeader {
+        uint32_t magic = 0x4F414753; // "SGAO"
+        uint32_t version = 1;
+        uint64_t key = 0;
+        uint64_t count = 0;
+    };
+
+    static Filepath getCachePath(Filepath const& directory, uint64_t key) noexcept {
+        char name[32];
+        std::snprintf(name, sizeof(name), "ao_%016llx.bin", static_cast<unsigned long long>(key));
+        return directory / name;
+    }
+
+    static bool loadCache(Filepath const& directory, uint64_t key, size_t count, std::vector<float>& ao) noexcept {
+        if (directory.empty()) return false;
+        Filepath const path = getCachePath(directory, key);
+        std::error_code error;
+        if (!std::filesystem::exists(path, error)) return false;
+
+        std::string const data = readFile(path);
+        AOCacheHeader expected;
+        expected.key = key;
+        expected.count = count;
+        if (data.size() != sizeof(AOCacheHeader) + count * sizeof(float)) return false;
+        AOCacheHeader header;
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (header.magic != expected.magic || header.version != expected.version || header.key != key || header.count != count) return false;
+
+        ao.resize(count);
+        std::memcpy(ao.data(), data.data() + sizeof(header), count * sizeof(float));
+        return true;
+    }
+
+    static void saveCache(Filepath const& directory, uint64_t key, std::vector<float> const& ao) noexcept {
+        if (directory.empty()) return;
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+
+        AOCacheHeader header;
+        header.key = key;
+        header.count = ao.size();
+        std::vector<char> data(sizeof(header) + ao.size() * sizeof(float));
+        std::memcpy(data.data(), &header, sizeof(header));
+        std::memcpy(data.data() + sizeof(header), ao.data(), ao.size() * sizeof(float));
+        writeFile(getCachePath(directory, key), data.data(), data.size());
+    }
+
+    struct AOSample {
+        glm::vec3 position;
+        /*
+        *   Zero for samples without a surface, those stay fully open
+        */
+        glm::vec3 normal;
+    };
+
+    static void traceAOSamples(TriangleBVH const& scene, AOBakeOption const& option, std::vector<AOSample> const& samples, std::vector<float>& visibility) noexcept {
+        visibility.assign(samples.size(), 1.0f);
+        if (scene.nodes.empty() || option.sampleCount == 0) return;
+        uint32_t const seedHash = hashPCG(option.seed);
+        float const invSampleCount = 1.0f / option.sampleCount;
+
+        auto traceRange = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                AOSample const& sample = samples[i];
+                if (sample.normal == glm::vec3(0.0f)) continue;
+                glm::vec3 const origin = offsetRayOrigin(sample.position, sample.normal);
+                uint32_t open = 0;
+                for (uint32_t s = 0; s < option.sampleCount; ++s) {
+                    HashSampler sampler{ hashPCG(i + hashPCG(s + seedHash)) };
+                    float const u1 = sampler.next();
+                    float const u2 = sampler.next();
+                    Ray const ray = { origin, sampleCosineHemisphere(sample.normal, u1, u2), 0.0f, option.maxDistance };
+                    if (!occluded(scene, ray)) ++open;
+                }
+                visibility[i] = open * invSampleCount;
+            }
+        };
+
+        uint32_t const count = static_cast<uint32_t>(samples.size());
+        if (option.parallel) {
+            ThreadPool::instance().parallelFor(0, count, 256, traceRange);
+        }
+        else {
+            traceRange(0, count);
+        }
+    }
+
+    std::unique_ptr<AOBaker> AOBaker::build(std::vector<glm::vec3> const& vertices, AOBakeOption const& option) noexcept {
+        auto baker = std::make_unique<AOBaker>();
+        baker->option = option;
+        baker->scene = TriangleBVH::build(vertices);
+        baker->sceneHash = hashArray(vertices);
+        return baker;
+    }
+
+    std::unique_ptr<AOBaker> AOBaker::build(Model const& model, AOBakeOption const& option) noexcept {
+        std::vector<glm::vec3> vertices;
+        model.getRetainedTriangles(vertices);
+        if (vertices.empty()) {
+            SGL_LOG_WARN("AO baker found no triangles, load the model with retainGeometry");
+        }
+        return build(vertices, option);
+    }
+
+    void AOBaker::bakeVertices(std::vector<glm::vec3> const& positions, std::vector<uint32_t> const& indices, std::vector<float>& ao) const noexcept {
+        uint64_t key = hashBytes("vertex", 6, sceneHash);
+        key = hashArray(positions, key);
+        key = hashArray(indices, key);
+        key = hashBytes(&option.sampleCount, sizeof(option.sampleCount), key);
+        key = hashBytes(&option.maxDistance, sizeof(option.maxDistance), key);
+        key = hashBytes(&option.seed, sizeof(option.seed), key);
+        if (loadCache(option.cacheDirectory, key, positions.size(), ao)) return;
+
+        Timer timer;
+        // area weighted normals, the cross product length is twice the triangle area
+        std::vector<AOSample> samples(positions.size(), { glm::vec3(0.0f), glm::vec3(0.0f) });
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            glm::vec3 const& p0 = positions[indices[i + 0]];
+            glm::vec3 const& p1 = positions[indices[i + 1]];
+            glm::vec3 const& p2 = positions[indices[i + 2]];
+            glm::vec3 const n = glm::cross(p1 - p0, p2 - p0);
+            for (size_t j = 0; j < 3; ++j) {
+                samples[indices[i + j]].normal += n;
+            }
+        }
+        for (size_t i = 0; i < positions.size(); ++i) {
+            samples[i].position = positions[i];
+            float const length = glm::length(samples[i].normal);
+            samples[i].normal = length > 0.0f ? samples[i].normal / length : glm::vec3(0.0f);
+        }
+
+        traceAOSamples(*scene, option, samples, ao);
+        timer.update();
+        SGL_LOG_INFO("Baked AO for {0} vertices in {1:.3f}s", positions.size(), timer.getDeltaTime());
+        saveCache(option.cacheDirectory, key, ao);
+    }
+
+    void AOBaker::bakeVertices(Mesh const& mesh, std::vector<float>& ao) const noexcept {
+        bakeVertices(mesh.positions, mesh.indices, ao);
+    }
+
+    void AOBaker::bakeTexels(
+        std::vector<glm::vec3> const& positions,
+        std::vector<glm::vec2> const& texcoords,
+        std::vector<uint32_t> const& indices,
+        std::vector<float>& ao) const noexcept {
+        uint32_t const size = option.textureSize;
+        if (texcoords.size() != positions.size()) {
+            SGL_LOG_WARN("AO baker needs one texcoord per position");
+            ao.assign(static_cast<size_t>(size) * size, 1.0f);
+            return;
+        }
+
+        uint64_t key = hashBytes("texel", 5, sceneHash);
+        key = hashArray(positions, key);
+        key = hashArray(texcoords, key);
+        key = hashArray(indices, key);
+        key = hashBytes(&option.sampleCount, sizeof(option.sampleCount), key);
+        key = hashBytes(&option.maxDistance, sizeof(option.maxDistance), key);
+        key = hashBytes(&option.textureSize, sizeof(option.textureSize), key);
+        key = hashBytes(&option.dilation, sizeof(option.dilation), key);
+        key = hashBytes(&option.seed, sizeof(option.seed), key);
+        if (loadCache(option.cacheDirectory, key, static_cast<size_t>(size) * size, ao)) return;
+
+        Timer timer;
+        // rasterize every triangle in uv space, a texel belongs to the triangle covering its center
+        std::vector<int32_t> texelSample(static_cast<size_t>(size) * size, -1);
+        std::vector<AOSample> samples;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            glm::vec3 const& p0 = positions[indices[i + 0]];
+            glm::vec3 const& p1 = positions[indices[i + 1]];
+            glm::vec3 const& p2 = positions[indices[i + 2]];
+            glm::vec2 const t0 = texcoords[indices[i + 0]] * static_cast<float>(size);
+            glm::vec2 const t1 = texcoords[indices[i + 1]] * static_cast<float>(size);
+            glm::vec2 const t2 = texcoords[indices[i + 2]] * static_cast<float>(size);
+
+            float const area = (t1.x - t0.x) * (t2.y - t0.y) - (t1.y - t0.y) * (t2.x - t0.x);
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float const length = glm::length(normal);
+            if (area == 0.0f || length == 0.0f) continue;
+            normal /= length;
+
+            glm::vec2 const lo = glm::max(glm::floor(glm::min(glm::min(t0, t1), t2)), glm::vec2(0.0f));
+            glm::vec2 const hi = glm::min(glm::ceil(glm::max(glm::max(t0, t1), t2)), glm::vec2(static_cast<float>(size)));
+            for (uint32_t y = static_cast<uint32_t>(lo.y); y < static_cast<uint32_t>(hi.y); ++y) {
+                for (uint32_t x = static_cast<uint32_t>(lo.x); x < static_cast<uint32_t>(hi.x); ++x) {
+                    glm::vec2 const p(x + 0.5f, y + 0.5f);
+                    float const w0 = ((t1.x - p.x) * (t2.y - p.y) - (t1.y - p.y) * (t2.x - p.x)) / area;
+                    float const w1 = ((t2.x - p.x) * (t0.y - p.y) - (t2.y - p.y) * (t0.x - p.x)) / area;
+                    float const w2 = 1.0f - w0 - w1;
+                    if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+
+                    size_t const texel = static_cast<size_t>(y) * size + x;
+                    AOSample const sample = { p0 * w0 + p1 * w1 + p2 * w2, normal };
+                    if (texelSample[texel] < 0) {
+                        texelSample[texel] = static_cast<int32_t>(samples.size());
+                        samples.push_back(sample);
+                    }
+                    else {
+                        samples[texelSample[texel]] = sample;
+                    }
+                }
+            }
+        }
+
+        std::vector<float> visibility;
+        traceAOSamples(*scene, option, samples, visibility);
+
+        ao.assign(static_cast<size_t>(size) * size, 1.0f);
+        std::vector<uint8_t> covered(ao.size(), 0);
+        for (size_t texel = 0; texel < ao.size(); ++texel) {
+            if (texelSample[texel] < 0) continue;
+            ao[texel] = visibility[texelSample[texel]];
+            covered[texel] = 1;
+        }
+
+        // each pass fills empty texels with the mean of their covered neighbours
+        std::vector<uint8_t> nextCovered;
+        for (uint32_t pass = 0; pass < option.dilation; ++pass) {
+            nextCovered = covered;
+            for (uint32_t y = 0; y < size; ++y) {
+                for (uint32_t x = 0; x < size; ++x) {
+                    size_t const texel = static_cast<size_t>(y) * size + x;
+                    if (covered[texel]) continue;
+                    float sum = 0.0f;
+                    uint32_t count = 0;
+                    for (int dy = -1; dy <= 1; ++dy) {
+                        for (int dx = -1; dx <= 1; ++dx) {
+                            int const nx = static_cast<int>(x) + dx;
+                            int const ny = static_cast<int>(y) + dy;
+                            if (nx < 0 || ny < 0 || nx >= static_cast<int>(size) || ny >= static_cast<int>(size)) continue;
+                            size_t const neighbour = static_cast<size_t>(ny) * size + nx;
+                            if (!covered[neighbour]) continue;
+                            sum += ao[neighbour];
+                            ++count;
+                        }
+                    }
+                    if (count == 0) continue;
+                    ao[texel] = sum / count;
+                    nextCovered[texel] = 1;
+                }
+            }
+            covered.swap(nextCovered);
+        }
+
+        timer.update();
+        SGL_LOG_INFO("Baked AO for {0} texels in {1:.3f}s", samples.size(), timer.getDeltaTime());
+        saveCache(option.cacheDirectory, key, ao);
+    }
+
+    void AOBaker::bakeTexels(Mesh const& mesh, std::vector<float>& ao) const noexcept {
+        bakeTexels(mesh.positions, mesh.texcoords, mesh.indices, ao);
+    }
+
+    std::unique_ptr<VertexBuffer> AOBaker::createVertexStream(std::vector<float> const& ao) noexcept {
+        return std::make_unique<VertexBuffer>(
+            const_cast<float*>(ao.data()),
+            static_cast<uint32_t>(ao.size() * sizeof(float)),
+            VertexBufferLayout{ {DataType::Float} });
+    }
+
+    std::unique_ptr<Texture2D> AOBaker::createTexture(std::vector<float> const& ao, uint32_t size) noexcept {
+        return std::make_unique<Texture2D>(size, size, InternalFormat::FloatRED, const_cast<float*>(ao.data()));
+    }
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "SimpleGL/Utility/TriangleBVH.h"
+#include "SimpleGL/Core/IO.h"
+
+namespace SGL {
+
+    struct Model;
+    struct Mesh;
+    struct VertexBuffer;
+    struct Texture2D;
+
+}
+
+namespace SGL::Utility {
+
+    struct AOBakeOption {
+        /*
+        *   Occlusion rays per vertex or texel, cosine distributed over the hemisphere
+        */
+        uint32_t sampleCount = 64;
+        /*
+        *   Occluders farther than this, in model space, do not darken a sample
+        */
+        float maxDistance = 1.0f;
+        /*
+        *   Resolution of texel bakes, texcoords are expected in [0, 1]
+        */
+        uint32_t textureSize = 512;
+        /*
+        *   Rings of empty texels around covered ones that are filled from their neighbours,
+        *   keeps bilinear filtering from pulling in unbaked texels at chart borders
+        */
+        uint32_t dilation = 2;
+        uint32_t seed = 0;
+        bool parallel = true;
+        /*
+        *   Results are stored here keyed by a hash of the scene, the mesh and these options, empty disables the cache
+        */
+        Filepath cacheDirectory;
+    };
+
+    /*
+    *   Ambient occlusion baker, values are visibility in [0, 1] where 1 is fully open
+    */
+    struct AOBaker {
+
+        AOBakeOption option;
+        /*
+        *   Every triangle that can occlude, in model space
+        */
+        std::unique_ptr<TriangleBVH> scene;
+        uint64_t sceneHash = 0;
+
+        AOBaker() = default;
+        ~AOBaker() = default;
+
+        AOBaker(AOBaker const&) = delete;
+        AOBaker(AOBaker&& other) = delete;
+
+        AOBaker& operator=(AOBaker const&) = delete;
+        AOBaker& operator=(AOBaker&& other) = delete;
+
+        /*
+        *   Occluders are given as vertex triples
+        */
+        static std::unique_ptr<AOBaker> build(std::vector<glm::vec3> const& vertices, AOBakeOption const& option = AOBakeOption()) noexcept;
+
+        /*
+        *   All meshes of the model occlude each other, see ModelLoadOption::retainGeometry
+        */
+        static std::unique_ptr<AOBaker> build(Model const& model, AOBakeOption const& option = AOBakeOption()) noexcept;
+
+        /*
+        *   One value per position, sampled around area weighted vertex normals
+        */
+        void bakeVertices(std::vector<glm::vec3> const& positions, std::vector<uint32_t> const& indices, std::vector<float>& ao) const noexcept;
+        void bakeVertices(Mesh const& mesh, std::vector<float>& ao) const noexcept;
+
+        /*
+        *   textureSize * textureSize values, row 0 at texcoord v = 0 as glTexImage2D expects
+        */
+        void bakeTexels(
+            std::vector<glm::vec3> const& positions,
+            std::vector<glm::vec2> const& texcoords,
+            std::vector<uint32_t> const& indices,
+            std::vector<float>& ao) const noexcept;
+        void bakeTexels(Mesh const& mesh, std::vector<float>& ao) const noexcept;
+
+        /*
+        *   Per vertex stream with a single float attribute, bind it after the mesh with
+        *   bindInstanceAttributes(location, 0) so it advances per vertex
+        */
+        static std::unique_ptr<VertexBuffer> createVertexStream(std::vector<float> const& ao) noexcept;
+        static std::unique_ptr<Texture2D> createTexture(std::vector<float> const& ao, uint32_t size) noexcept;
+
+    };
+
+}
@@ -1,6 +1,10 @@
 #include "PCH.h"
 
 #include "SimpleGL/Utility/BVH.h"
+#include "SimpleGL/Utility/BVHCache.h"
+#include "SimpleGL/Core/MappedFile.h"
+#include "SimpleGL/Core/Timer.h"
+#include "SimpleGL/Core/ThreadPool.h"
 
 namespace SGL::Utility {
 
@@ -33,123 +37,776 @@ namespace SGL::Utility {
         max = glm::vec3(-std::numeric_limits<float>::max());
     }
 
-    static void updateNodeBound(std::vector<BVHPrimitive*> const& prims, std::vector<BVHNode>& nodes, uint32_t nodeIdx) noexcept {
-        auto& node = nodes[nodeIdx];
-        node.bound.reset();
-        for (uint32_t i = 0; i < node.primCount; ++i) {
-            node.bound.append(prims[i]->getBound());
+    float BoundingBoxAABB::getDistance2(glm::vec3 const& point) const noexcept {
+        glm::vec3 d = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+
+    glm::vec3 BVHPrimitive::closestPoint(glm::vec3 const& point) const noexcept {
+        BoundingBoxAABB bound = getBound();
+        return glm::clamp(point, bound.min, bound.max);
+    }
+
+    static constexpr uint32_t BVH_MAX_BIN_COUNT = 64;
+    /*
+    *   Nodes with no more primitives are built as independent subtree tasks,
+    *   fixed so that the node order does not depend on the thread count
+    */
+    static constexpr uint32_t BVH_SUBTREE_TASK_SIZE = 1 << 12;
+    /*
+    *   Chunk size for binning and partitioning large nodes in parallel
+    */
+    static constexpr uint32_t BVH_PARALLEL_GRAIN = 1 << 14;
+
+    struct BVHBuildContext {
+        std::vector<BoundingBoxAABB> const& bounds;
+        std::vector<glm::vec3> const& centers;
+        std::vector<uint32_t>& order;
+        std::vector<BVHNode>& nodes;
+        BVHBuildOption const& option;
+        /*
+        *   Pool for splitting large nodes, null when building serially
+        */
+        ThreadPool* pool;
+        /*
+        *   Subtree roots left for tasks, null inside a subtree task
+        */
+        std::vector<uint32_t>* deferred;
+
+        bool isParallel(uint32_t count) const noexcept {
+            return pool && count >= BVH_PARALLEL_GRAIN * 2;
         }
+    };
+
+    struct BVHSplit {
+        int axis = -1;
+        /*
+        *   Primitives with centroid below pivot go to the left child,
+        *   for binned split the bin index is compared instead to match the evaluated bins exactly
+        */
+        float pivot = 0.0f;
+        uint32_t bin = 0;
+        float binOrigin = 0.0f;
+        float binScale = 0.0f;
+        float cost = std::numeric_limits<float>::max();
+    };
+
+    struct BVHBin {
+        BoundingBoxAABB bound;
+        uint32_t count = 0;
+    };
+
+    using BVHBinSet = std::array<std::array<BVHBin, BVH_MAX_BIN_COUNT>, 3>;
+
+    static inline uint32_t getBinCount(BVHBuildOption const& option) noexcept {
+        return std::clamp(option.binCount, 2U, BVH_MAX_BIN_COUNT);
     }
 
-    static float evaluateSAH(std::vector<BVHPrimitive*> const& prims, std::vector<BVHNode> const& nodes, uint32_t nodeIdx, std::vector<glm::vec3>& centers, int axis, float pivot) noexcept {
-        auto const& node = nodes[nodeIdx];
-        BoundingBoxAABB leftBox, rightBox;
-        int leftCount = 0;
-        int rightCount = 0;
-        for (uint32_t i = 0; i < node.primCount; ++i) {
-            if (centers[node.firstPrim + i][axis] < pivot) {
-                ++leftCount;
-                leftBox.append(prims[node.firstPrim + i]->getBound());
+    static inline uint32_t getBinIndex(float c, float origin, float scale, uint32_t binCount) noexcept {
+        return std::min(binCount - 1, static_cast<uint32_t>((c - origin) * scale));
+    }
+
+    static void computeRangeBound(BVHBuildContext const& ctx, uint32_t first, uint32_t count, BoundingBoxAABB& bound, BoundingBoxAABB& centroidBound) noexcept {
+        auto reduce = [&](uint32_t begin, uint32_t end, BoundingBoxAABB& b, BoundingBoxAABB& cb) {
+            for (uint32_t i = begin; i < end; ++i) {
+                b.append(ctx.bounds[ctx.order[i]]);
+                cb.append(ctx.centers[ctx.order[i]]);
             }
-            else {
-                ++rightCount;
-                rightBox.append(prims[node.firstPrim + i]->getBound());
+        };
+
+        if (!ctx.isParallel(count)) {
+            reduce(first, first + count, bound, centroidBound);
+            return;
+        }
+
+        uint32_t chunkCount = (count + BVH_PARALLEL_GRAIN - 1) / BVH_PARALLEL_GRAIN;
+        std::vector<BoundingBoxAABB> chunkBounds(chunkCount), chunkCentroidBounds(chunkCount);
+        ctx.pool->parallelFor(first, first + count, BVH_PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end) {
+            uint32_t chunk = (begin - first) / BVH_PARALLEL_GRAIN;
+            reduce(begin, end, chunkBounds[chunk], chunkCentroidBounds[chunk]);
+        });
+        for (uint32_t i = 0; i < chunkCount; ++i) {
+            bound.append(chunkBounds[i]);
+            centroidBound.append(chunkCentroidBounds[i]);
+        }
+    }
+
+    /*
+    *   Stable partition of the primitive range, chunked prefix sum scatter for large nodes
+    */
+    template<typename Predicate>
+    static uint32_t partitionRange(BVHBuildContext& ctx, uint32_t first, uint32_t count, Predicate const& pred) noexcept {
+        auto begin = ctx.order.begin() + first;
+        if (!ctx.isParallel(count)) {
+            return static_cast<uint32_t>(std::stable_partition(begin, begin + count, pred) - begin);
+        }
+
+        uint32_t chunkCount = (count + BVH_PARALLEL_GRAIN - 1) / BVH_PARALLEL_GRAIN;
+        std::vector<uint32_t> leftCounts(chunkCount + 1, 0);
+        ctx.pool->parallelFor(first, first + count, BVH_PARALLEL_GRAIN, [&](uint32_t b, uint32_t e) {
+            uint32_t chunk = (b - first) / BVH_PARALLEL_GRAIN;
+            uint32_t n = 0;
+            for (uint32_t i = b; i < e; ++i) {
+                n += pred(ctx.order[i]) ? 1 : 0;
             }
+            leftCounts[chunk + 1] = n;
+        });
+        for (uint32_t i = 0; i < chunkCount; ++i) {
+            leftCounts[i + 1] += leftCounts[i];
         }
-        float cost = leftCount * leftBox.getArea() + rightCount * rightBox.getArea();
-        return cost > 0 ? cost : std::numeric_limits<float>::max();
+        uint32_t const leftTotal = leftCounts[chunkCount];
+
+        std::vector<uint32_t> scattered(count);
+        ctx.pool->parallelFor(first, first + count, BVH_PARALLEL_GRAIN, [&](uint32_t b, uint32_t e) {
+            uint32_t chunk = (b - first) / BVH_PARALLEL_GRAIN;
+            uint32_t l = leftCounts[chunk];
+            uint32_t r = leftTotal + (b - first) - leftCounts[chunk];
+            for (uint32_t i = b; i < e; ++i) {
+                uint32_t idx = ctx.order[i];
+                scattered[pred(idx) ? l++ : r++] = idx;
+            }
+        });
+        std::copy(scattered.begin(), scattered.end(), begin);
+        return leftTotal;
+    }
+
+    static BVHSplit findMidpointSplit(BoundingBoxAABB const& bound) noexcept {
+        BVHSplit split;
+        glm::vec3 extent = bound.max - bound.min;
+        split.axis = 0;
+        if (extent.y > extent[split.axis]) split.axis = 1;
+        if (extent.z > extent[split.axis]) split.axis = 2;
+        split.pivot = bound.min[split.axis] + extent[split.axis] * 0.5f;
+        return split;
     }
 
-    static void subdivideNode(std::vector<BVHPrimitive*>& prims, std::vector<BVHNode>& nodes, uint32_t nodeIdx, std::vector<glm::vec3>& centers) noexcept {
-        auto& node = nodes[nodeIdx];
-        if (node.primCount <= 2) return;
+    static BVHSplit findSweepSplit(BVHBuildContext const& ctx, uint32_t first, uint32_t count, BoundingBoxAABB const& centroidBound) noexcept {
+        BVHSplit best;
+        std::vector<uint32_t> sorted(ctx.order.begin() + first, ctx.order.begin() + first + count);
+        std::vector<float> rightArea(count);
+        glm::vec3 extent = centroidBound.max - centroidBound.min;
 
-#if defined(SGL_UTILITY_BVH_SPLIT_NAIVE)
-        glm::vec3 extent = node.bound.max - node.bound.min;
-        int axis = 0;
-        if (extent.y > extent.x) axis = 1;
-        if (extent.z > extent.y) axis = 2;
+        for (int a = 0; a < 3; ++a) {
+            if (extent[a] <= 0.0f) continue;
 
-        float splitPivot = node.bound.min[axis] + extent[axis] * 0.5f;
-#else
-        int bestAxis = -1;
-        float bestPivot = 0.0f;
-        float bestSAHCost = std::numeric_limits<float>::max();
+            std::sort(sorted.begin(), sorted.end(), [&](uint32_t l, uint32_t r) {
+                float cl = ctx.centers[l][a];
+                float cr = ctx.centers[r][a];
+                return cl < cr || (cl == cr && l < r);
+            });
 
+            BoundingBoxAABB box;
+            for (uint32_t i = count - 1; i > 0; --i) {
+                box.append(ctx.bounds[sorted[i]]);
+                rightArea[i] = box.getArea();
+            }
+
+            box.reset();
+            for (uint32_t i = 1; i < count; ++i) {
+                box.append(ctx.bounds[sorted[i - 1]]);
+                float pivot = ctx.centers[sorted[i]][a];
+                // primitives sharing the pivot centroid always go right
+                if (ctx.centers[sorted[i - 1]][a] == pivot) continue;
+                float cost = i * box.getArea() + (count - i) * rightArea[i];
+                if (cost < best.cost) {
+                    best.axis = a;
+                    best.pivot = pivot;
+                    best.cost = cost;
+                }
+            }
+        }
+        return best;
+    }
+
+    static BVHSplit findBinnedSplit(BVHBuildContext const& ctx, uint32_t first, uint32_t count, BoundingBoxAABB const& centroidBound) noexcept {
+        BVHSplit best;
+        uint32_t const binCount = getBinCount(ctx.option);
+        glm::vec3 const extent = centroidBound.max - centroidBound.min;
+        glm::vec3 scale;
         for (int a = 0; a < 3; ++a) {
-            for (uint32_t i = 0; i < node.primCount; ++i) {
-                float pivot = centers[i + node.firstPrim][a];
-                float cost = evaluateSAH(prims, nodes, nodeIdx, centers, a, pivot);
-                if (cost < bestSAHCost) {
-                    bestPivot = pivot;
-                    bestAxis = a;
-                    bestSAHCost = cost;
+            scale[a] = extent[a] > 0.0f ? binCount / extent[a] : 0.0f;
+        }
+
+        auto binRange = [&](uint32_t begin, uint32_t end, BVHBinSet& bins) {
+            for (uint32_t i = begin; i < end; ++i) {
+                uint32_t idx = ctx.order[i];
+                glm::vec3 const& c = ctx.centers[idx];
+                for (int a = 0; a < 3; ++a) {
+                    if (scale[a] == 0.0f) continue;
+                    auto& bin = bins[a][getBinIndex(c[a], centroidBound.min[a], scale[a], binCount)];
+                    bin.bound.append(ctx.bounds[idx]);
+                    ++bin.count;
+                }
+            }
+        };
+
+        BVHBinSet bins;
+        if (!ctx.isParallel(count)) {
+            binRange(first, first + count, bins);
+        }
+        else {
+            uint32_t chunkCount = (count + BVH_PARALLEL_GRAIN - 1) / BVH_PARALLEL_GRAIN;
+            std::vector<BVHBinSet> chunkBins(chunkCount);
+            ctx.pool->parallelFor(first, first + count, BVH_PARALLEL_GRAIN, [&](uint32_t b, uint32_t e) {
+                binRange(b, e, chunkBins[(b - first) / BVH_PARALLEL_GRAIN]);
+            });
+            for (auto const& chunk : chunkBins) {
+                for (int a = 0; a < 3; ++a) {
+                    for (uint32_t i = 0; i < binCount; ++i) {
+                        bins[a][i].bound.append(chunk[a][i].bound);
+                        bins[a][i].count += chunk[a][i].count;
+                    }
                 }
             }
         }
 
-        float splitPivot = bestPivot;
-        int axis = bestAxis;
-#endif
+        float leftArea[BVH_MAX_BIN_COUNT];
+        uint32_t leftCount[BVH_MAX_BIN_COUNT];
+        for (int a = 0; a < 3; ++a) {
+            if (scale[a] == 0.0f) continue;
 
-        uint32_t i = node.firstPrim;
-        uint32_t j = i + node.primCount - 1;
-        while (i <= j) {
-            if (centers[i][axis] < splitPivot) {
-                ++i;
+            BoundingBoxAABB box;
+            uint32_t sum = 0;
+            for (uint32_t i = 0; i < binCount - 1; ++i) {
+                box.append(bins[a][i].bound);
+                sum += bins[a][i].count;
+                leftCount[i] = sum;
+                leftArea[i] = sum > 0 ? box.getArea() : 0.0f;
             }
-            else {
-                std::swap(prims[i], prims[j]);
-                std::swap(centers[i], centers[j]);
-                --j;
+
+            box.reset();
+            sum = 0;
+            for (uint32_t i = binCount - 1; i > 0; --i) {
+                box.append(bins[a][i].bound);
+                sum += bins[a][i].count;
+                if (sum == 0 || leftCount[i - 1] == 0) continue;
+                float cost = leftCount[i - 1] * leftArea[i - 1] + sum * box.getArea();
+                if (cost < best.cost) {
+                    best.axis = a;
+                    best.bin = i;
+                    best.binOrigin = centroidBound.min[a];
+                    best.binScale = scale[a];
+                    best.cost = cost;
+                }
             }
         }
+        return best;
+    }
+
+    static void subdivideNode(BVHBuildContext& ctx, uint32_t nodeIdx) noexcept {
+        uint32_t const first = ctx.nodes[nodeIdx].firstPrim;
+        uint32_t const count = ctx.nodes[nodeIdx].primCount;
+
+        if (ctx.deferred && count <= BVH_SUBTREE_TASK_SIZE) {
+            ctx.deferred->push_back(nodeIdx);
+            return;
+        }
+
+        BoundingBoxAABB bound;
+        BoundingBoxAABB centroidBound;
+        computeRangeBound(ctx, first, count, bound, centroidBound);
+        ctx.nodes[nodeIdx].bound = bound;
+
+        if (count <= std::max(ctx.option.minLeafSize, 1U)) return;
+
+        auto const& option = ctx.option;
+        BVHSplit split;
+        switch (option.splitMethod) {
+        case BVHSplitMethod::Midpoint:
+            split = findMidpointSplit(bound); break;
+        case BVHSplitMethod::SAH:
+            split = findSweepSplit(ctx, first, count, centroidBound); break;
+        case BVHSplitMethod::BinnedSAH:
+            split = findBinnedSplit(ctx, first, count, centroidBound); break;
+        case BVHSplitMethod::Linear:
+            // never reached, buildBVHNodes hands Linear to buildLinearBVHNodes
+            break;
+        }
+        if (split.axis < 0) return;
+
+        if (option.splitMethod != BVHSplitMethod::Midpoint && count <= option.maxLeafSize) {
+            float area = bound.getArea();
+            float leafCost = option.intersectCost * count * area;
+            float splitCost = option.traversalCost * area + option.intersectCost * split.cost;
+            if (splitCost >= leafCost) return;
+        }
 
-        uint32_t leftCount = i - node.firstPrim;
-        if (leftCount == 0 || leftCount == node.primCount) return;
+        int const axis = split.axis;
+        uint32_t leftCount = 0;
+        if (option.splitMethod == BVHSplitMethod::BinnedSAH) {
+            uint32_t const binCount = getBinCount(option);
+            leftCount = partitionRange(ctx, first, count, [&](uint32_t idx) {
+                return getBinIndex(ctx.centers[idx][axis], split.binOrigin, split.binScale, binCount) < split.bin;
+            });
+        }
+        else {
+            leftCount = partitionRange(ctx, first, count, [&](uint32_t idx) {
+                return ctx.centers[idx][axis] < split.pivot;
+            });
+        }
+        if (leftCount == 0 || leftCount == count) return;
 
         BVHNode left, right;
 
-        left.firstPrim = node.firstPrim;
+        left.firstPrim = first;
         left.primCount = leftCount;
         left.left = left.right = 0;
-        node.left = nodes.size();
-        nodes.push_back(left);
 
-        right.firstPrim = i;
-        right.primCount = node.primCount - leftCount;
+        right.firstPrim = first + leftCount;
+        right.primCount = count - leftCount;
         right.left = right.right = 0;
-        node.right = nodes.size();
-        nodes.push_back(right);
 
+        uint32_t leftIdx = static_cast<uint32_t>(ctx.nodes.size());
+        ctx.nodes.push_back(left);
+        ctx.nodes.push_back(right);
+
+        auto& node = ctx.nodes[nodeIdx];
+        node.left = leftIdx;
+        node.right = leftIdx + 1;
         node.primCount = 0;
-        updateNodeBound(prims, nodes, node.left);
-        updateNodeBound(prims, nodes, node.right);
 
-        subdivideNode(prims, nodes, node.left, centers);
-        subdivideNode(prims, nodes, node.right, centers);
+        subdivideNode(ctx, leftIdx);
+        subdivideNode(ctx, leftIdx + 1);
     }
 
-    std::unique_ptr<BVH> BVH::build(std::vector<BVHPrimitive*> const& prims) noexcept {
-        auto bvh = std::make_unique<BVH>();
-        bvh->prims = prims;
-        bvh->nodes.reserve(prims.size() * 2 - 1);
+    void buildBVHNodes(
+        std::vector<BoundingBoxAABB> const& bounds,
+        BVHBuildOption const& option,
+        std::vector<BVHNode>& nodes,
+        std::vector<uint32_t>& order) noexcept {
+        if (option.splitMethod == BVHSplitMethod::Linear) {
+            buildLinearBVHNodes(bounds, option, nodes, order);
+            return;
+        }
 
-        std::vector<glm::vec3> centers(prims.size());
-        for (uint32_t i = 0; i < prims.size(); ++i) {
-            centers[i] = prims[i]->getBound().getCenter();
+        uint32_t const primCount = static_cast<uint32_t>(bounds.size());
+        nodes.clear();
+        order.resize(primCount);
+        for (uint32_t i = 0; i < primCount; ++i) {
+            order[i] = i;
         }
+        if (primCount == 0) return;
+
+        ThreadPool* pool = option.parallel ? &ThreadPool::instance() : nullptr;
+        auto forEach = [pool](uint32_t count, uint32_t grain, std::function<void(uint32_t, uint32_t)> const& func) {
+            if (pool) pool->parallelFor(0, count, grain, func);
+            else func(0, count);
+        };
+
+        std::vector<glm::vec3> centers(primCount);
+        forEach(primCount, BVH_PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                centers[i] = bounds[i].getCenter();
+            }
+        });
+
+        nodes.reserve(primCount * 2 - 1);
 
         BVHNode root;
         root.left = root.right = 0;
         root.firstPrim = 0;
-        root.primCount = static_cast<uint32_t>(prims.size());
-        bvh->nodes.push_back(root);
+        root.primCount = primCount;
+        nodes.push_back(root);
+
+        // split the top of the tree until nodes are small enough to become subtree tasks
+        std::vector<uint32_t> deferred;
+        BVHBuildContext ctx{ bounds, centers, order, nodes, option, pool, &deferred };
+        subdivideNode(ctx, 0);
+
+        // subtrees own their node storage, so no node is allocated from the shared vector concurrently
+        std::vector<std::vector<BVHNode>> subtrees(deferred.size());
+        forEach(static_cast<uint32_t>(deferred.size()), 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                auto& local = subtrees[i];
+                local.reserve(nodes[deferred[i]].primCount * 2 - 1);
+                local.push_back(nodes[deferred[i]]);
+                BVHBuildContext subCtx{ bounds, centers, order, local, option, nullptr, nullptr };
+                subdivideNode(subCtx, 0);
+            }
+        });
+
+        // splice in task order, so the layout is the same for any thread count
+        for (uint32_t i = 0; i < deferred.size(); ++i) {
+            auto const& local = subtrees[i];
+            uint32_t offset = static_cast<uint32_t>(nodes.size()) - 1;
+            for (size_t j = 0; j < local.size(); ++j) {
+                BVHNode node = local[j];
+                if (!node.isLeaf()) {
+                    node.left += offset;
+                    node.right += offset;
+                }
+                if (j == 0) {
+                    nodes[deferred[i]] = node;
+                }
+                else {
+                    nodes.push_back(node);
+                }
+            }
+        }
+    }
+
+    BVHBuildStats computeBVHStats(std::vector<BVHNode> const& nodes, BVHBuildOption const& option) noexcept {
+        BVHBuildStats stats;
+        if (nodes.empty()) return stats;
+
+        float rootArea = nodes[0].bound.getArea();
+        float invRootArea = rootArea > 0.0f ? 1.0f / rootArea : 0.0f;
+
+        std::vector<std::pair<uint32_t, uint32_t>> stack = { { 0, 1 } };
+        while (!stack.empty()) {
+            auto [idx, depth] = stack.back();
+            stack.pop_back();
+
+            auto const& node = nodes[idx];
+            float area = rootArea > 0.0f ? node.bound.getArea() * invRootArea : 1.0f;
+            ++stats.nodeCount;
+            stats.maxDepth = std::max(stats.maxDepth, depth);
+            if (node.isLeaf()) {
+                ++stats.leafCount;
+                stats.sahCost += option.intersectCost * node.primCount * area;
+            }
+            else {
+                stats.sahCost += option.traversalCost * area;
+                stack.push_back({ node.right, depth + 1 });
+                stack.push_back({ node.left, depth + 1 });
+            }
+        }
+        return stats;
+    }
+
+    /*
+    *   SAH cost of every subtree over its root area, children always come after their parent
+    */
+    static void computeSubtreeQuality(std::vector<BVHNode> const& nodes, BVHBuildOption const& option, std::vector<float>& quality) noexcept {
+        std::vector<float> costs(nodes.size());
+        quality.resize(nodes.size());
+        for (size_t i = nodes.size(); i-- > 0;) {
+            auto const& node = nodes[i];
+            float area = node.bound.getArea();
+            costs[i] = node.isLeaf()
+                ? option.intersectCost * node.primCount * area
+                : option.traversalCost * area + costs[node.left] + costs[node.right];
+            quality[i] = area > 0.0f ? costs[i] / area : 0.0f;
+        }
+    }
 
-        updateNodeBound(bvh->prims, bvh->nodes, 0);
-        subdivideNode(bvh->prims, bvh->nodes, 0, centers);
+    /*
+    *   Nodes are copied out of the mapping, the BVH stays refittable and its primitive pointers are rebuilt from order anyway
+    */
+    static bool loadCachedBVHNodes(Filepath const& directory, uint64_t key, size_t primCount, std::vector<BVHNode>& nodes, std::vector<uint32_t>& order) noexcept {
+        BVHCacheHeader header;
+        auto file = openBVHCache(directory, key, BVHCacheKind::BVH, sizeof(BVHNode), sizeof(uint32_t), header);
+        if (!file || header.inputCount != primCount || header.primCount != primCount || header.nodeCount == 0) return false;
+
+        auto bytes = static_cast<uint8_t const*>(file->data);
+        order.resize(primCount);
+        std::memcpy(order.data(), bytes + header.primOffset, primCount * sizeof(uint32_t));
+        for (uint32_t prim : order) {
+            if (prim >= primCount) return false;
+        }
+        nodes.resize(header.nodeCount);
+        std::memcpy(nodes.data(), bytes + header.nodeOffset, nodes.size() * sizeof(BVHNode));
+        // every child in range and referenced once, never the root, so traversal from the root stays a tree
+        std::vector<uint8_t> referenced(nodes.size(), 0);
+        referenced[0] = 1;
+        bool valid = true;
+        for (size_t i = 0; i < nodes.size() && valid; ++i) {
+            BVHNode const& node = nodes[i];
+            if (node.isLeaf()) {
+                valid = node.firstPrim <= primCount && node.primCount <= primCount - node.firstPrim;
+                continue;
+            }
+            for (uint32_t child : { node.left, node.right }) {
+                valid = valid && child < nodes.size() && !referenced[child];
+                if (valid) referenced[child] = 1;
+            }
+        }
+        if (!valid) {
+            SGL_LOG_WARN("Ignoring damaged BVH cache {0:x}", key);
+            return false;
+        }
+        return true;
+    }
+
+    std::unique_ptr<BVH> BVH::build(std::vector<BVHPrimitive*> const& prims, BVHBuildOption const& option) noexcept {
+        Timer timer;
+        auto bvh = std::make_unique<BVH>();
+
+        std::vector<BoundingBoxAABB> bounds(prims.size());
+        auto computeBounds = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                bounds[i] = prims[i]->getBound();
+            }
+        };
+        if (option.parallel) {
+            ThreadPool::instance().parallelFor(0, static_cast<uint32_t>(prims.size()), BVH_PARALLEL_GRAIN, computeBounds);
+        }
+        else {
+            computeBounds(0, static_cast<uint32_t>(prims.size()));
+        }
+
+        std::vector<uint32_t> order;
+        bool const useCache = !option.cacheDirectory.empty() && !prims.empty();
+        uint64_t const cacheKey = useCache ? getBVHCacheKey(BVHCacheKind::BVH, bounds.data(), bounds.size() * sizeof(BoundingBoxAABB), option) : 0;
+        bool const cached = useCache && loadCachedBVHNodes(option.cacheDirectory, cacheKey, prims.size(), bvh->nodes, order);
+        if (!cached) {
+            buildBVHNodes(bounds, option, bvh->nodes, order);
+        }
+
+        bvh->prims.resize(prims.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            bvh->prims[i] = prims[order[i]];
+        }
+
+        timer.update();
+        bvh->option = option;
+        bvh->stats = computeBVHStats(bvh->nodes, option);
+        bvh->stats.buildTime = timer.getDeltaTime();
+        computeSubtreeQuality(bvh->nodes, option, bvh->buildQuality);
+
+        if (useCache && !cached) {
+            BVHCacheHeader header;
+            header.kind = BVHCacheKind::BVH;
+            header.key = cacheKey;
+            header.inputCount = prims.size();
+            header.nodeSize = sizeof(BVHNode);
+            header.nodeCount = bvh->nodes.size();
+            header.primSize = sizeof(uint32_t);
+            header.primCount = order.size();
+            header.sahCost = bvh->stats.sahCost;
+            header.leafCount = bvh->stats.leafCount;
+            header.maxDepth = bvh->stats.maxDepth;
+            saveBVHCache(option.cacheDirectory, header, bvh->nodes.data(), order.data());
+        }
 
         return bvh;
     }
 
+    static inline float getDegradation(float quality, float reference) noexcept {
+        return reference > 0.0f ? quality / reference : 1.0f;
+    }
+
+    /*
+    *   Pick the smallest subtrees explaining the degradation, a node is only rebuilt if none of its children degraded
+    */
+    static void collectDegradedSubtrees(BVH const& bvh, std::vector<float> const& quality, float threshold, uint32_t nodeIdx, std::vector<uint32_t>& roots) noexcept {
+        auto const& node = bvh.nodes[nodeIdx];
+        if (node.isLeaf() || getDegradation(quality[nodeIdx], bvh.buildQuality[nodeIdx]) <= threshold) return;
+
+        bool leftDegraded = getDegradation(quality[node.left], bvh.buildQuality[node.left]) > threshold;
+        bool rightDegraded = getDegradation(quality[node.right], bvh.buildQuality[node.right]) > threshold;
+        if (!leftDegraded && !rightDegraded) {
+            roots.push_back(nodeIdx);
+            return;
+        }
+        if (leftDegraded) collectDegradedSubtrees(bvh, quality, threshold, node.left, roots);
+        if (rightDegraded) collectDegradedSubtrees(bvh, quality, threshold, node.right, roots);
+    }
+
+    /*
+    *   Rebuild the subtree into new nodes appended at the end, its old nodes become unreachable
+    */
+    static void rebuildSubtree(BVH& bvh, uint32_t rootIdx) noexcept {
+        uint32_t first = std::numeric_limits<uint32_t>::max();
+        uint32_t count = 0;
+        std::vector<uint32_t> stack = { rootIdx };
+        while (!stack.empty()) {
+            auto const& node = bvh.nodes[stack.back()];
+            stack.pop_back();
+            if (node.isLeaf()) {
+                first = std::min(first, node.firstPrim);
+                count += node.primCount;
+            }
+            else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+
+        std::vector<BoundingBoxAABB> bounds(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            bounds[i] = bvh.prims[first + i]->getBound();
+        }
+
+        std::vector<BVHNode> local;
+        std::vector<uint32_t> order;
+        buildBVHNodes(bounds, bvh.option, local, order);
+
+        std::vector<BVHPrimitive*> reordered(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            reordered[i] = bvh.prims[first + order[i]];
+        }
+        std::copy(reordered.begin(), reordered.end(), bvh.prims.begin() + first);
+
+        uint32_t offset = static_cast<uint32_t>(bvh.nodes.size()) - 1;
+        for (size_t j = 0; j < local.size(); ++j) {
+            BVHNode node = local[j];
+            if (node.isLeaf()) {
+                node.firstPrim += first;
+            }
+            else {
+                node.left += offset;
+                node.right += offset;
+            }
+            if (j == 0) {
+                bvh.nodes[rootIdx] = node;
+            }
+            else {
+                bvh.nodes.push_back(node);
+            }
+        }
+    }
+
+    /*
+    *   Drop unreachable nodes, children are emitted as adjacent pairs after their parent like the builder does
+    */
+    static void compactNodes(BVH& bvh, std::vector<float>& reference) noexcept {
+        std::vector<BVHNode> nodes;
+        std::vector<float> compactReference;
+        nodes.reserve(bvh.nodes.size());
+        compactReference.reserve(bvh.nodes.size());
+        nodes.push_back(bvh.nodes[0]);
+        compactReference.push_back(reference[0]);
+
+        std::vector<uint32_t> stack = { 0 };
+        while (!stack.empty()) {
+            uint32_t idx = stack.back();
+            stack.pop_back();
+            BVHNode& node = nodes[idx];
+            if (node.isLeaf()) continue;
+
+            uint32_t left = node.left;
+            uint32_t right = node.right;
+            uint32_t newLeft = static_cast<uint32_t>(nodes.size());
+            node.left = newLeft;
+            node.right = newLeft + 1;
+            nodes.push_back(bvh.nodes[left]);
+            nodes.push_back(bvh.nodes[right]);
+            compactReference.push_back(reference[left]);
+            compactReference.push_back(reference[right]);
+            stack.push_back(newLeft + 1);
+            stack.push_back(newLeft);
+        }
+        bvh.nodes = std::move(nodes);
+        reference = std::move(compactReference);
+    }
+
+    void BVH::refit(BVHRefitOption const& refitOption) noexcept {
+        Timer timer;
+        if (nodes.empty()) return;
+
+        auto refitLeaves = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                auto& node = nodes[i];
+                if (!node.isLeaf()) continue;
+                node.bound.reset();
+                for (uint32_t j = 0; j < node.primCount; ++j) {
+                    node.bound.append(prims[node.firstPrim + j]->getBound());
+                }
+            }
+        };
+        if (refitOption.parallel) {
+            ThreadPool::instance().parallelFor(0, static_cast<uint32_t>(nodes.size()), BVH_PARALLEL_GRAIN / 16, refitLeaves);
+        }
+        else {
+            refitLeaves(0, static_cast<uint32_t>(nodes.size()));
+        }
+
+        // children always come after their parent, so a reverse sweep is bottom-up
+        for (size_t i = nodes.size(); i-- > 0;) {
+            auto& node = nodes[i];
+            if (node.isLeaf()) continue;
+            node.bound = nodes[node.left].bound;
+            node.bound.append(nodes[node.right].bound);
+        }
+
+        std::vector<float> quality;
+        computeSubtreeQuality(nodes, option, quality);
+
+        std::vector<uint32_t> roots;
+        if (refitOption.rebuildThreshold > 0.0f) {
+            collectDegradedSubtrees(*this, quality, refitOption.rebuildThreshold, 0, roots);
+        }
+
+        if (!roots.empty()) {
+            // rebuilt subtrees get a fresh reference, NaN marks them through compaction
+            std::vector<float> reference = buildQuality;
+            for (uint32_t root : roots) {
+                rebuildSubtree(*this, root);
+            }
+            reference.resize(nodes.size(), std::numeric_limits<float>::quiet_NaN());
+            for (uint32_t root : roots) {
+                std::vector<uint32_t> stack = { root };
+                while (!stack.empty()) {
+                    auto const& node = nodes[stack.back()];
+                    reference[stack.back()] = std::numeric_limits<float>::quiet_NaN();
+                    stack.pop_back();
+                    if (!node.isLeaf()) {
+                        stack.push_back(node.left);
+                        stack.push_back(node.right);
+                    }
+                }
+            }
+            compactNodes(*this, reference);
+            computeSubtreeQuality(nodes, option, quality);
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                if (std::isnan(reference[i])) reference[i] = quality[i];
+            }
+            buildQuality = std::move(reference);
+        }
+
+        double buildTime = stats.buildTime;
+        stats = computeBVHStats(nodes, option);
+        stats.buildTime = buildTime;
+        stats.degradation = getDegradation(quality[0], buildQuality[0]);
+        stats.rebuiltSubtreeCount = static_cast<uint32_t>(roots.size());
+        timer.update();
+        stats.refitTime = timer.getDeltaTime();
+    }
+
+    static void flattenNode(std::vector<BVHNode> const& nodes, uint32_t nodeIdx, std::vector<FlatBVHNode>& flatNodes, std::vector<uint32_t>& flatOrder) noexcept {
+        auto const& node = nodes[nodeIdx];
+        uint32_t flatIdx = static_cast<uint32_t>(flatNodes.size());
+
+        FlatBVHNode flatNode;
+        flatNode.min = node.bound.min;
+        flatNode.max = node.bound.max;
+        flatNode.primCount = node.primCount;
+        flatNode.offset = 0;
+        flatNodes.push_back(flatNode);
+
+        if (node.isLeaf()) {
+            flatNodes[flatIdx].offset = static_cast<uint32_t>(flatOrder.size());
+            for (uint32_t i = 0; i < node.primCount; ++i) {
+                flatOrder.push_back(node.firstPrim + i);
+            }
+            return;
+        }
+
+        flattenNode(nodes, node.left, flatNodes, flatOrder);
+        flatNodes[flatIdx].offset = static_cast<uint32_t>(flatNodes.size());
+        flattenNode(nodes, node.right, flatNodes, flatOrder);
+    }
+
+    void flattenBVHNodes(std::vector<BVHNode> const& nodes, std::vector<FlatBVHNode>& flatNodes, std::vector<uint32_t>& flatOrder) noexcept {
+        flatNodes.clear();
+        flatOrder.clear();
+        if (nodes.empty()) return;
+
+        flatNodes.reserve(nodes.size());
+        flattenNode(nodes, 0, flatNodes, flatOrder);
+    }
+
+    std::unique_ptr<FlatBVH> FlatBVH::flatten(BVH const& bvh) noexcept {
+        auto flat = std::make_unique<FlatBVH>();
+
+        std::vector<uint32_t> flatOrder;
+        flattenBVHNodes(bvh.nodes, flat->nodes, flatOrder);
+        flat->prims.resize(flatOrder.size());
+        for (size_t i = 0; i < flatOrder.size(); ++i) {
+            flat->prims[i] = bvh.prims[flatOrder[i]];
+        }
+        return flat;
+    }
+
 }
@@ -1,7 +1,14 @@
 #pragma once
 
+#include "SimpleGL/Core/IO.h"
 #include "glm/glm.hpp"
 
+namespace SGL {
+
+    struct MappedFile;
+
+}
+
 namespace SGL::Utility {
 
     struct BoundingBoxAABB {
@@ -15,6 +22,10 @@ namespace SGL::Utility {
         glm::vec3 getCenter() const noexcept;
         float getArea() const noexcept;
         float getVolumn() const noexcept;
+        /*
+        *   Squared distance from point to the box, zero inside
+        */
+        float getDistance2(glm::vec3 const& point) const noexcept;
 
         void reset() noexcept;
 
@@ -30,6 +41,12 @@ namespace SGL::Utility {
         */
         virtual bool intersect(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, float* t = nullptr) const noexcept = 0;
 
+        /*
+        *   Point of the primitive closest to point, used by distance queries
+        *   Defaults to the closest point of the bound, which makes those queries conservative
+        */
+        virtual glm::vec3 closestPoint(glm::vec3 const& point) const noexcept;
+
     };
 
     struct BVHNode {
@@ -42,6 +59,91 @@ namespace SGL::Utility {
 
     };
 
+    enum struct BVHSplitMethod {
+        /*
+        *   Split at the middle of the longest axis
+        */
+        Midpoint,
+        /*
+        *   Try every primitive centroid on every axis as split candidate
+        */
+        SAH,
+        /*
+        *   Evaluate SAH only on bin boundaries of the centroid bound
+        */
+        BinnedSAH,
+        /*
+        *   Sort primitives along a Morton curve and emit a radix tree over the codes, see buildLinearBVHNodes
+        */
+        Linear,
+    };
+
+    struct BVHBuildOption {
+#if defined(SGL_UTILITY_BVH_SPLIT_NAIVE)
+        BVHSplitMethod splitMethod = BVHSplitMethod::Midpoint;
+#else
+        BVHSplitMethod splitMethod = BVHSplitMethod::BinnedSAH;
+#endif
+        /*
+        *   Bins per axis for BinnedSAH, clamped to [2, 64]
+        */
+        uint32_t binCount = 16;
+        /*
+        *   Nodes with no more primitives than minLeafSize are never split,
+        *   nodes with no more than maxLeafSize are kept as leaf if splitting does not lower the SAH cost
+        */
+        uint32_t minLeafSize = 2;
+        uint32_t maxLeafSize = 8;
+        float traversalCost = 1.0f;
+        float intersectCost = 1.0f;
+        /*
+        *   Morton code length for the Linear build, 30 or 63 bits
+        */
+        uint32_t mortonBits = 30;
+        /*
+        *   Restructure 7 leaf treelets after the Linear build to lower the SAH cost, slower but closer to a SAH build
+        */
+        bool treeletOptimize = false;
+        /*
+        *   Build subtrees and large splits on ThreadPool::instance(),
+        *   the result is identical to the serial build
+        */
+        bool parallel = true;
+        /*
+        *   BVH::build and TriangleBVH::build look for a result keyed by a hash of the input and these options here,
+        *   and store their result on a miss, empty disables the cache
+        */
+        Filepath cacheDirectory;
+    };
+
+    struct BVHBuildStats {
+        /*
+        *   Build time in seconds
+        */
+        double buildTime = 0.0;
+        /*
+        *   SAH cost of the whole tree, normalized by the surface area of the root
+        */
+        float sahCost = 0.0f;
+        uint32_t nodeCount = 0;
+        uint32_t leafCount = 0;
+        uint32_t maxDepth = 0;
+        /*
+        *   Updated by refit, degradation is the current SAH cost over the cost right after the build
+        */
+        double refitTime = 0.0;
+        float degradation = 1.0f;
+        uint32_t rebuiltSubtreeCount = 0;
+    };
+
+    struct BVHRefitOption {
+        /*
+        *   Subtrees whose SAH cost grew past this ratio of their build cost are rebuilt, 0 disables rebuilding
+        */
+        float rebuildThreshold = 1.5f;
+        bool parallel = true;
+    };
+
     struct BVH {
 
         std::vector<BVHNode> nodes;
@@ -51,6 +153,14 @@ namespace SGL::Utility {
         */
         std::vector<BVHPrimitive*> prims;
 
+        BVHBuildStats stats;
+        BVHBuildOption option;
+
+        /*
+        *   SAH cost of each subtree over its root area at build time, reference for the refit quality monitor
+        */
+        std::vector<float> buildQuality;
+
         BVH() = default;
         ~BVH() = default;
 
@@ -60,8 +170,159 @@ namespace SGL::Utility {
         BVH& operator=(BVH const&) = delete;
         BVH& operator=(BVH&& other) = delete;
 
-        static std::unique_ptr<BVH> build(std::vector<BVHPrimitive*> const& prims) noexcept;
+        static std::unique_ptr<BVH> build(std::vector<BVHPrimitive*> const& prims, BVHBuildOption const& option = BVHBuildOption()) noexcept;
+
+        /*
+        *   Recompute bounds bottom-up after primitives moved, keeping the topology
+        *   Subtrees that degraded past the threshold are rebuilt in place, FlatBVH or BVH4 made from this BVH need to be derived again
+        */
+        void refit(BVHRefitOption const& refitOption = BVHRefitOption()) noexcept;
+
+    };
+
+    /*
+    *   32 byte node stored in depth first order, the first child of an interior node is the node right after it
+    */
+    struct alignas(32) FlatBVHNode {
+
+        glm::vec3 min;
+        /*
+        *   First primitive for leaves, index of the second child for interior nodes
+        */
+        uint32_t offset;
+        glm::vec3 max;
+        uint32_t primCount;
+
+        bool isLeaf() const noexcept { return primCount > 0; }
+
+    };
+
+    static_assert(sizeof(FlatBVHNode) == 32, "FlatBVHNode should fit in half a cache line");
+
+    /*
+    *   Traversal layout of a built BVH, primitives are reordered to match the leaf order
+    */
+    struct FlatBVH {
+
+        std::vector<FlatBVHNode> nodes;
+        std::vector<BVHPrimitive*> prims;
+
+        FlatBVH() = default;
+        ~FlatBVH() = default;
+
+        FlatBVH(FlatBVH const&) = delete;
+        FlatBVH(FlatBVH&& other) = delete;
+
+        FlatBVH& operator=(FlatBVH const&) = delete;
+        FlatBVH& operator=(FlatBVH&& other) = delete;
+
+        static std::unique_ptr<FlatBVH> flatten(BVH const& bvh) noexcept;
 
     };
 
+    /*
+    *   Read only array of a built structure, owned or viewing a mapped cache file in place
+    */
+    template<typename T>
+    struct BVHArray {
+
+        std::vector<T> owned;
+        std::shared_ptr<MappedFile> mapping;
+        T const* view = nullptr;
+        size_t count = 0;
+
+        BVHArray() = default;
+        ~BVHArray() = default;
+
+        BVHArray(BVHArray const&) = delete;
+        BVHArray(BVHArray&& other) = default;
+
+        BVHArray& operator=(BVHArray const&) = delete;
+        BVHArray& operator=(BVHArray&& other) = default;
+
+        void assign(std::vector<T>&& values) noexcept {
+            owned = std::move(values);
+            mapping.reset();
+            view = owned.data();
+            count = owned.size();
+        }
+
+        void assign(std::shared_ptr<MappedFile> const& file, T const* values, size_t size) noexcept {
+            owned.clear();
+            mapping = file;
+            view = values;
+            count = size;
+        }
+
+        bool isMapped() const noexcept { return mapping != nullptr; }
+
+        T const* data() const noexcept { return view; }
+        size_t size() const noexcept { return count; }
+        bool empty() const noexcept { return count == 0; }
+
+        T const& operator[](size_t i) const noexcept { return view[i]; }
+        T const* begin() const noexcept { return view; }
+        T const* end() const noexcept { return view + count; }
+
+    };
+
+    /*
+    *   Traversal stack kept on the call stack, spills to the heap for degenerate deep trees
+    */
+    template<typename T, size_t N = 64>
+    struct BVHTraversalStack {
+
+        T local[N];
+        std::vector<T> overflow;
+        size_t size = 0;
+
+        bool empty() const noexcept { return size == 0; }
+
+        void push(T const& value) noexcept {
+            if (size < N) local[size] = value;
+            else overflow.push_back(value);
+            ++size;
+        }
+
+        T pop() noexcept {
+            --size;
+            if (size < N) return local[size];
+            T value = overflow.back();
+            overflow.pop_back();
+            return value;
+        }
+
+    };
+
+    /*
+    *   Build nodes over primitive bounds only, shared by every BVH flavour
+    *       order receives the primitive permutation, leaf ranges index into order
+    */
+    void buildBVHNodes(
+        std::vector<BoundingBoxAABB> const& bounds,
+        BVHBuildOption const& option,
+        std::vector<BVHNode>& nodes,
+        std::vector<uint32_t>& order) noexcept;
+
+    /*
+    *   Linear build, primitive centroids are quantised to Morton codes and radix sorted, the hierarchy follows the code bits
+    *   Same output as buildBVHNodes, subtrees that are cheaper as a leaf by SAH are collapsed
+    */
+    void buildLinearBVHNodes(
+        std::vector<BoundingBoxAABB> const& bounds,
+        BVHBuildOption const& option,
+        std::vector<BVHNode>& nodes,
+        std::vector<uint32_t>& order) noexcept;
+
+    /*
+    *   Depth first 32 byte layout of built nodes
+    *       flatOrder receives the leaf order, entry i is the index into the leaf ranges of nodes for flat primitive i
+    */
+    void flattenBVHNodes(
+        std::vector<BVHNode> const& nodes,
+        std::vector<FlatBVHNode>& flatNodes,
+        std::vector<uint32_t>& flatOrder) noexcept;
+
+    BVHBuildStats computeBVHStats(std::vector<BVHNode> const& nodes, BVHBuildOption const& option = BVHBuildOption()) noexcept;
+
 }
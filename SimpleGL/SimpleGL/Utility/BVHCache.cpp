@@ -0,0 +1,106 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/BVHCache.h"
+#include "SimpleGL/Core/MappedFile.h"
+
+namespace SGL::Utility {
+
+    static constexpr uint64_t BVH_CACHE_ALIGNMENT = 64;
+
+    static inline uint64_t alignCacheOffset(uint64_t offset) noexcept {
+        return (offset + BVH_CACHE_ALIGNMENT - 1) / BVH_CACHE_ALIGNMENT * BVH_CACHE_ALIGNMENT;
+    }
+
+    static Filepath getBVHCachePath(Filepath const& directory, uint64_t key) noexcept {
+        char name[32];
+        std::snprintf(name, sizeof(name), "bvh_%016llx.bin", static_cast<unsigned long long>(key));
+        return directory / name;
+    }
+
+    uint64_t getBVHCacheKey(BVHCacheKind kind, void const* input, size_t inputSize, BVHBuildOption const& option) noexcept {
+        uint32_t const version = BVHCacheHeader().version;
+        uint64_t key = hashBytes(&version, sizeof(version));
+        key = hashBytes(&kind, sizeof(kind), key);
+        uint64_t const size = inputSize;
+        key = hashBytes(&size, sizeof(size), key);
+        key = hashBytes(input, inputSize, key);
+        key = hashBytes(&option.splitMethod, sizeof(option.splitMethod), key);
+        key = hashBytes(&option.binCount, sizeof(option.binCount), key);
+        key = hashBytes(&option.minLeafSize, sizeof(option.minLeafSize), key);
+        key = hashBytes(&option.maxLeafSize, sizeof(option.maxLeafSize), key);
+        key = hashBytes(&option.traversalCost, sizeof(option.traversalCost), key);
+        key = hashBytes(&option.intersectCost, sizeof(option.intersectCost), key);
+        key = hashBytes(&option.mortonBits, sizeof(option.mortonBits), key);
+        key = hashBytes(&option.treeletOptimize, sizeof(option.treeletOptimize), key);
+        return key;
+    }
+
+    std::shared_ptr<MappedFile> openBVHCache(Filepath const& directory, uint64_t key, BVHCacheKind kind, uint32_t nodeSize, uint32_t primSize, BVHCacheHeader& header) noexcept {
+        if (directory.empty()) return nullptr;
+        Filepath const path = getBVHCachePath(directory, key);
+        std::error_code error;
+        if (!std::filesystem::exists(path, error)) return nullptr;
+
+        std::shared_ptr<MappedFile> file = MappedFile::open(path);
+        if (!file || file->size < sizeof(BVHCacheHeader)) return nullptr;
+        std::memcpy(&header, file->data, sizeof(header));
+
+        BVHCacheHeader const expected;
+        bool valid = header.magic == expected.magic
+            && header.version == expected.version
+            && header.kind == kind
+            && header.key == key
+            && header.nodeSize == nodeSize
+            && header.primSize == primSize
+            && header.nodeCount <= file->size / nodeSize
+            && header.primCount <= file->size / primSize
+            && header.nodeOffset % BVH_CACHE_ALIGNMENT == 0
+            && header.primOffset % BVH_CACHE_ALIGNMENT == 0
+            && header.nodeOffset + header.nodeCount * nodeSize <= file->size
+            && header.primOffset + header.primCount * primSize <= file->size;
+        if (!valid) {
+            SGL_LOG_WARN("Ignoring invalid BVH cache {0}", path.string());
+            return nullptr;
+        }
+        return file;
+    }
+
+    bool saveBVHCache(Filepath const& directory, BVHCacheHeader header, void const* nodes, void const* prims) noexcept {
+        if (directory.empty()) return false;
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+
+        uint64_t const nodeBytes = header.nodeCount * header.nodeSize;
+        uint64_t const primBytes = header.primCount * header.primSize;
+        header.nodeOffset = alignCacheOffset(sizeof(BVHCacheHeader));
+        header.primOffset = alignCacheOffset(header.nodeOffset + nodeBytes);
+
+        Filepath const path = getBVHCachePath(directory, header.key);
+        Filepath temp = path;
+        temp += ".tmp";
+        {
+            std::ofstream ofs(temp.string().c_str(), std::ofstream::out | std::ofstream::binary);
+            if (!ofs.is_open()) {
+                SGL_LOG_ERROR("Failed to write file: {0}", temp.string());
+                return false;
+            }
+            char const padding[BVH_CACHE_ALIGNMENT] = {};
+            ofs.write(reinterpret_cast<char const*>(&header), sizeof(header));
+            ofs.write(padding, header.nodeOffset - sizeof(header));
+            ofs.write(static_cast<char const*>(nodes), nodeBytes);
+            ofs.write(padding, header.primOffset - header.nodeOffset - nodeBytes);
+            ofs.write(static_cast<char const*>(prims), primBytes);
+            if (!ofs) {
+                SGL_LOG_ERROR("Failed to write file: {0}", temp.string());
+                return false;
+            }
+        }
+        std::filesystem::rename(temp, path, error);
+        if (error) {
+            std::filesystem::remove(temp, error);
+            return false;
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "SimpleGL/Utility/BVH.h"
+
+namespace SGL::Utility {
+
+    enum struct BVHCacheKind : uint32_t {
+        /*
+        *   BVHNode array followed by the build input index of each primitive in leaf order
+        */
+        BVH = 0,
+        /*
+        *   FlatBVHNode array followed by the BVHTriangle4 packs
+        */
+        TriangleBVH = 1,
+    };
+
+    /*
+    *   Layout of a cache file, both arrays start on a 64 byte boundary so a mapped file can be used in place
+    *   Files are only valid on machines with the same endianness and structure layout, a version bump invalidates them
+    */
+    struct BVHCacheHeader {
+        uint32_t magic = 0x56424753; // "SGBV"
+        uint32_t version = 1;
+        BVHCacheKind kind = BVHCacheKind::BVH;
+        uint32_t nodeSize = 0;
+        uint64_t key = 0;
+        /*
+        *   Primitives of the build input, triangles for a TriangleBVH
+        */
+        uint64_t inputCount = 0;
+        uint64_t nodeCount = 0;
+        uint64_t nodeOffset = 0;
+        uint32_t primSize = 0;
+        uint32_t pad = 0;
+        uint64_t primCount = 0;
+        uint64_t primOffset = 0;
+        /*
+        *   Build stats, which can not be derived from the flat layout after loading
+        */
+        float sahCost = 0.0f;
+        uint32_t leafCount = 0;
+        uint32_t maxDepth = 0;
+        uint32_t pad2 = 0;
+    };
+
+    /*
+    *   Key of a build input, parallel does not change the result and cacheDirectory does not change the content, so neither is hashed
+    */
+    uint64_t getBVHCacheKey(BVHCacheKind kind, void const* input, size_t inputSize, BVHBuildOption const& option) noexcept;
+
+    /*
+    *   Map the cache file of key, nullptr on a miss or if the header does not match kind, the structure sizes or the file size
+    */
+    std::shared_ptr<MappedFile> openBVHCache(Filepath const& directory, uint64_t key, BVHCacheKind kind, uint32_t nodeSize, uint32_t primSize, BVHCacheHeader& header) noexcept;
+
+    /*
+    *   Offsets and sizes of header are filled in, the file is written next to its final name and renamed so readers never see it partially
+    */
+    bool saveBVHCache(Filepath const& directory, BVHCacheHeader header, void const* nodes, void const* prims) noexcept;
+
+}
@@ -0,0 +1,492 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/CollisionQuery.h"
+#include "SimpleGL/Utility/DistanceQuery.h"
+#include "SimpleGL/Utility/Intersect.h"
+
+namespace SGL::Utility {
+
+    bool intersectTriangleTriangle(
+        glm::vec3 const& a0,
+        glm::vec3 const& a1,
+        glm::vec3 const& a2,
+        glm::vec3 const& b0,
+        glm::vec3 const& b1,
+        glm::vec3 const& b2) noexcept {
+        glm::vec3 const edgeA[3] = { a1 - a0, a2 - a1, a0 - a2 };
+        glm::vec3 const edgeB[3] = { b1 - b0, b2 - b1, b0 - b2 };
+
+        // axes shorter than this relative to their factors come from parallel edges and carry no direction
+        auto separated = [&](glm::vec3 const& axis, float scale2) {
+            if (glm::dot(axis, axis) <= 1e-12f * scale2) return false;
+            float const pa0 = glm::dot(axis, a0), pa1 = glm::dot(axis, a1), pa2 = glm::dot(axis, a2);
+            float const pb0 = glm::dot(axis, b0), pb1 = glm::dot(axis, b1), pb2 = glm::dot(axis, b2);
+            float const minA = std::min(std::min(pa0, pa1), pa2), maxA = std::max(std::max(pa0, pa1), pa2);
+            float const minB = std::min(std::min(pb0, pb1), pb2), maxB = std::max(std::max(pb0, pb1), pb2);
+            return maxA < minB || maxB < minA;
+        };
+
+        glm::vec3 const normalA = glm::cross(edgeA[0], -edgeA[2]);
+        glm::vec3 const normalB = glm::cross(edgeB[0], -edgeB[2]);
+        float const lengthA[3] = { glm::dot(edgeA[0], edgeA[0]), glm::dot(edgeA[1], edgeA[1]), glm::dot(edgeA[2], edgeA[2]) };
+        float const lengthB[3] = { glm::dot(edgeB[0], edgeB[0]), glm::dot(edgeB[1], edgeB[1]), glm::dot(edgeB[2], edgeB[2]) };
+        if (separated(normalA, lengthA[0] * lengthA[2])) return false;
+        if (separated(normalB, lengthB[0] * lengthB[2])) return false;
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                if (separated(glm::cross(edgeA[i], edgeB[j]), lengthA[i] * lengthB[j])) return false;
+            }
+        }
+        // in plane edge normals separate coplanar triangles, where the cross products above vanish
+        for (int i = 0; i < 3; ++i) {
+            if (separated(glm::cross(normalA, edgeA[i]), glm::dot(normalA, normalA) * lengthA[i])) return false;
+            if (separated(glm::cross(normalB, edgeB[i]), glm::dot(normalB, normalB) * lengthB[i])) return false;
+        }
+        return true;
+    }
+
+    BoundingBoxAABB transformBound(BoundingBoxAABB const& box, glm::mat4 const& transform) noexcept {
+        if (box.min.x > box.max.x) return box;
+        glm::vec3 const center = glm::vec3(transform * glm::vec4(box.getCenter(), 1.0f));
+        glm::vec3 const extent = (box.max - box.min) * 0.5f;
+        glm::vec3 newExtent(0.0f);
+        for (int col = 0; col < 3; ++col) {
+            newExtent += glm::abs(glm::vec3(transform[col])) * extent[col];
+        }
+        BoundingBoxAABB result;
+        result.min = center - newExtent;
+        result.max = center + newExtent;
+        return result;
+    }
+
+    static inline bool overlapBounds(glm::vec3 const& min0, glm::vec3 const& max0, glm::vec3 const& min1, glm::vec3 const& max1) noexcept {
+        return glm::all(glm::lessThanEqual(min0, max1)) && glm::all(glm::lessThanEqual(min1, max0));
+    }
+
+    struct NodePair {
+        uint32_t a;
+        uint32_t b;
+    };
+
+    void queryOverlapPairs(BVH const& a, BVH const& b, glm::mat4 const& bToA, std::vector<std::pair<uint32_t, uint32_t>>& pairs) noexcept {
+        pairs.clear();
+        if (a.nodes.empty() || b.nodes.empty()) return;
+        BVHTraversalStack<NodePair> stack;
+        stack.push({ 0, 0 });
+        while (!stack.empty()) {
+            NodePair const pair = stack.pop();
+            BVHNode const& nodeA = a.nodes[pair.a];
+            BVHNode const& nodeB = b.nodes[pair.b];
+            BoundingBoxAABB const boundB = transformBound(nodeB.bound, bToA);
+            if (!overlapBounds(nodeA.bound.min, nodeA.bound.max, boundB.min, boundB.max)) continue;
+
+            if (nodeA.isLeaf() && nodeB.isLeaf()) {
+                for (uint32_t j = nodeB.firstPrim; j < nodeB.firstPrim + nodeB.primCount; ++j) {
+                    BoundingBoxAABB const primB = transformBound(b.prims[j]->getBound(), bToA);
+                    for (uint32_t i = nodeA.firstPrim; i < nodeA.firstPrim + nodeA.primCount; ++i) {
+                        BoundingBoxAABB const primA = a.prims[i]->getBound();
+                        if (overlapBounds(primA.min, primA.max, primB.min, primB.max)) pairs.emplace_back(i, j);
+                    }
+                }
+                continue;
+            }
+
+            // split the larger node, leaves can only be paired with the children of the other side
+            if (nodeA.isLeaf() || (!nodeB.isLeaf() && boundB.getArea() > nodeA.bound.getArea())) {
+                stack.push({ pair.a, nodeB.right });
+                stack.push({ pair.a, nodeB.left });
+            }
+            else {
+                stack.push({ nodeA.right, pair.b });
+                stack.push({ nodeA.left, pair.b });
+            }
+        }
+    }
+
+    /*
+    *   Dual traversal of two triangle BVHs, onPair(triangleA, triangleB) is called for every reported pair
+    *       with AnyHit the traversal stops at the first pair
+    */
+    template<bool AnyHit, typename PairFunc>
+    static bool traverseTrianglePairs(TriangleBVH const& a, TriangleBVH const& b, glm::mat4 const& bToA, bool exact, PairFunc const& onPair) noexcept {
+        if (a.nodes.empty() || b.nodes.empty()) return false;
+        bool found = false;
+        BVHTraversalStack<NodePair> stack;
+        stack.push({ 0, 0 });
+        while (!stack.empty()) {
+            NodePair const pair = stack.pop();
+            FlatBVHNode const& nodeA = a.nodes[pair.a];
+            FlatBVHNode const& nodeB = b.nodes[pair.b];
+            BoundingBoxAABB localB;
+            localB.min = nodeB.min;
+            localB.max = nodeB.max;
+            BoundingBoxAABB const boundB = transformBound(localB, bToA);
+            if (!overlapBounds(nodeA.min, nodeA.max, boundB.min, boundB.max)) continue;
+
+            if (nodeA.isLeaf() && nodeB.isLeaf()) {
+                for (uint32_t pb = nodeB.offset; pb < nodeB.offset + nodeB.primCount; ++pb) {
+                    BVHTriangle4 const& packB = b.packs[pb];
+                    for (uint32_t laneB = 0; laneB < 4; ++laneB) {
+                        if (packB.index[laneB] == ~0U) continue;
+                        glm::vec3 b0, b1, b2;
+                        packB.getVertices(laneB, b0, b1, b2);
+                        b0 = glm::vec3(bToA * glm::vec4(b0, 1.0f));
+                        b1 = glm::vec3(bToA * glm::vec4(b1, 1.0f));
+                        b2 = glm::vec3(bToA * glm::vec4(b2, 1.0f));
+                        glm::vec3 const minB = glm::min(glm::min(b0, b1), b2);
+                        glm::vec3 const maxB = glm::max(glm::max(b0, b1), b2);
+
+                        for (uint32_t pa = nodeA.offset; pa < nodeA.offset + nodeA.primCount; ++pa) {
+                            BVHTriangle4 const& packA = a.packs[pa];
+                            for (uint32_t laneA = 0; laneA < 4; ++laneA) {
+                                if (packA.index[laneA] == ~0U) continue;
+                                glm::vec3 a0, a1, a2;
+                                packA.getVertices(laneA, a0, a1, a2);
+                                if (!overlapBounds(glm::min(glm::min(a0, a1), a2), glm::max(glm::max(a0, a1), a2), minB, maxB)) continue;
+                                if (exact && !intersectTriangleTriangle(a0, a1, a2, b0, b1, b2)) continue;
+                                if constexpr (AnyHit) return true;
+                                found = true;
+                                onPair(packA.index[laneA], packB.index[laneB]);
+                            }
+                        }
+                    }
+                }
+                continue;
+            }
+
+            glm::vec3 const sizeA = nodeA.max - nodeA.min;
+            float const areaA = sizeA.x * sizeA.y + sizeA.y * sizeA.z + sizeA.z * sizeA.x;
+            if (nodeA.isLeaf() || (!nodeB.isLeaf() && boundB.getArea() > areaA)) {
+                stack.push({ pair.a, nodeB.offset });
+                stack.push({ pair.a, pair.b + 1 });
+            }
+            else {
+                stack.push({ nodeA.offset, pair.b });
+                stack.push({ pair.a + 1, pair.b });
+            }
+        }
+        return found;
+    }
+
+    void queryOverlapPairs(
+        TriangleBVH const& a,
+        TriangleBVH const& b,
+        glm::mat4 const& bToA,
+        std::vector<std::pair<uint32_t, uint32_t>>& pairs,
+        bool exact) noexcept {
+        pairs.clear();
+        traverseTrianglePairs<false>(a, b, bToA, exact, [&](uint32_t triangleA, uint32_t triangleB) {
+            pairs.emplace_back(triangleA, triangleB);
+        });
+    }
+
+    bool intersects(TriangleBVH const& a, TriangleBVH const& b, glm::mat4 const& bToA) noexcept {
+        return traverseTrianglePairs<true>(a, b, bToA, true, [](uint32_t, uint32_t) {});
+    }
+
+    /*
+    *   Closest points of segments p0 p1 and q0 q1, returns their squared distance
+    */
+    static float closestPointsSegmentSegment(
+        glm::vec3 const& p0,
+        glm::vec3 const& p1,
+        glm::vec3 const& q0,
+        glm::vec3 const& q1,
+        glm::vec3& onP,
+        glm::vec3& onQ) noexcept {
+        float const eps = 1e-12f;
+        glm::vec3 const d1 = p1 - p0;
+        glm::vec3 const d2 = q1 - q0;
+        glm::vec3 const r = p0 - q0;
+        float const a = glm::dot(d1, d1);
+        float const e = glm::dot(d2, d2);
+        float const f = glm::dot(d2, r);
+        float s = 0.0f;
+        float t = 0.0f;
+        if (a <= eps && e <= eps) {
+            // both degenerate to points
+        }
+        else if (a <= eps) {
+            t = glm::clamp(f / e, 0.0f, 1.0f);
+        }
+        else {
+            float const c = glm::dot(d1, r);
+            if (e <= eps) {
+                s = glm::clamp(-c / a, 0.0f, 1.0f);
+            }
+            else {
+                float const b = glm::dot(d1, d2);
+                float const denom = a * e - b * b;
+                s = denom > 0.0f ? glm::clamp((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+                t = (b * s + f) / e;
+                if (t < 0.0f) {
+                    t = 0.0f;
+                    s = glm::clamp(-c / a, 0.0f, 1.0f);
+                }
+                else if (t > 1.0f) {
+                    t = 1.0f;
+                    s = glm::clamp((b - c) / a, 0.0f, 1.0f);
+                }
+            }
+        }
+        onP = p0 + d1 * s;
+        onQ = q0 + d2 * t;
+        glm::vec3 const d = onP - onQ;
+        return glm::dot(d, d);
+    }
+
+    static inline bool insideTriangle(glm::vec3 const& point, glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c) noexcept {
+        glm::vec3 const e0 = b - a;
+        glm::vec3 const e1 = c - a;
+        glm::vec3 const ap = point - a;
+        float const d00 = glm::dot(e0, e0);
+        float const d01 = glm::dot(e0, e1);
+        float const d11 = glm::dot(e1, e1);
+        float const d20 = glm::dot(ap, e0);
+        float const d21 = glm::dot(ap, e1);
+        float const denom = d00 * d11 - d01 * d01;
+        if (denom <= 0.0f) return false;
+        float const v = (d11 * d20 - d01 * d21) / denom;
+        float const w = (d00 * d21 - d01 * d20) / denom;
+        return v >= 0.0f && w >= 0.0f && v + w <= 1.0f;
+    }
+
+    /*
+    *   Closest points of segment p0 p1 and triangle abc, returns their squared distance
+    */
+    static float closestPointsSegmentTriangle(
+        glm::vec3 const& p0,
+        glm::vec3 const& p1,
+        glm::vec3 const& a,
+        glm::vec3 const& b,
+        glm::vec3 const& c,
+        glm::vec3& onSegment,
+        glm::vec3& onTriangle) noexcept {
+        // a segment piercing the face touches it at the crossing
+        glm::vec3 const normal = glm::cross(b - a, c - a);
+        float const dist0 = glm::dot(normal, p0 - a);
+        float const dist1 = glm::dot(normal, p1 - a);
+        if ((dist0 <= 0.0f) != (dist1 <= 0.0f) || (dist0 == 0.0f && dist1 == 0.0f)) {
+            float const s = dist0 != dist1 ? dist0 / (dist0 - dist1) : 0.0f;
+            glm::vec3 const crossing = p0 + (p1 - p0) * s;
+            if (insideTriangle(crossing, a, b, c)) {
+                onSegment = onTriangle = crossing;
+                return 0.0f;
+            }
+        }
+
+        float best = INFINITY;
+        auto candidate = [&](glm::vec3 const& s, glm::vec3 const& t) {
+            glm::vec3 const d = s - t;
+            float const distance2 = glm::dot(d, d);
+            if (distance2 < best) {
+                best = distance2;
+                onSegment = s;
+                onTriangle = t;
+            }
+        };
+        candidate(p0, closestPointTriangle(p0, a, b, c));
+        candidate(p1, closestPointTriangle(p1, a, b, c));
+        glm::vec3 const vertices[3] = { a, b, c };
+        for (int i = 0; i < 3; ++i) {
+            glm::vec3 s, t;
+            closestPointsSegmentSegment(p0, p1, vertices[i], vertices[(i + 1) % 3], s, t);
+            candidate(s, t);
+        }
+        return best;
+    }
+
+    /*
+    *   Sphere of radius at origin moving along dir against the face of abc offset by radius, t is only shortened on a hit
+    */
+    static bool sweepSphereFace(
+        glm::vec3 const& origin,
+        glm::vec3 const& dir,
+        float radius,
+        glm::vec3 const& a,
+        glm::vec3 const& b,
+        glm::vec3 const& c,
+        float& t) noexcept {
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float const length = glm::length(normal);
+        if (length <= 0.0f) return false;
+        normal /= length;
+        float const dist = glm::dot(normal, origin - a);
+        float const side = dist >= 0.0f ? 1.0f : -1.0f;
+        float const speed = glm::dot(normal, dir);
+        if (speed * side >= 0.0f) return false;
+        float const tc = (side * radius - dist) / speed;
+        if (tc < 0.0f || tc >= t) return false;
+        if (!insideTriangle(origin + dir * tc - normal * (side * radius), a, b, c)) return false;
+        t = tc;
+        return true;
+    }
+
+    /*
+    *   First contact of the capsule p0 p1 moving along dir with triangle abc, t is only shortened on a hit
+    *   The shape is the Minkowski sum of the moving segment and the triangle, so contacts are either
+    *   an end sphere against the triangle, a triangle vertex against the segment, or a triangle edge against the segment
+    */
+    static bool sweepTriangle(
+        glm::vec3 const& p0,
+        glm::vec3 const& p1,
+        float radius,
+        glm::vec3 const& dir,
+        glm::vec3 const& a,
+        glm::vec3 const& b,
+        glm::vec3 const& c,
+        float& t) noexcept {
+        glm::vec3 onSegment, onTriangle;
+        if (closestPointsSegmentTriangle(p0, p1, a, b, c, onSegment, onTriangle) <= radius * radius) {
+            t = 0.0f;
+            return true;
+        }
+
+        glm::vec3 const vertices[3] = { a, b, c };
+        float tt = t;
+        bool hit = false;
+        auto sweepEndSphere = [&](glm::vec3 const& origin) {
+            hit |= sweepSphereFace(origin, dir, radius, a, b, c, tt);
+            for (int i = 0; i < 3; ++i) {
+                hit |= intersectCapsule(origin, dir, vertices[i], vertices[(i + 1) % 3], radius, &tt);
+            }
+        };
+        sweepEndSphere(p0);
+
+        glm::vec3 const axis = p1 - p0;
+        if (glm::dot(axis, axis) > 0.0f) {
+            sweepEndSphere(p1);
+            for (int i = 0; i < 3; ++i) {
+                hit |= intersectCapsule(p0, dir, vertices[i], vertices[i] - axis, radius, &tt);
+            }
+
+            // edge against segment, p0 hits the parallelogram spanned by the edge and -axis offset by radius
+            for (int i = 0; i < 3; ++i) {
+                glm::vec3 const& origin = vertices[i];
+                glm::vec3 const edge = vertices[(i + 1) % 3] - origin;
+                glm::vec3 normal = glm::cross(edge, axis);
+                float const length = glm::length(normal);
+                if (length <= 1e-6f * glm::length(edge) * glm::length(axis)) continue;
+                normal /= length;
+                float const dist = glm::dot(normal, p0 - origin);
+                float const side = dist >= 0.0f ? 1.0f : -1.0f;
+                float const speed = glm::dot(normal, dir);
+                if (speed * side >= 0.0f) continue;
+                float const tc = (side * radius - dist) / speed;
+                if (tc < 0.0f || tc >= tt) continue;
+                glm::vec3 const local = p0 + dir * tc - normal * (side * radius) - origin;
+                float const g11 = glm::dot(edge, edge);
+                float const g12 = -glm::dot(edge, axis);
+                float const g22 = glm::dot(axis, axis);
+                float const r1 = glm::dot(local, edge);
+                float const r2 = -glm::dot(local, axis);
+                float const det = g11 * g22 - g12 * g12;
+                float const u = (r1 * g22 - r2 * g12) / det;
+                float const s = (g11 * r2 - g12 * r1) / det;
+                if (u < 0.0f || u > 1.0f || s < 0.0f || s > 1.0f) continue;
+                tt = tc;
+                hit = true;
+            }
+        }
+
+        if (hit) t = tt;
+        return hit;
+    }
+
+    static bool sweepShape(
+        TriangleBVH const& bvh,
+        glm::vec3 const& p0,
+        glm::vec3 const& p1,
+        float radius,
+        glm::vec3 const& dir,
+        SweepHit& hit,
+        float tMax) noexcept {
+        if (bvh.nodes.empty() || glm::dot(dir, dir) == 0.0f) return false;
+        // node boxes grown by the half size of the shape bound turn the sweep into a ray from its center
+        glm::vec3 const center = (p0 + p1) * 0.5f;
+        glm::vec3 const extent = glm::abs(p1 - p0) * 0.5f + radius;
+        glm::vec3 const invDir = 1.0f / dir;
+        FlatBVHNode const* nodes = bvh.nodes.data();
+
+        float tt = tMax;
+        uint32_t hitTriangle = ~0U;
+        glm::vec3 hitVertices[3];
+        BVHTraversalStack<uint32_t> stack;
+        auto reachable = [&](float tEnter) { return tEnter != INFINITY && tEnter <= tt; };
+        if (reachable(intersectSlab(center, invDir, nodes[0].min - extent, nodes[0].max + extent, INFINITY))) stack.push(0);
+        while (!stack.empty()) {
+            uint32_t const nodeIdx = stack.pop();
+            FlatBVHNode const& node = nodes[nodeIdx];
+            if (node.isLeaf()) {
+                for (uint32_t i = node.offset; i < node.offset + node.primCount; ++i) {
+                    BVHTriangle4 const& pack = bvh.packs[i];
+                    for (uint32_t lane = 0; lane < 4; ++lane) {
+                        if (pack.index[lane] == ~0U) continue;
+                        glm::vec3 a, b, c;
+                        pack.getVertices(lane, a, b, c);
+                        if (sweepTriangle(p0, p1, radius, dir, a, b, c, tt)) {
+                            hitTriangle = pack.index[lane];
+                            hitVertices[0] = a;
+                            hitVertices[1] = b;
+                            hitVertices[2] = c;
+                        }
+                    }
+                }
+                if (tt == 0.0f) break;
+                continue;
+            }
+
+            uint32_t child1 = nodeIdx + 1;
+            uint32_t child2 = node.offset;
+            float t1 = intersectSlab(center, invDir, nodes[child1].min - extent, nodes[child1].max + extent, INFINITY);
+            float t2 = intersectSlab(center, invDir, nodes[child2].min - extent, nodes[child2].max + extent, INFINITY);
+            if (t1 > t2) {
+                std::swap(t1, t2);
+                std::swap(child1, child2);
+            }
+            if (reachable(t2)) stack.push(child2);
+            if (reachable(t1)) stack.push(child1);
+        }
+        if (hitTriangle == ~0U) return false;
+
+        glm::vec3 const offset = dir * tt;
+        glm::vec3 onSegment, onTriangle;
+        closestPointsSegmentTriangle(p0 + offset, p1 + offset, hitVertices[0], hitVertices[1], hitVertices[2], onSegment, onTriangle);
+        glm::vec3 normal = onSegment - onTriangle;
+        if (glm::dot(normal, normal) > 0.0f) {
+            normal = glm::normalize(normal);
+        }
+        else {
+            // started in deep contact, use the face against the motion
+            normal = glm::normalize(glm::cross(hitVertices[1] - hitVertices[0], hitVertices[2] - hitVertices[0]));
+            if (glm::dot(normal, dir) > 0.0f) normal = -normal;
+        }
+        hit.t = tt;
+        hit.point = onTriangle;
+        hit.normal = normal;
+        hit.primitive = hitTriangle;
+        return true;
+    }
+
+    bool sweepSphere(
+        TriangleBVH const& bvh,
+        glm::vec3 const& center,
+        float radius,
+        glm::vec3 const& dir,
+        SweepHit& hit,
+        float tMax) noexcept {
+        return sweepShape(bvh, center, center, radius, dir, hit, tMax);
+    }
+
+    bool sweepCapsule(
+        TriangleBVH const& bvh,
+        glm::vec3 const& p0,
+        glm::vec3 const& p1,
+        float radius,
+        glm::vec3 const& dir,
+        SweepHit& hit,
+        float tMax) noexcept {
+        return sweepShape(bvh, p0, p1, radius, dir, hit, tMax);
+    }
+
+}
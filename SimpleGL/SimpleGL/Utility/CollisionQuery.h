@@ -0,0 +1,87 @@
+#pragma once
+
+#include "SimpleGL/Utility/TriangleBVH.h"
+
+namespace SGL::Utility {
+
+    /*
+    *   Separating axis test of two solid triangles, touching counts as overlap
+    */
+    bool intersectTriangleTriangle(
+        glm::vec3 const& a0,
+        glm::vec3 const& a1,
+        glm::vec3 const& a2,
+        glm::vec3 const& b0,
+        glm::vec3 const& b1,
+        glm::vec3 const& b2) noexcept;
+
+    /*
+    *   Bound of box after an affine transform
+    */
+    BoundingBoxAABB transformBound(BoundingBoxAABB const& box, glm::mat4 const& transform) noexcept;
+
+    /*
+    *   Dual tree traversal of a and b, where bToA places b in the space of a
+    *       pairs is cleared and receives (index in a.prims, index in b.prims) of every pair of overlapping primitive bounds
+    */
+    void queryOverlapPairs(BVH const& a, BVH const& b, glm::mat4 const& bToA, std::vector<std::pair<uint32_t, uint32_t>>& pairs) noexcept;
+
+    /*
+    *   Same for triangle meshes, pairs hold triangle indices
+    *       with exact, only triangles that really intersect are reported, otherwise pairs with overlapping bounds
+    */
+    void queryOverlapPairs(
+        TriangleBVH const& a,
+        TriangleBVH const& b,
+        glm::mat4 const& bToA,
+        std::vector<std::pair<uint32_t, uint32_t>>& pairs,
+        bool exact = false) noexcept;
+
+    /*
+    *   Whether any triangle of a intersects any triangle of b, stops at the first one found
+    */
+    bool intersects(TriangleBVH const& a, TriangleBVH const& b, glm::mat4 const& bToA) noexcept;
+
+    struct SweepHit {
+
+        /*
+        *   Time of impact in units of the sweep direction, 0 when the shape starts in contact
+        */
+        float t = INFINITY;
+        /*
+        *   Contact point on the triangle and unit normal pointing from it towards the shape, at time t
+        */
+        glm::vec3 point = glm::vec3(0.0f);
+        glm::vec3 normal = glm::vec3(0.0f);
+        uint32_t primitive = ~0U;
+
+        bool isHit() const noexcept { return primitive != ~0U; }
+
+    };
+
+    /*
+    *   Sphere moving from center along dir, the first contact within [0, tMax] is reported
+    *   Passing the displacement of a step as dir with tMax = 1 gives the fraction of the step that is free
+    *   dir must not be zero, use closestPoint for static overlap
+    */
+    bool sweepSphere(
+        TriangleBVH const& bvh,
+        glm::vec3 const& center,
+        float radius,
+        glm::vec3 const& dir,
+        SweepHit& hit,
+        float tMax = INFINITY) noexcept;
+
+    /*
+    *   Capsule around the segment p0 p1 moving along dir, as sweepSphere
+    */
+    bool sweepCapsule(
+        TriangleBVH const& bvh,
+        glm::vec3 const& p0,
+        glm::vec3 const& p1,
+        float radius,
+        glm::vec3 const& dir,
+        SweepHit& hit,
+        float tMax = INFINITY) noexcept;
+
+}
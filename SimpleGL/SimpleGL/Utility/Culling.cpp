@@ -0,0 +1,97 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/Culling.h"
+
+namespace SGL::Utility {
+
+    Frustum Frustum::fromMatrix(glm::mat4 const& projView) noexcept {
+        glm::mat4 const m = glm::transpose(projView);
+        Frustum frustum;
+        frustum.planes[0] = m[3] + m[0];
+        frustum.planes[1] = m[3] - m[0];
+        frustum.planes[2] = m[3] + m[1];
+        frustum.planes[3] = m[3] - m[1];
+        frustum.planes[4] = m[3] + m[2];
+        frustum.planes[5] = m[3] - m[2];
+        for (auto& plane : frustum.planes) {
+            float const length = glm::length(glm::vec3(plane));
+            // an infinite far plane degenerates to a constant, keep it from culling anything
+            plane = length > 0.0f ? plane / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+        return frustum;
+    }
+
+    /*
+    *   Same traversal as queryFlatBVHNodes on the binary layout, a fully inside node passes a zero mask to its children
+    */
+    template<typename Volume>
+    static void queryBVHNodes(BVH const& bvh, Volume const& volume, std::vector<uint32_t>& result) noexcept {
+        result.clear();
+        if (bvh.nodes.empty()) return;
+        struct Entry {
+            uint32_t node;
+            uint32_t planeMask;
+        };
+        BVHTraversalStack<Entry> stack;
+        stack.push({ 0, Frustum::AllPlanes });
+        while (!stack.empty()) {
+            Entry entry = stack.pop();
+            BVHNode const& node = bvh.nodes[entry.node];
+            if (classifyAABB(volume, node.bound.min, node.bound.max, entry.planeMask) == Containment::Outside) continue;
+
+            if (!node.isLeaf()) {
+                stack.push({ node.right, entry.planeMask });
+                stack.push({ node.left, entry.planeMask });
+                continue;
+            }
+
+            for (uint32_t i = node.firstPrim; i < node.firstPrim + node.primCount; ++i) {
+                if (entry.planeMask) {
+                    BoundingBoxAABB const bound = bvh.prims[i]->getBound();
+                    uint32_t planeMask = entry.planeMask;
+                    if (classifyAABB(volume, bound.min, bound.max, planeMask) == Containment::Outside) continue;
+                }
+                result.push_back(i);
+            }
+        }
+    }
+
+    template<typename Volume>
+    static void queryFlatBVH(FlatBVH const& bvh, Volume const& volume, std::vector<uint32_t>& result) noexcept {
+        result.clear();
+        queryFlatBVHNodes(
+            bvh.nodes,
+            volume,
+            [&](uint32_t i) { return bvh.prims[i]->getBound(); },
+            [&](uint32_t first, uint32_t count) {
+                for (uint32_t i = first; i < first + count; ++i) {
+                    result.push_back(i);
+                }
+            });
+    }
+
+    void queryFrustum(BVH const& bvh, Frustum const& frustum, std::vector<uint32_t>& result) noexcept {
+        queryBVHNodes(bvh, frustum, result);
+    }
+
+    void queryBox(BVH const& bvh, BoundingBoxAABB const& box, std::vector<uint32_t>& result) noexcept {
+        queryBVHNodes(bvh, box, result);
+    }
+
+    void querySphere(BVH const& bvh, glm::vec3 const& center, float radius, std::vector<uint32_t>& result) noexcept {
+        queryBVHNodes(bvh, BoundingSphere{ center, radius }, result);
+    }
+
+    void queryFrustum(FlatBVH const& bvh, Frustum const& frustum, std::vector<uint32_t>& result) noexcept {
+        queryFlatBVH(bvh, frustum, result);
+    }
+
+    void queryBox(FlatBVH const& bvh, BoundingBoxAABB const& box, std::vector<uint32_t>& result) noexcept {
+        queryFlatBVH(bvh, box, result);
+    }
+
+    void querySphere(FlatBVH const& bvh, glm::vec3 const& center, float radius, std::vector<uint32_t>& result) noexcept {
+        queryFlatBVH(bvh, BoundingSphere{ center, radius }, result);
+    }
+
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "SimpleGL/Utility/TypedBVH.h"
+
+namespace SGL::Utility {
+
+    enum struct Containment {
+        Outside,
+        Intersect,
+        Inside
+    };
+
+    /*
+    *   Six inward facing planes, a point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+    */
+    struct Frustum {
+
+        /*
+        *   Left, right, bottom, top, near and far, normalized so plane.w is a distance
+        */
+        glm::vec4 planes[6];
+
+        static constexpr uint32_t AllPlanes = 0x3F;
+
+        /*
+        *   Planes of the clip volume of an OpenGL style matrix, in the space the matrix transforms from
+        *   e.g. Camera::getProjView() gives world space planes, getProjView() * model gives model space planes
+        */
+        static Frustum fromMatrix(glm::mat4 const& projView) noexcept;
+
+    };
+
+    struct BoundingSphere {
+
+        glm::vec3 center;
+        float radius;
+
+    };
+
+    /*
+    *   Plane test against the box corners nearest to and farthest along each plane normal
+    *       planeMask selects the planes to test, planes the box is fully inside of are cleared
+    *       so children of the box can skip them, a zero mask means inside without any test
+    */
+    inline Containment classifyAABB(Frustum const& frustum, glm::vec3 const& boxMin, glm::vec3 const& boxMax, uint32_t& planeMask) noexcept {
+        for (uint32_t i = 0; i < 6; ++i) {
+            if (!(planeMask & (1U << i))) continue;
+            glm::vec4 const& plane = frustum.planes[i];
+            glm::vec3 const normal = glm::vec3(plane);
+            glm::vec3 const farCorner = glm::mix(boxMin, boxMax, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+            if (glm::dot(normal, farCorner) + plane.w < 0.0f) return Containment::Outside;
+            glm::vec3 const nearCorner = glm::mix(boxMax, boxMin, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+            if (glm::dot(normal, nearCorner) + plane.w >= 0.0f) planeMask &= ~(1U << i);
+        }
+        return planeMask ? Containment::Intersect : Containment::Inside;
+    }
+
+    inline Containment classifyAABB(BoundingBoxAABB const& box, glm::vec3 const& boxMin, glm::vec3 const& boxMax, uint32_t& planeMask) noexcept {
+        if (!planeMask) return Containment::Inside;
+        if (glm::any(glm::lessThan(boxMax, box.min)) || glm::any(glm::greaterThan(boxMin, box.max))) return Containment::Outside;
+        if (glm::all(glm::greaterThanEqual(boxMin, box.min)) && glm::all(glm::lessThanEqual(boxMax, box.max))) {
+            planeMask = 0;
+            return Containment::Inside;
+        }
+        return Containment::Intersect;
+    }
+
+    inline Containment classifyAABB(BoundingSphere const& sphere, glm::vec3 const& boxMin, glm::vec3 const& boxMax, uint32_t& planeMask) noexcept {
+        if (!planeMask) return Containment::Inside;
+        glm::vec3 const nearest = glm::clamp(sphere.center, boxMin, boxMax) - sphere.center;
+        float const radius2 = sphere.radius * sphere.radius;
+        if (glm::dot(nearest, nearest) > radius2) return Containment::Outside;
+        glm::vec3 const farthest = glm::max(glm::abs(boxMin - sphere.center), glm::abs(boxMax - sphere.center));
+        if (glm::dot(farthest, farthest) <= radius2) {
+            planeMask = 0;
+            return Containment::Inside;
+        }
+        return Containment::Intersect;
+    }
+
+    /*
+    *   Overlap traversal of depth first flat nodes, works for any volume with a classifyAABB overload
+    *       emit(first, count) receives ranges of primitives in leaf order
+    *       primBound(i) is only called for primitives of leaves crossing the volume boundary
+    *   Once a node is fully inside, the primitives of its subtree are contiguous and emitted as one range
+    */
+    template<typename Volume, typename PrimBound, typename Emit>
+    void queryFlatBVHNodes(std::vector<FlatBVHNode> const& nodes, Volume const& volume, PrimBound const& primBound, Emit const& emit) noexcept {
+        if (nodes.empty()) return;
+        struct Entry {
+            uint32_t node;
+            uint32_t planeMask;
+        };
+        BVHTraversalStack<Entry> stack;
+        stack.push({ 0, Frustum::AllPlanes });
+        while (!stack.empty()) {
+            Entry entry = stack.pop();
+            FlatBVHNode const& node = nodes[entry.node];
+            Containment const containment = classifyAABB(volume, node.min, node.max, entry.planeMask);
+            if (containment == Containment::Outside) continue;
+
+            if (containment == Containment::Inside) {
+                uint32_t first = entry.node;
+                while (!nodes[first].isLeaf()) first = first + 1;
+                uint32_t last = entry.node;
+                while (!nodes[last].isLeaf()) last = nodes[last].offset;
+                emit(nodes[first].offset, nodes[last].offset + nodes[last].primCount - nodes[first].offset);
+                continue;
+            }
+
+            if (node.isLeaf()) {
+                for (uint32_t i = node.offset; i < node.offset + node.primCount; ++i) {
+                    BoundingBoxAABB const bound = primBound(i);
+                    uint32_t planeMask = entry.planeMask;
+                    if (classifyAABB(volume, bound.min, bound.max, planeMask) != Containment::Outside) emit(i, 1);
+                }
+                continue;
+            }
+
+            stack.push({ node.offset, entry.planeMask });
+            stack.push({ entry.node + 1, entry.planeMask });
+        }
+    }
+
+    /*
+    *   Overlap queries, result is cleared and receives the index in bvh.prims of every primitive whose bound overlaps the volume
+    *   Primitives are culled by their bounds only, the result is conservative
+    */
+    void queryFrustum(BVH const& bvh, Frustum const& frustum, std::vector<uint32_t>& result) noexcept;
+    void queryBox(BVH const& bvh, BoundingBoxAABB const& box, std::vector<uint32_t>& result) noexcept;
+    void querySphere(BVH const& bvh, glm::vec3 const& center, float radius, std::vector<uint32_t>& result) noexcept;
+
+    void queryFrustum(FlatBVH const& bvh, Frustum const& frustum, std::vector<uint32_t>& result) noexcept;
+    void queryBox(FlatBVH const& bvh, BoundingBoxAABB const& box, std::vector<uint32_t>& result) noexcept;
+    void querySphere(FlatBVH const& bvh, glm::vec3 const& center, float radius, std::vector<uint32_t>& result) noexcept;
+
+    /*
+    *   Same as above with build input indices, e.g. a TypedBVH<BVHBox> over object bounds culled once per frame
+    */
+    template<typename Prim, typename Volume>
+    void queryOverlap(TypedBVH<Prim> const& bvh, Volume const& volume, std::vector<uint32_t>& result) noexcept {
+        result.clear();
+        queryFlatBVHNodes(
+            bvh.nodes,
+            volume,
+            [&](uint32_t i) { return bvh.prims[i].getBound(); },
+            [&](uint32_t first, uint32_t count) {
+                for (uint32_t i = first; i < first + count; ++i) {
+                    result.push_back(bvh.primIndices[i]);
+                }
+            });
+    }
+
+    template<typename Prim>
+    void queryFrustum(TypedBVH<Prim> const& bvh, Frustum const& frustum, std::vector<uint32_t>& result) noexcept {
+        queryOverlap(bvh, frustum, result);
+    }
+
+    template<typename Prim>
+    void queryBox(TypedBVH<Prim> const& bvh, BoundingBoxAABB const& box, std::vector<uint32_t>& result) noexcept {
+        queryOverlap(bvh, box, result);
+    }
+
+    template<typename Prim>
+    void querySphere(TypedBVH<Prim> const& bvh, glm::vec3 const& center, float radius, std::vector<uint32_t>& result) noexcept {
+        queryOverlap(bvh, BoundingSphere{ center, radius }, result);
+    }
+
+}
@@ -0,0 +1,304 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/DistanceQuery.h"
+#include "SimpleGL/Core/ThreadPool.h"
+
+namespace SGL::Utility {
+
+    glm::vec3 closestPointTriangle(
+        glm::vec3 const& point,
+        glm::vec3 const& a,
+        glm::vec3 const& b,
+        glm::vec3 const& c,
+        glm::vec2* barycentric) noexcept {
+        glm::vec3 const ab = b - a;
+        glm::vec3 const ac = c - a;
+        glm::vec3 const ap = point - a;
+        glm::vec2 weight(0.0f);
+
+        float const d1 = glm::dot(ab, ap);
+        float const d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) {
+            if (barycentric) *barycentric = weight;
+            return a;
+        }
+
+        glm::vec3 const bp = point - b;
+        float const d3 = glm::dot(ab, bp);
+        float const d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3) {
+            if (barycentric) *barycentric = glm::vec2(1.0f, 0.0f);
+            return b;
+        }
+
+        float const vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+            weight = glm::vec2(d1 / (d1 - d3), 0.0f);
+        }
+        else {
+            glm::vec3 const cp = point - c;
+            float const d5 = glm::dot(ab, cp);
+            float const d6 = glm::dot(ac, cp);
+            if (d6 >= 0.0f && d5 <= d6) {
+                weight = glm::vec2(0.0f, 1.0f);
+            }
+            else {
+                float const vb = d5 * d2 - d1 * d6;
+                float const va = d3 * d6 - d5 * d4;
+                if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+                    weight = glm::vec2(0.0f, d2 / (d2 - d6));
+                }
+                else if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+                    float const w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+                    weight = glm::vec2(1.0f - w, w);
+                }
+                else {
+                    // inside the face, degenerate triangles end up in one of the regions above
+                    float const denom = 1.0f / (va + vb + vc);
+                    weight = glm::vec2(vb * denom, vc * denom);
+                }
+            }
+        }
+        if (barycentric) *barycentric = weight;
+        return a + ab * weight.x + ac * weight.y;
+    }
+
+    static inline float getBoxDistance2(glm::vec3 const& boxMin, glm::vec3 const& boxMax, glm::vec3 const& point) noexcept {
+        glm::vec3 d = glm::max(glm::max(boxMin - point, point - boxMax), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+
+    /*
+    *   Calls func(triangle, closest, barycentric) for every used lane of the pack
+    */
+    template<typename Func>
+    static inline void forEachTriangle(BVHTriangle4 const& pack, glm::vec3 const& point, Func const& func) noexcept {
+        for (uint32_t lane = 0; lane < 4; ++lane) {
+            if (pack.index[lane] == ~0U) continue;
+            glm::vec3 a, b, c;
+            pack.getVertices(lane, a, b, c);
+            glm::vec2 barycentric;
+            glm::vec3 const closest = closestPointTriangle(point, a, b, c, &barycentric);
+            func(pack.index[lane], closest, barycentric);
+        }
+    }
+
+    struct DistanceEntry {
+        uint32_t node;
+        float distance2;
+    };
+
+    bool closestPoint(TriangleBVH const& bvh, glm::vec3 const& point, DistanceHit& hit, float maxDistance) noexcept {
+        if (bvh.nodes.empty()) return false;
+        FlatBVHNode const* nodes = bvh.nodes.data();
+        DistanceHit best;
+        best.distance2 = maxDistance * maxDistance;
+
+        BVHTraversalStack<DistanceEntry> stack;
+        stack.push({ 0, getBoxDistance2(nodes[0].min, nodes[0].max, point) });
+        while (!stack.empty()) {
+            DistanceEntry const entry = stack.pop();
+            if (entry.distance2 >= best.distance2) continue;
+            FlatBVHNode const& node = nodes[entry.node];
+
+            if (node.isLeaf()) {
+                for (uint32_t i = node.offset; i < node.offset + node.primCount; ++i) {
+                    forEachTriangle(bvh.packs[i], point, [&](uint32_t triangle, glm::vec3 const& closest, glm::vec2 const& barycentric) {
+                        glm::vec3 const d = closest - point;
+                        float const distance2 = glm::dot(d, d);
+                        if (distance2 < best.distance2) {
+                            best.point = closest;
+                            best.distance2 = distance2;
+                            best.barycentric = barycentric;
+                            best.primitive = triangle;
+                        }
+                    });
+                }
+                continue;
+            }
+
+            DistanceEntry nearChild{ entry.node + 1, getBoxDistance2(nodes[entry.node + 1].min, nodes[entry.node + 1].max, point) };
+            DistanceEntry farChild{ node.offset, getBoxDistance2(nodes[node.offset].min, nodes[node.offset].max, point) };
+            if (nearChild.distance2 > farChild.distance2) std::swap(nearChild, farChild);
+            if (farChild.distance2 < best.distance2) stack.push(farChild);
+            if (nearChild.distance2 < best.distance2) stack.push(nearChild);
+        }
+
+        if (!best.isHit()) return false;
+        hit = best;
+        return true;
+    }
+
+    bool closestPoint(BVH const& bvh, glm::vec3 const& point, DistanceHit& hit, float maxDistance) noexcept {
+        if (bvh.nodes.empty()) return false;
+        DistanceHit best;
+        best.distance2 = maxDistance * maxDistance;
+
+        BVHTraversalStack<DistanceEntry> stack;
+        stack.push({ 0, bvh.nodes[0].bound.getDistance2(point) });
+        while (!stack.empty()) {
+            DistanceEntry const entry = stack.pop();
+            if (entry.distance2 >= best.distance2) continue;
+            BVHNode const& node = bvh.nodes[entry.node];
+
+            if (node.isLeaf()) {
+                for (uint32_t i = node.firstPrim; i < node.firstPrim + node.primCount; ++i) {
+                    glm::vec3 const closest = bvh.prims[i]->closestPoint(point);
+                    glm::vec3 const d = closest - point;
+                    float const distance2 = glm::dot(d, d);
+                    if (distance2 < best.distance2) {
+                        best.point = closest;
+                        best.distance2 = distance2;
+                        best.primitive = i;
+                    }
+                }
+                continue;
+            }
+
+            DistanceEntry nearChild{ node.left, bvh.nodes[node.left].bound.getDistance2(point) };
+            DistanceEntry farChild{ node.right, bvh.nodes[node.right].bound.getDistance2(point) };
+            if (nearChild.distance2 > farChild.distance2) std::swap(nearChild, farChild);
+            if (farChild.distance2 < best.distance2) stack.push(farChild);
+            if (nearChild.distance2 < best.distance2) stack.push(nearChild);
+        }
+
+        if (!best.isHit()) return false;
+        hit = best;
+        return true;
+    }
+
+    void queryRadius(TriangleBVH const& bvh, glm::vec3 const& center, float radius, std::vector<uint32_t>& result) noexcept {
+        result.clear();
+        if (bvh.nodes.empty()) return;
+        float const radius2 = radius * radius;
+        BVHTraversalStack<uint32_t> stack;
+        stack.push(0);
+        while (!stack.empty()) {
+            uint32_t const nodeIdx = stack.pop();
+            FlatBVHNode const& node = bvh.nodes[nodeIdx];
+            if (getBoxDistance2(node.min, node.max, center) > radius2) continue;
+            if (node.isLeaf()) {
+                for (uint32_t i = node.offset; i < node.offset + node.primCount; ++i) {
+                    forEachTriangle(bvh.packs[i], center, [&](uint32_t triangle, glm::vec3 const& closest, glm::vec2 const&) {
+                        glm::vec3 const d = closest - center;
+                        if (glm::dot(d, d) <= radius2) result.push_back(triangle);
+                    });
+                }
+                continue;
+            }
+            stack.push(node.offset);
+            stack.push(nodeIdx + 1);
+        }
+    }
+
+    void queryRadius(BVH const& bvh, glm::vec3 const& center, float radius, std::vector<uint32_t>& result) noexcept {
+        result.clear();
+        if (bvh.nodes.empty()) return;
+        float const radius2 = radius * radius;
+        BVHTraversalStack<uint32_t> stack;
+        stack.push(0);
+        while (!stack.empty()) {
+            BVHNode const& node = bvh.nodes[stack.pop()];
+            if (node.bound.getDistance2(center) > radius2) continue;
+            if (node.isLeaf()) {
+                for (uint32_t i = node.firstPrim; i < node.firstPrim + node.primCount; ++i) {
+                    glm::vec3 const d = bvh.prims[i]->closestPoint(center) - center;
+                    if (glm::dot(d, d) <= radius2) result.push_back(i);
+                }
+                continue;
+            }
+            stack.push(node.right);
+            stack.push(node.left);
+        }
+    }
+
+    template<typename Tree>
+    static void closestPointStreamImpl(Tree const& bvh, std::vector<glm::vec3> const& points, std::vector<DistanceHit>& hits, DistanceQueryOption const& option) noexcept {
+        uint32_t const count = static_cast<uint32_t>(points.size());
+        hits.assign(count, DistanceHit());
+        auto queryChunk = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                closestPoint(bvh, points[i], hits[i], option.maxDistance);
+            }
+        };
+        if (option.parallel) {
+            ThreadPool::instance().parallelFor(0, count, std::max(option.chunkSize, 1U), queryChunk);
+        }
+        else {
+            queryChunk(0, count);
+        }
+    }
+
+    template<typename Tree>
+    static void queryRadiusStreamImpl(
+        Tree const& bvh,
+        std::vector<glm::vec3> const& centers,
+        float radius,
+        std::vector<uint32_t>& offsets,
+        std::vector<uint32_t>& result,
+        DistanceQueryOption const& option) noexcept {
+        uint32_t const count = static_cast<uint32_t>(centers.size());
+        uint32_t const chunkSize = std::max(option.chunkSize, 1U);
+        uint32_t const chunkCount = (count + chunkSize - 1) / chunkSize;
+
+        // every chunk gathers its own results, which are concatenated in query order afterwards
+        std::vector<std::vector<uint32_t>> chunkResults(chunkCount);
+        offsets.assign(count + 1, 0);
+        auto queryChunks = [&](uint32_t begin, uint32_t end) {
+            std::vector<uint32_t> found;
+            for (uint32_t chunk = begin; chunk < end; ++chunk) {
+                auto& chunkResult = chunkResults[chunk];
+                uint32_t const last = std::min((chunk + 1) * chunkSize, count);
+                for (uint32_t i = chunk * chunkSize; i < last; ++i) {
+                    queryRadius(bvh, centers[i], radius, found);
+                    chunkResult.insert(chunkResult.end(), found.begin(), found.end());
+                    offsets[i + 1] = static_cast<uint32_t>(found.size());
+                }
+            }
+        };
+        if (option.parallel) {
+            ThreadPool::instance().parallelFor(0, chunkCount, 1, queryChunks);
+        }
+        else {
+            queryChunks(0, chunkCount);
+        }
+
+        for (uint32_t i = 0; i < count; ++i) {
+            offsets[i + 1] += offsets[i];
+        }
+        result.clear();
+        result.reserve(offsets[count]);
+        for (auto const& chunkResult : chunkResults) {
+            result.insert(result.end(), chunkResult.begin(), chunkResult.end());
+        }
+    }
+
+    void closestPointStream(TriangleBVH const& bvh, std::vector<glm::vec3> const& points, std::vector<DistanceHit>& hits, DistanceQueryOption const& option) noexcept {
+        closestPointStreamImpl(bvh, points, hits, option);
+    }
+
+    void closestPointStream(BVH const& bvh, std::vector<glm::vec3> const& points, std::vector<DistanceHit>& hits, DistanceQueryOption const& option) noexcept {
+        closestPointStreamImpl(bvh, points, hits, option);
+    }
+
+    void queryRadiusStream(
+        TriangleBVH const& bvh,
+        std::vector<glm::vec3> const& centers,
+        float radius,
+        std::vector<uint32_t>& offsets,
+        std::vector<uint32_t>& result,
+        DistanceQueryOption const& option) noexcept {
+        queryRadiusStreamImpl(bvh, centers, radius, offsets, result, option);
+    }
+
+    void queryRadiusStream(
+        BVH const& bvh,
+        std::vector<glm::vec3> const& centers,
+        float radius,
+        std::vector<uint32_t>& offsets,
+        std::vector<uint32_t>& result,
+        DistanceQueryOption const& option) noexcept {
+        queryRadiusStreamImpl(bvh, centers, radius, offsets, result, option);
+    }
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "SimpleGL/Utility/TriangleBVH.h"
+
+namespace SGL::Utility {
+
+    /*
+    *   Closest point of triangle abc to point, by the Voronoi regions of its vertices and edges
+    *       barycentric receives the weights of b and c
+    */
+    glm::vec3 closestPointTriangle(
+        glm::vec3 const& point,
+        glm::vec3 const& a,
+        glm::vec3 const& b,
+        glm::vec3 const& c,
+        glm::vec2* barycentric = nullptr) noexcept;
+
+    struct DistanceHit {
+
+        glm::vec3 point = glm::vec3(0.0f);
+        /*
+        *   Squared distance from the query point to point
+        */
+        float distance2 = INFINITY;
+        /*
+        *   Weights of v1 and v2 of the closest triangle, zero for a BVH
+        */
+        glm::vec2 barycentric = glm::vec2(0.0f);
+        /*
+        *   Triangle index for a TriangleBVH, index in bvh.prims for a BVH
+        */
+        uint32_t primitive = ~0U;
+
+        bool isHit() const noexcept { return primitive != ~0U; }
+
+    };
+
+    /*
+    *   Branch and bound search, children are visited nearest box first and boxes farther than the best primitive so far are skipped
+    *   Fails if nothing lies within maxDistance, hit is only written on success
+    */
+    bool closestPoint(TriangleBVH const& bvh, glm::vec3 const& point, DistanceHit& hit, float maxDistance = INFINITY) noexcept;
+    /*
+    *   Uses BVHPrimitive::closestPoint
+    */
+    bool closestPoint(BVH const& bvh, glm::vec3 const& point, DistanceHit& hit, float maxDistance = INFINITY) noexcept;
+
+    /*
+    *   Every primitive whose exact distance to center is within radius, result is cleared first
+    *   Unlike querySphere this tests the primitives themselves and not only their bounds
+    */
+    void queryRadius(TriangleBVH const& bvh, glm::vec3 const& center, float radius, std::vector<uint32_t>& result) noexcept;
+    void queryRadius(BVH const& bvh, glm::vec3 const& center, float radius, std::vector<uint32_t>& result) noexcept;
+
+    struct DistanceQueryOption {
+        /*
+        *   Points farther than this from every primitive get no hit
+        */
+        float maxDistance = INFINITY;
+        /*
+        *   Run chunks of queries on ThreadPool::instance()
+        */
+        bool parallel = true;
+        uint32_t chunkSize = 256;
+    };
+
+    /*
+    *   Batch queries, hits[i] belongs to points[i]
+    */
+    void closestPointStream(TriangleBVH const& bvh, std::vector<glm::vec3> const& points, std::vector<DistanceHit>& hits, DistanceQueryOption const& option = DistanceQueryOption()) noexcept;
+    void closestPointStream(BVH const& bvh, std::vector<glm::vec3> const& points, std::vector<DistanceHit>& hits, DistanceQueryOption const& option = DistanceQueryOption()) noexcept;
+
+    /*
+    *   Batch radius queries, the primitives of centers[i] are result[offsets[i]] to result[offsets[i + 1]]
+    */
+    void queryRadiusStream(
+        TriangleBVH const& bvh,
+        std::vector<glm::vec3> const& centers,
+        float radius,
+        std::vector<uint32_t>& offsets,
+        std::vector<uint32_t>& result,
+        DistanceQueryOption const& option = DistanceQueryOption()) noexcept;
+    void queryRadiusStream(
+        BVH const& bvh,
+        std::vector<glm::vec3> const& centers,
+        float radius,
+        std::vector<uint32_t>& offsets,
+        std::vector<uint32_t>& result,
+        DistanceQueryOption const& option = DistanceQueryOption()) noexcept;
+
+}
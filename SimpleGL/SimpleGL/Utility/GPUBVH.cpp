@@ -0,0 +1,231 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/GPUBVH.h"
+#include "SimpleGL/Core/Buffer.h"
+#include "SimpleGL/Core/Shader.h"
+
+namespace SGL::Utility {
+
+    /*
+    *   Same ordered traversal as the CPU ray queries, the nearer child is visited first and the other one is pushed
+    *   Triangles are tested one lane at a time with the Moller Trumbore test of intersectTriangle4
+    */
+    static char const* const traversalSource = R"GLSL(
+#ifndef SGL_BVH_GLSL
+#define SGL_BVH_GLSL
+
+#ifndef SGL_BVH_NODE_BINDING
+#define SGL_BVH_NODE_BINDING 0
+#endif
+#ifndef SGL_BVH_TRIANGLE_BINDING
+#define SGL_BVH_TRIANGLE_BINDING 1
+#endif
+#ifndef SGL_BVH_STACK_SIZE
+#define SGL_BVH_STACK_SIZE 32
+#endif
+
+#define SGL_BVH_NO_HIT 3.402823466e+38
+#define SGL_BVH_EPSILON 1e-6
+
+// FlatBVHNode, offset is the first pack of a leaf or the second child of an interior node
+struct SGLBVHNode {
+    vec3 min;
+    uint offset;
+    vec3 max;
+    uint primCount;
+};
+
+// BVHTriangle4, components are [axis][lane]
+struct SGLBVHTriangle4 {
+    vec4 v0[3];
+    vec4 e1[3];
+    vec4 e2[3];
+    vec4 v1[3];
+    vec4 v2[3];
+    uvec4 triangle;
+};
+
+layout(std430, binding = SGL_BVH_NODE_BINDING) readonly buffer SGLBVHNodeBuffer {
+    SGLBVHNode sglBVHNodes[];
+};
+
+layout(std430, binding = SGL_BVH_TRIANGLE_BINDING) readonly buffer SGLBVHTriangleBuffer {
+    SGLBVHTriangle4 sglBVHTriangles[];
+};
+
+struct SGLRayHit {
+    float t;
+    // weights of v1 and v2
+    vec2 barycentric;
+    // triangle index in the build input
+    uint primitive;
+    uint pack;
+    uint lane;
+};
+
+float sglBVHIntersectNode(uint nodeIdx, vec3 origin, vec3 invDir, float tMin, float tMax) {
+    vec3 t0 = (sglBVHNodes[nodeIdx].min - origin) * invDir;
+    vec3 t1 = (sglBVHNodes[nodeIdx].max - origin) * invDir;
+    vec3 tNear = min(t0, t1);
+    vec3 tFar = max(t0, t1);
+    float tEnter = max(max(tNear.x, tNear.y), max(tNear.z, tMin));
+    float tExit = min(min(tFar.x, tFar.y), min(tFar.z, tMax));
+    return tEnter <= tExit ? tEnter : SGL_BVH_NO_HIT;
+}
+
+bool sglBVHIntersectTriangle(uint pack, uint lane, vec3 origin, vec3 dir, float tMin, inout float tMax, out vec2 barycentric) {
+    vec3 v0 = vec3(sglBVHTriangles[pack].v0[0][lane], sglBVHTriangles[pack].v0[1][lane], sglBVHTriangles[pack].v0[2][lane]);
+    vec3 e1 = vec3(sglBVHTriangles[pack].e1[0][lane], sglBVHTriangles[pack].e1[1][lane], sglBVHTriangles[pack].e1[2][lane]);
+    vec3 e2 = vec3(sglBVHTriangles[pack].e2[0][lane], sglBVHTriangles[pack].e2[1][lane], sglBVHTriangles[pack].e2[2][lane]);
+    barycentric = vec2(0.0);
+    vec3 h = cross(dir, e2);
+    float a = dot(e1, h);
+    if (abs(a) < SGL_BVH_EPSILON) return false;
+    float f = 1.0 / a;
+    vec3 s = origin - v0;
+    float u = f * dot(s, h);
+    if (u < -SGL_BVH_EPSILON || u > 1.0 + SGL_BVH_EPSILON) return false;
+    vec3 q = cross(s, e1);
+    float v = f * dot(dir, q);
+    if (v < -SGL_BVH_EPSILON || u + v > 1.0 + SGL_BVH_EPSILON) return false;
+    float t = f * dot(e2, q);
+    if (t <= max(SGL_BVH_EPSILON, tMin) || t >= tMax) return false;
+    tMax = t;
+    barycentric = vec2(u, v);
+    return true;
+}
+
+bool sglBVHTraverse(vec3 origin, vec3 dir, float tMin, float tMax, bool anyHit, out SGLRayHit hit) {
+    // zero components would give 0 * inf in the slab test
+    vec3 invDir = 1.0 / mix(dir, vec3(1e-20), equal(dir, vec3(0.0)));
+    hit.t = tMax;
+    hit.barycentric = vec2(0.0);
+    hit.primitive = 0xFFFFFFFFu;
+    hit.pack = 0u;
+    hit.lane = 0u;
+    bool isHit = false;
+
+    uint stack[SGL_BVH_STACK_SIZE];
+    uint stackSize = 0u;
+    uint nodeIdx = 0u;
+    while (true) {
+        uint primCount = sglBVHNodes[nodeIdx].primCount;
+        if (primCount > 0u) {
+            uint first = sglBVHNodes[nodeIdx].offset;
+            for (uint pack = first; pack < first + primCount; ++pack) {
+                for (uint lane = 0u; lane < 4u; ++lane) {
+                    vec2 barycentric;
+                    if (!sglBVHIntersectTriangle(pack, lane, origin, dir, tMin, hit.t, barycentric)) continue;
+                    isHit = true;
+                    hit.barycentric = barycentric;
+                    hit.primitive = sglBVHTriangles[pack].triangle[lane];
+                    hit.pack = pack;
+                    hit.lane = lane;
+                    if (anyHit) return true;
+                }
+            }
+            if (stackSize == 0u) break;
+            nodeIdx = stack[--stackSize];
+            continue;
+        }
+
+        uint child1 = nodeIdx + 1u;
+        uint child2 = sglBVHNodes[nodeIdx].offset;
+        float t1 = sglBVHIntersectNode(child1, origin, invDir, tMin, hit.t);
+        float t2 = sglBVHIntersectNode(child2, origin, invDir, tMin, hit.t);
+        if (t1 > t2) {
+            float t = t1; t1 = t2; t2 = t;
+            uint c = child1; child1 = child2; child2 = c;
+        }
+        if (t1 == SGL_BVH_NO_HIT) {
+            if (stackSize == 0u) break;
+            nodeIdx = stack[--stackSize];
+        }
+        else {
+            nodeIdx = child1;
+            if (t2 != SGL_BVH_NO_HIT && stackSize < uint(SGL_BVH_STACK_SIZE)) stack[stackSize++] = child2;
+        }
+    }
+    return isHit;
+}
+
+// closest hit within (tMin, tMax)
+bool sglBVHIntersect(vec3 origin, vec3 dir, float tMin, float tMax, out SGLRayHit hit) {
+    return sglBVHTraverse(origin, dir, tMin, tMax, false, hit);
+}
+
+// any hit within (tMin, tMax), for shadow and occlusion rays
+bool sglBVHOccluded(vec3 origin, vec3 dir, float tMin, float tMax) {
+    SGLRayHit hit;
+    return sglBVHTraverse(origin, dir, tMin, tMax, true, hit);
+}
+
+// unit geometric normal following the triangle winding
+vec3 sglBVHHitNormal(SGLRayHit hit) {
+    vec3 e1 = vec3(sglBVHTriangles[hit.pack].e1[0][hit.lane], sglBVHTriangles[hit.pack].e1[1][hit.lane], sglBVHTriangles[hit.pack].e1[2][hit.lane]);
+    vec3 e2 = vec3(sglBVHTriangles[hit.pack].e2[0][hit.lane], sglBVHTriangles[hit.pack].e2[1][hit.lane], sglBVHTriangles[hit.pack].e2[2][hit.lane]);
+    return normalize(cross(e1, e2));
+}
+
+#endif
+)GLSL";
+
+    static_assert(offsetof(FlatBVHNode, offset) == 12 && offsetof(FlatBVHNode, max) == 16, "FlatBVHNode should match SGLBVHNode");
+    static_assert(offsetof(BVHTriangle4, e1) == 48 && offsetof(BVHTriangle4, index) == 240, "BVHTriangle4 should match SGLBVHTriangle4");
+
+    GPUBVH::~GPUBVH() = default;
+
+    std::unique_ptr<GPUBVH> GPUBVH::create(TriangleBVH const& bvh) noexcept {
+        addShaderInclude();
+
+        size_t const nodeBytes = bvh.nodes.size() * sizeof(FlatBVHNode);
+        size_t const packBytes = bvh.packs.size() * sizeof(BVHTriangle4);
+        if (nodeBytes > std::numeric_limits<uint32_t>::max() || packBytes > std::numeric_limits<uint32_t>::max()) {
+            SGL_LOG_ERROR("TriangleBVH too large for a storage buffer: {0} nodes, {1} packs", bvh.nodes.size(), bvh.packs.size());
+            return nullptr;
+        }
+
+        auto gpu = std::make_unique<GPUBVH>();
+        if (bvh.nodes.empty()) {
+            // traversal always reads the root, a leaf of one degenerate pack never hits
+            FlatBVHNode root{};
+            root.primCount = 1;
+            BVHTriangle4 pack;
+            for (uint32_t lane = 0; lane < 4; ++lane) {
+                pack.setTriangle(lane, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), ~0U);
+            }
+            gpu->nodes = std::make_unique<StorageBuffer>(&root, static_cast<uint32_t>(sizeof(root)));
+            gpu->triangles = std::make_unique<StorageBuffer>(&pack, static_cast<uint32_t>(sizeof(pack)));
+            gpu->nodeCount = 1;
+            gpu->packCount = 1;
+            gpu->stackSize = 0;
+            return gpu;
+        }
+
+        gpu->nodes = std::make_unique<StorageBuffer>(const_cast<FlatBVHNode*>(bvh.nodes.data()), static_cast<uint32_t>(nodeBytes));
+        gpu->triangles = std::make_unique<StorageBuffer>(const_cast<BVHTriangle4*>(bvh.packs.data()), static_cast<uint32_t>(packBytes));
+        gpu->nodeCount = static_cast<uint32_t>(bvh.nodes.size());
+        gpu->packCount = static_cast<uint32_t>(bvh.packs.size());
+        // the root has depth 1 and at most one node is pushed per level below it
+        gpu->stackSize = bvh.stats.maxDepth > 0 ? bvh.stats.maxDepth - 1 : 0;
+        if (gpu->stackSize > DefaultStackSize) {
+            SGL_LOG_WARN("GPUBVH needs a traversal stack of {0}, define SGL_BVH_STACK_SIZE before including {1}", gpu->stackSize, ShaderInclude);
+        }
+        return gpu;
+    }
+
+    void GPUBVH::addShaderInclude() noexcept {
+        static bool const added = (Shader::addInclude(ShaderInclude, traversalSource), true);
+        (void)added;
+    }
+
+    char const* GPUBVH::getShaderSource() noexcept {
+        return traversalSource;
+    }
+
+    void GPUBVH::bind(uint32_t nodeBinding, uint32_t triangleBinding) const noexcept {
+        nodes->bind(nodeBinding);
+        triangles->bind(triangleBinding);
+    }
+
+}
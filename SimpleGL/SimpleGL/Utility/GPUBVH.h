@@ -0,0 +1,62 @@
+#pragma once
+
+#include "SimpleGL/Utility/TriangleBVH.h"
+
+namespace SGL {
+
+    struct StorageBuffer;
+
+}
+
+namespace SGL::Utility {
+
+    /*
+    *   TriangleBVH uploaded to storage buffers for traversal in compute shaders
+    *   FlatBVHNode and BVHTriangle4 already have the std430 layout of the structs in the shader include,
+    *   so both arrays are uploaded as they are, also when they are mapped from a cache file
+    *
+    *   Shader files use it through
+    *       #define SGL_BVH_STACK_SIZE 48        // optional, at least stackSize, 32 by default
+    *       #include "SimpleGL/BVH.glsl"
+    *   which declares sglBVHIntersect (closest hit), sglBVHOccluded (any hit) and sglBVHHitNormal
+    *   The buffers go to bindings SGL_BVH_NODE_BINDING and SGL_BVH_TRIANGLE_BINDING, 0 and 1 unless defined before the include
+    */
+    struct GPUBVH {
+
+        static constexpr char const* ShaderInclude = "SimpleGL/BVH.glsl";
+        static constexpr uint32_t DefaultStackSize = 32;
+
+        std::unique_ptr<StorageBuffer> nodes;
+        std::unique_ptr<StorageBuffer> triangles;
+        uint32_t nodeCount = 0;
+        uint32_t packCount = 0;
+        /*
+        *   Stack entries the traversal needs for this tree, deeper nodes are skipped when SGL_BVH_STACK_SIZE is smaller
+        */
+        uint32_t stackSize = 0;
+
+        GPUBVH() = default;
+        ~GPUBVH();
+
+        GPUBVH(GPUBVH const&) = delete;
+        GPUBVH(GPUBVH&& other) = delete;
+
+        GPUBVH& operator=(GPUBVH const&) = delete;
+        GPUBVH& operator=(GPUBVH&& other) = delete;
+
+        /*
+        *   Also registers the shader include, fails if an array exceeds the 4GB a buffer can address
+        */
+        static std::unique_ptr<GPUBVH> create(TriangleBVH const& bvh) noexcept;
+
+        /*
+        *   Registers the traversal source with Shader::addInclude, needed only for shaders loaded before the first create
+        */
+        static void addShaderInclude() noexcept;
+        static char const* getShaderSource() noexcept;
+
+        void bind(uint32_t nodeBinding = 0, uint32_t triangleBinding = 1) const noexcept;
+
+    };
+
+}
@@ -0,0 +1,631 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/GPUBVHBuilder.h"
+#include "SimpleGL/Core/Buffer.h"
+#include "SimpleGL/Core/Shader.h"
+#include "SimpleGL/Core/Mesh.h"
+#include "glad/glad.h"
+
+namespace SGL::Utility {
+
+    /*
+    *   Shared by every kernel, groups beyond 65535 continue in y so the flat group index is y * x count + x
+    */
+    static char const* const kernelPrelude = R"GLSL(
+#version 430 core
+layout(local_size_x = 256) in;
+
+#define INVALID_INDEX 0xFFFFFFFFu
+
+uint getGroupIndex() {
+    return gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+}
+
+uint getGlobalIndex() {
+    return getGroupIndex() * 256u + gl_LocalInvocationIndex;
+}
+
+// FlatBVHNode
+struct Node {
+    vec3 min;
+    uint offset;
+    vec3 max;
+    uint primCount;
+};
+
+// BVHTriangle4
+struct Triangle4 {
+    vec4 v0[3];
+    vec4 e1[3];
+    vec4 e2[3];
+    vec4 v1[3];
+    vec4 v2[3];
+    uvec4 triangle;
+};
+)GLSL";
+
+    static char const* const triangleSource = R"GLSL(
+layout(std430, binding = 0) readonly buffer VertexBuffer { float vertexData[]; };
+layout(std430, binding = 1) readonly buffer IndexBuffer { uint indexData[]; };
+
+uniform int uTriangleCount;
+// in floats
+uniform int uStride;
+uniform int uPositionOffset;
+// 16 bit indices are read as the halves of the words
+uniform int uShortIndices;
+
+uint loadIndex(uint i) {
+    if (uShortIndices == 0) return indexData[i];
+    return (indexData[i >> 1u] >> ((i & 1u) * 16u)) & 0xFFFFu;
+}
+
+vec3 loadVertex(uint triangle, uint corner) {
+    uint base = loadIndex(triangle * 3u + corner) * uint(uStride) + uint(uPositionOffset);
+    return vec3(vertexData[base], vertexData[base + 1u], vertexData[base + 2u]);
+}
+
+vec3 getCentroid(uint triangle) {
+    return (loadVertex(triangle, 0u) + loadVertex(triangle, 1u) + loadVertex(triangle, 2u)) / 3.0;
+}
+
+// unsigned order of the encoded floats follows their order
+uint encodeFloat(float f) {
+    uint u = floatBitsToUint(f);
+    return (u & 0x80000000u) != 0u ? ~u : u | 0x80000000u;
+}
+
+float decodeFloat(uint u) {
+    return uintBitsToFloat((u & 0x80000000u) != 0u ? u & 0x7FFFFFFFu : ~u);
+}
+)GLSL";
+
+    static char const* const centroidBoundSource = R"GLSL(
+layout(std430, binding = 2) buffer SceneBound { uint sceneBound[6]; };
+
+shared uint groupBound[6];
+
+void main() {
+    if (gl_LocalInvocationIndex < 6u) groupBound[gl_LocalInvocationIndex] = gl_LocalInvocationIndex < 3u ? INVALID_INDEX : 0u;
+    barrier();
+    uint triangle = getGlobalIndex();
+    if (triangle < uint(uTriangleCount)) {
+        vec3 c = getCentroid(triangle);
+        for (int axis = 0; axis < 3; ++axis) {
+            atomicMin(groupBound[axis], encodeFloat(c[axis]));
+            atomicMax(groupBound[axis + 3], encodeFloat(c[axis]));
+        }
+    }
+    barrier();
+    if (gl_LocalInvocationIndex < 3u) atomicMin(sceneBound[gl_LocalInvocationIndex], groupBound[gl_LocalInvocationIndex]);
+    else if (gl_LocalInvocationIndex < 6u) atomicMax(sceneBound[gl_LocalInvocationIndex], groupBound[gl_LocalInvocationIndex]);
+}
+)GLSL";
+
+    static char const* const mortonSource = R"GLSL(
+layout(std430, binding = 2) readonly buffer SceneBound { uint sceneBound[6]; };
+layout(std430, binding = 3) writeonly buffer Keys { uint keys[]; };
+layout(std430, binding = 4) writeonly buffer Values { uint values[]; };
+
+// spread the lower 10 bits so that there are two zero bits between each
+uint expandBits(uint v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+void main() {
+    uint triangle = getGlobalIndex();
+    if (triangle >= uint(uTriangleCount)) return;
+    vec3 boundMin = vec3(decodeFloat(sceneBound[0]), decodeFloat(sceneBound[1]), decodeFloat(sceneBound[2]));
+    vec3 boundMax = vec3(decodeFloat(sceneBound[3]), decodeFloat(sceneBound[4]), decodeFloat(sceneBound[5]));
+    vec3 extent = boundMax - boundMin;
+    vec3 scale = mix(vec3(0.0), 1.0 / extent, greaterThan(extent, vec3(0.0)));
+    uvec3 q = uvec3(clamp((getCentroid(triangle) - boundMin) * scale * 1024.0, vec3(0.0), vec3(1023.0)));
+    keys[triangle] = expandBits(q.x) << 2 | expandBits(q.y) << 1 | expandBits(q.z);
+    values[triangle] = triangle;
+}
+)GLSL";
+
+    static char const* const histogramSource = R"GLSL(
+layout(std430, binding = 0) readonly buffer Keys { uint keys[]; };
+layout(std430, binding = 2) writeonly buffer Histogram { uint histogram[]; };
+
+uniform int uCount;
+uniform int uShift;
+uniform int uGroupCount;
+
+shared uint groupHistogram[16];
+
+void main() {
+    if (gl_LocalInvocationIndex < 16u) groupHistogram[gl_LocalInvocationIndex] = 0u;
+    barrier();
+    uint i = getGlobalIndex();
+    if (i < uint(uCount)) atomicAdd(groupHistogram[(keys[i] >> uShift) & 15u], 1u);
+    barrier();
+    // digit major, so the exclusive scan gives every group its start in every bucket
+    // the padding groups of a 2D dispatch have no column and would overwrite the next digit
+    if (gl_LocalInvocationIndex < 16u && getGroupIndex() < uint(uGroupCount)) histogram[gl_LocalInvocationIndex * uint(uGroupCount) + getGroupIndex()] = groupHistogram[gl_LocalInvocationIndex];
+}
+)GLSL";
+
+    static char const* const scanSource = R"GLSL(
+layout(std430, binding = 2) buffer Histogram { uint histogram[]; };
+
+uniform int uSize;
+
+shared uint partial[256];
+
+// exclusive scan in place by a single group, every invocation sums a contiguous segment
+void main() {
+    uint segment = (uint(uSize) + 255u) / 256u;
+    uint begin = min(gl_LocalInvocationIndex * segment, uint(uSize));
+    uint end = min(begin + segment, uint(uSize));
+    uint sum = 0u;
+    for (uint i = begin; i < end; ++i) sum += histogram[i];
+    partial[gl_LocalInvocationIndex] = sum;
+    barrier();
+    for (uint offset = 1u; offset < 256u; offset <<= 1) {
+        uint add = gl_LocalInvocationIndex >= offset ? partial[gl_LocalInvocationIndex - offset] : 0u;
+        barrier();
+        partial[gl_LocalInvocationIndex] += add;
+        barrier();
+    }
+    uint prefix = partial[gl_LocalInvocationIndex] - sum;
+    for (uint i = begin; i < end; ++i) {
+        uint count = histogram[i];
+        histogram[i] = prefix;
+        prefix += count;
+    }
+}
+)GLSL";
+
+    static char const* const scatterSource = R"GLSL(
+layout(std430, binding = 0) readonly buffer Keys { uint keys[]; };
+layout(std430, binding = 1) readonly buffer Values { uint values[]; };
+layout(std430, binding = 2) readonly buffer Histogram { uint histogram[]; };
+layout(std430, binding = 3) writeonly buffer KeysOut { uint keysOut[]; };
+layout(std430, binding = 4) writeonly buffer ValuesOut { uint valuesOut[]; };
+
+uniform int uCount;
+uniform int uShift;
+uniform int uGroupCount;
+
+// one hot digit counters, two 16 bit counters per word
+shared uint ranks[8][256];
+
+void main() {
+    uint i = getGlobalIndex();
+    uint lid = gl_LocalInvocationIndex;
+    bool valid = i < uint(uCount);
+    uint key = valid ? keys[i] : 0u;
+    uint digit = (key >> uShift) & 15u;
+    for (uint k = 0u; k < 8u; ++k) {
+        ranks[k][lid] = valid && (digit >> 1) == k ? 1u << ((digit & 1u) * 16u) : 0u;
+    }
+    barrier();
+    // inclusive scan of the counters, which ranks every key behind the keys of the same digit before it in the group
+    for (uint offset = 1u; offset < 256u; offset <<= 1) {
+        uint add[8];
+        for (uint k = 0u; k < 8u; ++k) add[k] = lid >= offset ? ranks[k][lid - offset] : 0u;
+        barrier();
+        for (uint k = 0u; k < 8u; ++k) ranks[k][lid] += add[k];
+        barrier();
+    }
+    // also every key of a padding group, those have no histogram column
+    if (!valid) return;
+    uint rank = ((ranks[digit >> 1][lid] >> ((digit & 1u) * 16u)) & 0xFFFFu) - 1u;
+    uint dst = histogram[digit * uint(uGroupCount) + getGroupIndex()] + rank;
+    keysOut[dst] = key;
+    valuesOut[dst] = values[i];
+}
+)GLSL";
+
+    static char const* const packSource = R"GLSL(
+layout(std430, binding = 2) readonly buffer Values { uint values[]; };
+layout(std430, binding = 3) writeonly buffer Packs { Triangle4 packs[]; };
+layout(std430, binding = 4) writeonly buffer PackBounds { vec4 packBounds[]; };
+
+void main() {
+    uint pack = getGlobalIndex();
+    uint packCount = (uint(uTriangleCount) + 3u) / 4u;
+    if (pack >= packCount) return;
+    vec3 boundMin = vec3(3.402823466e+38);
+    vec3 boundMax = vec3(-3.402823466e+38);
+    for (uint lane = 0u; lane < 4u; ++lane) {
+        uint sorted = pack * 4u + lane;
+        vec3 a = vec3(0.0);
+        vec3 b = vec3(0.0);
+        vec3 c = vec3(0.0);
+        uint triangle = INVALID_INDEX;
+        if (sorted < uint(uTriangleCount)) {
+            triangle = values[sorted];
+            a = loadVertex(triangle, 0u);
+            b = loadVertex(triangle, 1u);
+            c = loadVertex(triangle, 2u);
+            boundMin = min(boundMin, min(a, min(b, c)));
+            boundMax = max(boundMax, max(a, max(b, c)));
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            packs[pack].v0[axis][lane] = a[axis];
+            packs[pack].e1[axis][lane] = b[axis] - a[axis];
+            packs[pack].e2[axis][lane] = c[axis] - a[axis];
+            packs[pack].v1[axis][lane] = b[axis];
+            packs[pack].v2[axis][lane] = c[axis];
+        }
+        packs[pack].triangle[lane] = triangle;
+    }
+    packBounds[pack * 2u] = vec4(boundMin, 0.0);
+    packBounds[pack * 2u + 1u] = vec4(boundMax, 0.0);
+}
+)GLSL";
+
+    /*
+    *   Radix tree nodes are internal [0, packCount - 1) and leaf k at packCount - 1 + k, as in LinearBVH.cpp
+    */
+    static char const* const hierarchySource = R"GLSL(
+layout(std430, binding = 0) readonly buffer Keys { uint keys[]; };
+layout(std430, binding = 1) buffer Parents { uint parents[]; };
+// left, right, first leaf, split
+layout(std430, binding = 2) writeonly buffer Internals { uvec4 internals[]; };
+
+uniform int uPackCount;
+
+// the code of a pack is the code of its first triangle, equal codes fall back to the pack index
+int delta(int i, int j) {
+    if (j < 0 || j >= uPackCount) return -1;
+    uint x = keys[i * 4] ^ keys[j * 4];
+    if (x == 0u) return 32 + 31 - findMSB(uint(i ^ j));
+    return 31 - findMSB(x);
+}
+
+// Karras 2012
+void main() {
+    int i = int(getGlobalIndex());
+    if (i >= uPackCount - 1) return;
+    int d = delta(i, i + 1) > delta(i, i - 1) ? 1 : -1;
+    int deltaMin = delta(i, i - d);
+
+    int lengthMax = 2;
+    while (delta(i, i + lengthMax * d) > deltaMin) lengthMax *= 2;
+    int rangeLength = 0;
+    for (int stride = lengthMax / 2; stride >= 1; stride /= 2) {
+        if (delta(i, i + (rangeLength + stride) * d) > deltaMin) rangeLength += stride;
+    }
+    int j = i + rangeLength * d;
+
+    int deltaNode = delta(i, j);
+    int split = 0;
+    int stride = rangeLength;
+    do {
+        stride = (stride + 1) / 2;
+        if (delta(i, i + (split + stride) * d) > deltaNode) split += stride;
+    } while (stride > 1);
+    int gamma = i + split * d + min(d, 0);
+
+    uint leafOffset = uint(uPackCount - 1);
+    uint left = uint(gamma);
+    uint right = uint(gamma + 1);
+    if (min(i, j) == gamma) left += leafOffset;
+    if (max(i, j) == gamma + 1) right += leafOffset;
+    internals[i] = uvec4(left, right, uint(min(i, j)), uint(gamma));
+    parents[left] = uint(i);
+    parents[right] = uint(i);
+}
+)GLSL";
+
+    /*
+    *   In depth first order a node whose first leaf is a sits at 2a + the number of left turns from the root,
+    *   every leaf finds its own index and those of the ancestors it is the leftmost leaf of
+    */
+    static char const* const emitSource = R"GLSL(
+layout(std430, binding = 0) readonly buffer Parents { uint parents[]; };
+layout(std430, binding = 1) readonly buffer Internals { uvec4 internals[]; };
+layout(std430, binding = 2) writeonly buffer NodeIndices { uint nodeIndices[]; };
+layout(std430, binding = 3) writeonly buffer Nodes { Node nodes[]; };
+
+uniform int uPackCount;
+
+void main() {
+    uint leaf = getGlobalIndex();
+    if (leaf >= uint(uPackCount)) return;
+    uint node = uint(uPackCount - 1) + leaf;
+
+    uint leftTurns = 0u;
+    uint child = node;
+    uint parent = parents[node];
+    while (parent != INVALID_INDEX) {
+        if (internals[parent].x == child) ++leftTurns;
+        child = parent;
+        parent = parents[parent];
+    }
+
+    uint index = leaf * 2u + leftTurns;
+    nodeIndices[node] = index;
+    nodes[index].offset = leaf;
+    nodes[index].primCount = 1u;
+
+    child = node;
+    parent = parents[node];
+    while (parent != INVALID_INDEX && internals[parent].x == child) {
+        --index;
+        uvec4 internal = internals[parent];
+        nodeIndices[parent] = index;
+        // the second child follows the 2 * leaves - 1 nodes of the first one
+        nodes[index].offset = index + 2u * (internal.w + 1u - internal.z);
+        nodes[index].primCount = 0u;
+        child = parent;
+        parent = parents[parent];
+    }
+}
+)GLSL";
+
+    static char const* const boundSource = R"GLSL(
+layout(std430, binding = 0) readonly buffer Parents { uint parents[]; };
+layout(std430, binding = 1) readonly buffer Internals { uvec4 internals[]; };
+layout(std430, binding = 2) readonly buffer NodeIndices { uint nodeIndices[]; };
+layout(std430, binding = 3) coherent buffer Nodes { Node nodes[]; };
+layout(std430, binding = 4) readonly buffer PackBounds { vec4 packBounds[]; };
+layout(std430, binding = 5) buffer Counters { uint counters[]; };
+
+uniform int uPackCount;
+
+// the second child to finish merges both bounds and goes on to the parent
+void main() {
+    uint leaf = getGlobalIndex();
+    if (leaf >= uint(uPackCount)) return;
+    uint node = uint(uPackCount - 1) + leaf;
+    vec3 boundMin = packBounds[leaf * 2u].xyz;
+    vec3 boundMax = packBounds[leaf * 2u + 1u].xyz;
+    uint index = nodeIndices[node];
+    nodes[index].min = boundMin;
+    nodes[index].max = boundMax;
+    memoryBarrierBuffer();
+
+    uint parent = parents[node];
+    while (parent != INVALID_INDEX) {
+        if (atomicAdd(counters[parent], 1u) == 0u) return;
+        uvec4 internal = internals[parent];
+        uint sibling = nodeIndices[internal.x == node ? internal.y : internal.x];
+        boundMin = min(boundMin, nodes[sibling].min);
+        boundMax = max(boundMax, nodes[sibling].max);
+        index = nodeIndices[parent];
+        nodes[index].min = boundMin;
+        nodes[index].max = boundMax;
+        memoryBarrierBuffer();
+        node = parent;
+        parent = parents[parent];
+    }
+}
+)GLSL";
+
+    static std::unique_ptr<Shader> createKernel(std::initializer_list<char const*> parts) noexcept {
+        std::string code = kernelPrelude;
+        for (auto part : parts) {
+            code += part;
+        }
+        ShaderModule module(code.c_str(), ShaderModuleType::Compute);
+        auto shader = std::make_unique<Shader>(std::initializer_list<ShaderModule*>{ &module });
+        GLint linked = 0;
+        glGetProgramiv(shader->handle, GL_LINK_STATUS, &linked);
+        if (!linked) return nullptr;
+        return shader;
+    }
+
+    static void bindStorage(Buffer const& buffer, uint32_t binding) noexcept {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer.handle);
+    }
+
+    static void clearStorage(StorageBuffer const& buffer, uint32_t value) noexcept {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.handle);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &value);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    /*
+    *   Beyond 65535 groups the grid is x by y, the last row is padded with groups past groupCount that every kernel has to skip
+    */
+    static void dispatchGroups(uint32_t groupCount) noexcept {
+        if (groupCount == 0) return;
+        uint32_t const maxGroups = 65535;
+        uint32_t const x = std::min(groupCount, maxGroups);
+        uint32_t const y = (groupCount + x - 1) / x;
+        glDispatchCompute(x, y, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    static uint32_t getGroupCount(uint32_t count) noexcept {
+        return (count + GPUBVHBuilder::GroupSize - 1) / GPUBVHBuilder::GroupSize;
+    }
+
+    static void growStorage(std::unique_ptr<StorageBuffer>& buffer, size_t size) noexcept {
+        size = std::max<size_t>(size, 16);
+        if (buffer && buffer->size >= size) return;
+        buffer = std::make_unique<StorageBuffer>(nullptr, static_cast<uint32_t>(size), BufferUsageType::Dynamic);
+    }
+
+    GPUBVHBuilder::~GPUBVHBuilder() = default;
+
+    std::unique_ptr<GPUBVHBuilder> GPUBVHBuilder::create() noexcept {
+        auto builder = std::make_unique<GPUBVHBuilder>();
+        builder->centroidBoundShader = createKernel({ triangleSource, centroidBoundSource });
+        builder->mortonShader = createKernel({ triangleSource, mortonSource });
+        builder->histogramShader = createKernel({ histogramSource });
+        builder->scanShader = createKernel({ scanSource });
+        builder->scatterShader = createKernel({ scatterSource });
+        builder->packShader = createKernel({ triangleSource, packSource });
+        builder->hierarchyShader = createKernel({ hierarchySource });
+        builder->emitShader = createKernel({ emitSource });
+        builder->boundShader = createKernel({ boundSource });
+        for (auto shader : { &builder->centroidBoundShader, &builder->mortonShader, &builder->histogramShader, &builder->scanShader, &builder->scatterShader,
+            &builder->packShader, &builder->hierarchyShader, &builder->emitShader, &builder->boundShader }) {
+            if (!*shader) {
+                SGL_LOG_ERROR("GPUBVHBuilder kernels failed to link");
+                return nullptr;
+            }
+        }
+        GPUBVH::addShaderInclude();
+        return builder;
+    }
+
+    void GPUBVHBuilder::build(
+        Buffer const& vertices,
+        uint32_t stride,
+        uint32_t positionOffset,
+        Buffer const& indices,
+        uint32_t triangleCount,
+        GPUBVH& bvh,
+        IndexType indexType) noexcept {
+        SGL_ASSERT(stride % 4 == 0 && positionOffset % 4 == 0, "GPUBVHBuilder reads positions as floats");
+        uint32_t const packCount = std::max((triangleCount + 3) / 4, 1U);
+        uint32_t const nodeCount = packCount * 2 - 1;
+        if (static_cast<uint64_t>(packCount) * sizeof(BVHTriangle4) > std::numeric_limits<uint32_t>::max()) {
+            SGL_LOG_ERROR("GPUBVHBuilder: {0} triangles do not fit a storage buffer", triangleCount);
+            return;
+        }
+
+        growStorage(bvh.nodes, nodeCount * sizeof(FlatBVHNode));
+        growStorage(bvh.triangles, packCount * sizeof(BVHTriangle4));
+        bvh.nodeCount = nodeCount;
+        bvh.packCount = packCount;
+        // 30 code bits and the pack index bits that break ties, each radix tree level consumes at least one,
+        // and no tree of packCount leaves is deeper than packCount levels
+        uint32_t indexBits = 0;
+        while ((1ULL << indexBits) < packCount) ++indexBits;
+        bvh.stackSize = packCount > 1 ? std::min(30 + indexBits, packCount - 1) : 0;
+        if (bvh.stackSize > warnedStackSize) {
+            warnedStackSize = bvh.stackSize;
+            SGL_LOG_WARN("GPUBVHBuilder may need a traversal stack of {0}, define SGL_BVH_STACK_SIZE before including {1}", bvh.stackSize, GPUBVH::ShaderInclude);
+        }
+
+        if (triangleCount == 0) {
+            // same placeholder as GPUBVH::create, a leaf of one degenerate pack
+            FlatBVHNode root{};
+            root.primCount = 1;
+            BVHTriangle4 pack;
+            for (uint32_t lane = 0; lane < 4; ++lane) {
+                pack.setTriangle(lane, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), ~0U);
+            }
+            bvh.nodes->update(&root, 0, sizeof(root));
+            bvh.triangles->update(&pack, 0, sizeof(pack));
+            return;
+        }
+
+        if (capacity < triangleCount) {
+            capacity = triangleCount;
+            growStorage(sceneBound, 6 * sizeof(uint32_t));
+            for (uint32_t i = 0; i < 2; ++i) {
+                growStorage(keys[i], capacity * sizeof(uint32_t));
+                growStorage(values[i], capacity * sizeof(uint32_t));
+            }
+            growStorage(histogram, 16 * getGroupCount(capacity) * sizeof(uint32_t));
+            uint32_t const maxPacks = (capacity + 3) / 4;
+            growStorage(packBounds, maxPacks * 2 * sizeof(glm::vec4));
+            growStorage(parents, (maxPacks * 2 - 1) * sizeof(uint32_t));
+            growStorage(internals, maxPacks * sizeof(glm::uvec4));
+            growStorage(nodeIndices, (maxPacks * 2 - 1) * sizeof(uint32_t));
+            growStorage(counters, maxPacks * sizeof(uint32_t));
+        }
+
+        uint32_t const triangleGroups = getGroupCount(triangleCount);
+        uint32_t const packGroups = getGroupCount(packCount);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        auto setTriangleInput = [&](Shader const& shader) {
+            bindStorage(vertices, 0);
+            bindStorage(indices, 1);
+            shader.setInt("uTriangleCount", static_cast<int>(triangleCount));
+            shader.setInt("uStride", static_cast<int>(stride / 4));
+            shader.setInt("uPositionOffset", static_cast<int>(positionOffset / 4));
+            shader.setInt("uShortIndices", indexType == IndexType::UInt16 ? 1 : 0);
+        };
+
+        uint32_t const emptyBound[6] = { ~0U, ~0U, ~0U, 0, 0, 0 };
+        sceneBound->update(const_cast<uint32_t*>(emptyBound), 0, sizeof(emptyBound));
+        centroidBoundShader->bind();
+        setTriangleInput(*centroidBoundShader);
+        bindStorage(*sceneBound, 2);
+        dispatchGroups(triangleGroups);
+
+        mortonShader->bind();
+        setTriangleInput(*mortonShader);
+        bindStorage(*sceneBound, 2);
+        bindStorage(*keys[0], 3);
+        bindStorage(*values[0], 4);
+        dispatchGroups(triangleGroups);
+
+        // 8 passes of 4 bits, the sorted result ends up back in keys[0] and values[0]
+        for (uint32_t shift = 0; shift < 32; shift += 4) {
+            uint32_t const src = (shift / 4) % 2;
+            histogramShader->bind();
+            histogramShader->setInt("uCount", static_cast<int>(triangleCount));
+            histogramShader->setInt("uShift", static_cast<int>(shift));
+            histogramShader->setInt("uGroupCount", static_cast<int>(triangleGroups));
+            bindStorage(*keys[src], 0);
+            bindStorage(*histogram, 2);
+            dispatchGroups(triangleGroups);
+
+            scanShader->bind();
+            scanShader->setInt("uSize", static_cast<int>(16 * triangleGroups));
+            bindStorage(*histogram, 2);
+            dispatchGroups(1);
+
+            scatterShader->bind();
+            scatterShader->setInt("uCount", static_cast<int>(triangleCount));
+            scatterShader->setInt("uShift", static_cast<int>(shift));
+            scatterShader->setInt("uGroupCount", static_cast<int>(triangleGroups));
+            bindStorage(*keys[src], 0);
+            bindStorage(*values[src], 1);
+            bindStorage(*histogram, 2);
+            bindStorage(*keys[1 - src], 3);
+            bindStorage(*values[1 - src], 4);
+            dispatchGroups(triangleGroups);
+        }
+
+        packShader->bind();
+        setTriangleInput(*packShader);
+        bindStorage(*values[0], 2);
+        bindStorage(*bvh.triangles, 3);
+        bindStorage(*packBounds, 4);
+        dispatchGroups(packGroups);
+
+        clearStorage(*parents, ~0U);
+        hierarchyShader->bind();
+        hierarchyShader->setInt("uPackCount", static_cast<int>(packCount));
+        bindStorage(*keys[0], 0);
+        bindStorage(*parents, 1);
+        bindStorage(*internals, 2);
+        dispatchGroups(getGroupCount(packCount - 1));
+
+        emitShader->bind();
+        emitShader->setInt("uPackCount", static_cast<int>(packCount));
+        bindStorage(*parents, 0);
+        bindStorage(*internals, 1);
+        bindStorage(*nodeIndices, 2);
+        bindStorage(*bvh.nodes, 3);
+        dispatchGroups(packGroups);
+
+        clearStorage(*counters, 0);
+        boundShader->bind();
+        boundShader->setInt("uPackCount", static_cast<int>(packCount));
+        bindStorage(*parents, 0);
+        bindStorage(*internals, 1);
+        bindStorage(*nodeIndices, 2);
+        bindStorage(*bvh.nodes, 3);
+        bindStorage(*packBounds, 4);
+        bindStorage(*counters, 5);
+        dispatchGroups(packGroups);
+    }
+
+    void GPUBVHBuilder::build(Mesh const& mesh, GPUBVH& bvh) noexcept {
+        auto const& layout = mesh.vertexBuffer.layout;
+        if (layout.elements.empty() || layout.elements[0].type != DataType::Float3) {
+            SGL_LOG_ERROR("GPUBVHBuilder needs Float3 positions as the first element of the mesh layout");
+            return;
+        }
+        build(mesh.vertexBuffer, layout.stride, layout.elements[0].offset, mesh.elementBuffer, mesh.elementCount / 3, bvh, mesh.indexType);
+    }
+
+}
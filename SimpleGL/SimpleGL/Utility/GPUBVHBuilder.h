@@ -0,0 +1,89 @@
+#pragma once
+
+#include "SimpleGL/Core/Types.h"
+#include "SimpleGL/Utility/GPUBVH.h"
+
+namespace SGL {
+
+    struct Shader;
+    struct Buffer;
+    struct Mesh;
+
+}
+
+namespace SGL::Utility {
+
+    /*
+    *   Linear BVH built by compute shaders from vertex and index buffers already on the GPU, for geometry that changes every frame
+    *       centroid bound, 30 bit Morton codes, 4 bit LSD radix sort, packs of 4 consecutive sorted triangles,
+    *       Karras 2012 hierarchy over the packs, depth first node order and bottom-up bounds with atomics
+    *   The result is a GPUBVH in the same node and pack layout as GPUBVH::create, so SimpleGL/BVH.glsl traverses it as is
+    *   Leaves hold one pack, the tree is never read back and needs a current GL 4.3 context
+    */
+    struct GPUBVHBuilder {
+
+        static constexpr uint32_t GroupSize = 256;
+
+        std::unique_ptr<Shader> centroidBoundShader;
+        std::unique_ptr<Shader> mortonShader;
+        std::unique_ptr<Shader> histogramShader;
+        std::unique_ptr<Shader> scanShader;
+        std::unique_ptr<Shader> scatterShader;
+        std::unique_ptr<Shader> packShader;
+        std::unique_ptr<Shader> hierarchyShader;
+        std::unique_ptr<Shader> emitShader;
+        std::unique_ptr<Shader> boundShader;
+
+        /*
+        *   Scratch buffers, grown to the largest triangle count built so far
+        */
+        std::unique_ptr<StorageBuffer> sceneBound;
+        std::unique_ptr<StorageBuffer> keys[2];
+        std::unique_ptr<StorageBuffer> values[2];
+        std::unique_ptr<StorageBuffer> histogram;
+        std::unique_ptr<StorageBuffer> packBounds;
+        std::unique_ptr<StorageBuffer> parents;
+        std::unique_ptr<StorageBuffer> internals;
+        std::unique_ptr<StorageBuffer> nodeIndices;
+        std::unique_ptr<StorageBuffer> counters;
+        uint32_t capacity = 0;
+        /*
+        *   Largest stackSize already warned about, rebuilds of the same mesh every frame log once
+        */
+        uint32_t warnedStackSize = GPUBVH::DefaultStackSize;
+
+        GPUBVHBuilder() = default;
+        ~GPUBVHBuilder();
+
+        GPUBVHBuilder(GPUBVHBuilder const&) = delete;
+        GPUBVHBuilder(GPUBVHBuilder&& other) = delete;
+
+        GPUBVHBuilder& operator=(GPUBVHBuilder const&) = delete;
+        GPUBVHBuilder& operator=(GPUBVHBuilder&& other) = delete;
+
+        /*
+        *   Compiles the kernels, fails if one of them does not link
+        */
+        static std::unique_ptr<GPUBVHBuilder> create() noexcept;
+
+        /*
+        *   Triangle i is indices[3i, 3i + 3) of indexType indices, positions are 3 floats at positionOffset bytes into each stride byte vertex
+        *   bvh gets new buffers only when its old ones are too small, stackSize is set to a bound of the depth
+        *   A bound past GPUBVH::DefaultStackSize is logged, SGL_BVH_STACK_SIZE has to be defined at least that large before the include
+        */
+        void build(
+            Buffer const& vertices,
+            uint32_t stride,
+            uint32_t positionOffset,
+            Buffer const& indices,
+            uint32_t triangleCount,
+            GPUBVH& bvh,
+            IndexType indexType = IndexType::UInt32) noexcept;
+        /*
+        *   Positions are the first element of the mesh layout and have to be Float3
+        */
+        void build(Mesh const& mesh, GPUBVH& bvh) noexcept;
+
+    };
+
+}
@@ -2,6 +2,11 @@
 
 #include "SimpleGL/Utility/Intersect.h"
 
+#if defined(_M_X64) || defined(__SSE2__)
+#define SGL_UTILITY_INTERSECT_SSE
+#include <immintrin.h>
+#endif
+
 namespace SGL::Utility {
 
     // Moller Trumbore intersection algorithm
@@ -49,6 +54,318 @@ namespace SGL::Utility {
         return false;
     }
 
+    bool intersectSphere(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        glm::vec3 const& center,
+        float radius,
+        float* t) noexcept {
+        float const eps = 1e-6f;
+
+        auto const oc = rayOrigin - center;
+        auto const a = glm::dot(rayDir, rayDir);
+        auto const b = glm::dot(oc, rayDir);
+        auto const c = glm::dot(oc, oc) - radius * radius;
+        auto const h = b * b - a * c;
+        if (h < 0.0f) {
+            return false;
+        }
+        auto const sqrtH = std::sqrt(h);
+        auto tt = (-b - sqrtH) / a;
+        if (tt <= eps) {
+            // origin inside the sphere
+            tt = (-b + sqrtH) / a;
+        }
+        if (t) {
+            if (tt > eps && tt < *t) {
+                *t = tt;
+                return true;
+            }
+        }
+        else {
+            return tt > eps;
+        }
+        return false;
+    }
+
+    /*
+    *   Far root of the ray against a sphere, -INFINITY if the line misses it
+    */
+    static inline float getSphereExit(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, glm::vec3 const& center, float radius) noexcept {
+        auto const oc = rayOrigin - center;
+        auto const a = glm::dot(rayDir, rayDir);
+        auto const b = glm::dot(oc, rayDir);
+        auto const h = b * b - a * (glm::dot(oc, oc) - radius * radius);
+        return h < 0.0f ? -INFINITY : (-b + std::sqrt(h)) / a;
+    }
+
+    // union of the cylinder body and the two end spheres, the first entry is the nearest of the three
+    bool intersectCapsule(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        glm::vec3 const& p0,
+        glm::vec3 const& p1,
+        float radius,
+        float* t) noexcept {
+        float const eps = 1e-6f;
+        float tt = t ? *t : INFINITY;
+        bool hit = false;
+
+        auto const ba = p1 - p0;
+        auto const oa = rayOrigin - p0;
+        auto const baba = glm::dot(ba, ba);
+        auto const bard = glm::dot(ba, rayDir);
+        auto const baoa = glm::dot(ba, oa);
+        auto const a = baba * glm::dot(rayDir, rayDir) - bard * bard;
+        auto const b = baba * glm::dot(rayDir, oa) - baoa * bard;
+        auto const c = baba * glm::dot(oa, oa) - baoa * baoa - radius * radius * baba;
+
+        auto const axis = baba > 0.0f ? glm::clamp(baoa / baba, 0.0f, 1.0f) : 0.0f;
+        auto const toAxis = oa - axis * ba;
+        if (glm::dot(toAxis, toAxis) <= radius * radius) {
+            // origin inside, like intersectSphere it hits where the ray leaves, the capsule is convex so that is the farthest exit of the three
+            float exit = std::max(getSphereExit(rayOrigin, rayDir, p0, radius), getSphereExit(rayOrigin, rayDir, p1, radius));
+            auto const h = b * b - a * c;
+            if (a > eps * baba && h >= 0.0f) {
+                auto const tc = (-b + std::sqrt(h)) / a;
+                auto const y = baoa + tc * bard;
+                if (y > 0.0f && y < baba) exit = std::max(exit, tc);
+            }
+            if (exit <= eps || exit >= tt) return false;
+            if (t) *t = exit;
+            return true;
+        }
+
+        if (a > eps * baba) {
+            auto const h = b * b - a * c;
+            if (h >= 0.0f) {
+                auto const tc = (-b - std::sqrt(h)) / a;
+                auto const y = baoa + tc * bard;
+                if (y > 0.0f && y < baba && tc > eps && tc < tt) {
+                    tt = tc;
+                    hit = true;
+                }
+            }
+        }
+        hit |= intersectSphere(rayOrigin, rayDir, p0, radius, &tt);
+        hit |= intersectSphere(rayOrigin, rayDir, p1, radius, &tt);
+
+        if (hit && t) {
+            *t = tt;
+        }
+        return hit;
+    }
+
+    /*
+    *   Pick the nearest lane of the hit mask, returns -1 if none hit
+    */
+    static inline int selectClosestLane(float const tHit[4], uint32_t mask, float& tt) noexcept {
+        int lane = -1;
+        for (int i = 0; i < 4; ++i) {
+            if ((mask & (1U << i)) && tHit[i] < tt) {
+                tt = tHit[i];
+                lane = i;
+            }
+        }
+        return lane;
+    }
+
+    static inline bool writeTriangle4Hit(
+        BVHTriangle4 const& tris,
+        int lane,
+        float const tHit[4],
+        float const uHit[4],
+        float const vHit[4],
+        float* t,
+        glm::vec2* barycentric,
+        uint32_t* triangle) noexcept {
+        if (lane < 0) return false;
+        if (t) *t = tHit[lane];
+        if (barycentric) *barycentric = glm::vec2(uHit[lane], vHit[lane]);
+        if (triangle) *triangle = tris.index[lane];
+        return true;
+    }
+
+    // Moller Trumbore on 4 lanes, same tolerances as intersectTriangle
+    bool intersectTriangle4(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        BVHTriangle4 const& tris,
+        float* t,
+        glm::vec2* barycentric,
+        uint32_t* triangle,
+        float tMin) noexcept {
+        float const eps = 1e-6f;
+        float tt = t ? *t : INFINITY;
+        alignas(16) float tHit[4];
+        alignas(16) float uHit[4];
+        alignas(16) float vHit[4];
+        uint32_t mask = 0;
+#if defined(SGL_UTILITY_INTERSECT_SSE)
+        __m128 const dx = _mm_set1_ps(rayDir.x);
+        __m128 const dy = _mm_set1_ps(rayDir.y);
+        __m128 const dz = _mm_set1_ps(rayDir.z);
+        __m128 const e1x = _mm_load_ps(tris.e1[0]);
+        __m128 const e1y = _mm_load_ps(tris.e1[1]);
+        __m128 const e1z = _mm_load_ps(tris.e1[2]);
+        __m128 const e2x = _mm_load_ps(tris.e2[0]);
+        __m128 const e2y = _mm_load_ps(tris.e2[1]);
+        __m128 const e2z = _mm_load_ps(tris.e2[2]);
+
+        // h = cross(dir, e2)
+        __m128 const hx = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(e2y, dz));
+        __m128 const hy = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(e2z, dx));
+        __m128 const hz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(e2x, dy));
+        __m128 const a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, hx), _mm_mul_ps(e1y, hy)), _mm_mul_ps(e1z, hz));
+        __m128 const f = _mm_div_ps(_mm_set1_ps(1.0f), a);
+
+        __m128 const sx = _mm_sub_ps(_mm_set1_ps(rayOrigin.x), _mm_load_ps(tris.v0[0]));
+        __m128 const sy = _mm_sub_ps(_mm_set1_ps(rayOrigin.y), _mm_load_ps(tris.v0[1]));
+        __m128 const sz = _mm_sub_ps(_mm_set1_ps(rayOrigin.z), _mm_load_ps(tris.v0[2]));
+        __m128 const u = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, hx), _mm_mul_ps(sy, hy)), _mm_mul_ps(sz, hz)));
+
+        // q = cross(s, e1)
+        __m128 const qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(e1y, sz));
+        __m128 const qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(e1z, sx));
+        __m128 const qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(e1x, sy));
+        __m128 const v = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)));
+        __m128 const tv = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)));
+
+        __m128 const epsV = _mm_set1_ps(eps);
+        __m128 const onePlusEps = _mm_set1_ps(1.0f + eps);
+        __m128 const absA = _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+        __m128 m = _mm_cmpge_ps(absA, epsV);
+        m = _mm_and_ps(m, _mm_cmpge_ps(u, _mm_set1_ps(-eps)));
+        m = _mm_and_ps(m, _mm_cmple_ps(u, onePlusEps));
+        m = _mm_and_ps(m, _mm_cmpge_ps(v, _mm_set1_ps(-eps)));
+        m = _mm_and_ps(m, _mm_cmple_ps(_mm_add_ps(u, v), onePlusEps));
+        m = _mm_and_ps(m, _mm_cmpgt_ps(tv, _mm_set1_ps(std::max(eps, tMin))));
+        m = _mm_and_ps(m, _mm_cmplt_ps(tv, _mm_set1_ps(tt)));
+        mask = static_cast<uint32_t>(_mm_movemask_ps(m));
+        if (mask == 0) return false;
+
+        _mm_store_ps(tHit, tv);
+        _mm_store_ps(uHit, u);
+        _mm_store_ps(vHit, v);
+#else
+        for (uint32_t i = 0; i < 4; ++i) {
+            glm::vec3 const e1(tris.e1[0][i], tris.e1[1][i], tris.e1[2][i]);
+            glm::vec3 const e2(tris.e2[0][i], tris.e2[1][i], tris.e2[2][i]);
+            glm::vec3 const v0(tris.v0[0][i], tris.v0[1][i], tris.v0[2][i]);
+            auto const h = glm::cross(rayDir, e2);
+            auto const a = glm::dot(e1, h);
+            if (a > -eps && a < eps) continue;
+            auto const f = 1.0f / a;
+            auto const s = rayOrigin - v0;
+            auto const u = f * glm::dot(s, h);
+            if (u < -eps || u > 1 + eps) continue;
+            auto const q = glm::cross(s, e1);
+            auto const v = f * glm::dot(rayDir, q);
+            if (v < -eps || u + v > 1 + eps) continue;
+            auto const tv = f * glm::dot(e2, q);
+            if (tv <= std::max(eps, tMin) || tv >= tt) continue;
+            tHit[i] = tv;
+            uHit[i] = u;
+            vHit[i] = v;
+            mask |= 1U << i;
+        }
+        if (mask == 0) return false;
+#endif
+        int lane = selectClosestLane(tHit, mask, tt);
+        return writeTriangle4Hit(tris, lane, tHit, uHit, vHit, t, barycentric, triangle);
+    }
+
+    // Woop et al. 2013, edge functions are evaluated in ray space so shared edges are never missed
+    bool intersectTriangle4(
+        WatertightRay const& ray,
+        BVHTriangle4 const& tris,
+        float* t,
+        glm::vec2* barycentric,
+        uint32_t* triangle,
+        float tMin) noexcept {
+        float tt = t ? *t : INFINITY;
+        alignas(16) float tHit[4];
+        alignas(16) float uHit[4];
+        alignas(16) float vHit[4];
+        uint32_t mask = 0;
+#if defined(SGL_UTILITY_INTERSECT_SSE)
+        __m128 const ox = _mm_set1_ps(ray.origin[ray.kx]);
+        __m128 const oy = _mm_set1_ps(ray.origin[ray.ky]);
+        __m128 const oz = _mm_set1_ps(ray.origin[ray.kz]);
+        __m128 const shearX = _mm_set1_ps(ray.sx);
+        __m128 const shearY = _mm_set1_ps(ray.sy);
+        __m128 const shearZ = _mm_set1_ps(ray.sz);
+
+        auto transform = [&](float const (&p)[3][4], __m128& x, __m128& y, __m128& z) {
+            __m128 const pz = _mm_sub_ps(_mm_load_ps(p[ray.kz]), oz);
+            x = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(p[ray.kx]), ox), _mm_mul_ps(shearX, pz));
+            y = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(p[ray.ky]), oy), _mm_mul_ps(shearY, pz));
+            z = _mm_mul_ps(shearZ, pz);
+        };
+        __m128 ax, ay, az, bx, by, bz, cx, cy, cz;
+        transform(tris.v0, ax, ay, az);
+        transform(tris.v1, bx, by, bz);
+        transform(tris.v2, cx, cy, cz);
+
+        __m128 const u = _mm_sub_ps(_mm_mul_ps(cx, by), _mm_mul_ps(cy, bx));
+        __m128 const v = _mm_sub_ps(_mm_mul_ps(ax, cy), _mm_mul_ps(ay, cx));
+        __m128 const w = _mm_sub_ps(_mm_mul_ps(bx, ay), _mm_mul_ps(by, ax));
+
+        __m128 const zero = _mm_setzero_ps();
+        __m128 const anyNegative = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(u, zero), _mm_cmplt_ps(v, zero)), _mm_cmplt_ps(w, zero));
+        __m128 const anyPositive = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(u, zero), _mm_cmpgt_ps(v, zero)), _mm_cmpgt_ps(w, zero));
+        __m128 const det = _mm_add_ps(_mm_add_ps(u, v), w);
+        __m128 const tScaled = _mm_add_ps(_mm_add_ps(_mm_mul_ps(u, az), _mm_mul_ps(v, bz)), _mm_mul_ps(w, cz));
+
+        // compare t against the interval scaled by det, flipping signs for back facing triangles
+        __m128 const signMask = _mm_and_ps(det, _mm_set1_ps(-0.0f));
+        __m128 const tSigned = _mm_xor_ps(tScaled, signMask);
+        __m128 const absDet = _mm_xor_ps(det, signMask);
+
+        __m128 m = _mm_andnot_ps(_mm_and_ps(anyNegative, anyPositive), _mm_cmpneq_ps(det, zero));
+        m = _mm_and_ps(m, _mm_cmpgt_ps(tSigned, _mm_mul_ps(_mm_set1_ps(tMin), absDet)));
+        m = _mm_and_ps(m, _mm_cmplt_ps(tSigned, _mm_mul_ps(_mm_set1_ps(tt), absDet)));
+        mask = static_cast<uint32_t>(_mm_movemask_ps(m));
+        if (mask == 0) return false;
+
+        __m128 const invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+        _mm_store_ps(tHit, _mm_mul_ps(tScaled, invDet));
+        _mm_store_ps(uHit, _mm_mul_ps(v, invDet));
+        _mm_store_ps(vHit, _mm_mul_ps(w, invDet));
+#else
+        for (uint32_t i = 0; i < 4; ++i) {
+            auto transform = [&](float const (&p)[3][4]) {
+                float const pz = p[ray.kz][i] - ray.origin[ray.kz];
+                return glm::vec3(
+                    p[ray.kx][i] - ray.origin[ray.kx] - ray.sx * pz,
+                    p[ray.ky][i] - ray.origin[ray.ky] - ray.sy * pz,
+                    ray.sz * pz);
+            };
+            glm::vec3 const a = transform(tris.v0);
+            glm::vec3 const b = transform(tris.v1);
+            glm::vec3 const c = transform(tris.v2);
+            float const u = c.x * b.y - c.y * b.x;
+            float const v = a.x * c.y - a.y * c.x;
+            float const w = b.x * a.y - b.y * a.x;
+            if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f)) continue;
+            float const det = u + v + w;
+            if (det == 0.0f) continue;
+            float const tScaled = u * a.z + v * b.z + w * c.z;
+            float const tSigned = det < 0.0f ? -tScaled : tScaled;
+            float const absDet = det < 0.0f ? -det : det;
+            if (tSigned <= tMin * absDet || tSigned >= tt * absDet) continue;
+            float const invDet = 1.0f / det;
+            tHit[i] = tScaled * invDet;
+            uHit[i] = v * invDet;
+            vHit[i] = w * invDet;
+            mask |= 1U << i;
+        }
+        if (mask == 0) return false;
+#endif
+        int lane = selectClosestLane(tHit, mask, tt);
+        return writeTriangle4Hit(tris, lane, tHit, uHit, vHit, t, barycentric, triangle);
+    }
+
     bool intersectAABB(
         glm::vec3 const& rayOrigin,
         glm::vec3 const& rayDir,
@@ -66,7 +383,7 @@ namespace SGL::Utility {
         tmax = std::min(tmax, std::max(ty1, ty2));
         tmin = std::max(tmin, std::min(tz1, tz2));
         tmax = std::min(tmax, std::max(tz1, tz2));
-        if (tmin < tmax && tmax > 0) {
+        if (tmin <= tmax && tmax > 0) {
             if (t) {
                 if (tmin < *t) {
                     *t = tmin;
@@ -80,28 +397,35 @@ namespace SGL::Utility {
         return false;
     }
 
-    bool intersectBVH(
+    /*
+    *   Closest hit traversal of a binary BVH, onHit(primIndex) is called whenever a primitive shortens tt
+    *       with AnyHit the traversal stops at the first primitive hit within tt
+    */
+    template<bool AnyHit, typename HitFunc>
+    static bool traverseBVH(
         glm::vec3 const& rayOrigin,
         glm::vec3 const& rayDir,
         BVH const& bvh,
-        float* t) noexcept {
+        float& tt,
+        HitFunc const& onHit) noexcept {
+        if (bvh.nodes.empty()) return false;
         BVHNode const* node = &bvh.nodes[0];
-        BVHNode const* stack[64] = {};
-        uint32_t stackPtr = 0;
+        BVHTraversalStack<BVHNode const*> stack;
         bool hit = false;
-        float tt = t ? *t : INFINITY;
         while (1) {
             if (node->isLeaf()) {
-                for (size_t i = 0; i < node->primCount; ++i) {
-                    if (bvh.prims[node->firstPrim + i]->intersect(rayOrigin, rayDir, &tt)) {
+                for (uint32_t i = node->firstPrim; i < node->firstPrim + node->primCount; ++i) {
+                    if (bvh.prims[i]->intersect(rayOrigin, rayDir, &tt)) {
+                        if constexpr (AnyHit) return true;
                         hit = true;
+                        onHit(i);
                     }
                 }
-                if (stackPtr == 0) {
+                if (stack.empty()) {
                     break;
                 }
                 else {
-                    node = stack[--stackPtr];
+                    node = stack.pop();
                 }
                 continue;
             }
@@ -121,21 +445,365 @@ namespace SGL::Utility {
             }
 
             if (t1 == INFINITY) {
-                if (stackPtr == 0) {
+                if (stack.empty()) {
                     break;
                 }
                 else {
-                    node = stack[--stackPtr];
+                    node = stack.pop();
                 }
             }
             else {
                 node = child1;
                 if (t2 != INFINITY) {
-                    stack[stackPtr] = child2;
-                    ++stackPtr;
+                    stack.push(child2);
+                }
+            }
+        }
+        return hit;
+    }
+
+    bool intersectBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        BVH const& bvh,
+        float* t,
+        uint32_t* prim) noexcept {
+        float tt = t ? *t : INFINITY;
+        uint32_t hitPrim = 0;
+        bool hit = traverseBVH<false>(rayOrigin, rayDir, bvh, tt, [&](uint32_t primIdx) { hitPrim = primIdx; });
+        if (hit) {
+            if (t) *t = tt;
+            if (prim) *prim = hitPrim;
+        }
+        return hit;
+    }
+
+    bool occludedBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        BVH const& bvh,
+        float tMax) noexcept {
+        return traverseBVH<true>(rayOrigin, rayDir, bvh, tMax, [](uint32_t) {});
+    }
+
+    bool intersectBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        TwoLevelBVH const& bvh,
+        float* t,
+        uint32_t* instance) noexcept {
+        if (!bvh.top) return false;
+        float tt = t ? *t : INFINITY;
+        uint32_t hitInstance = 0;
+        bool hit = traverseBVH<false>(rayOrigin, rayDir, *bvh.top, tt, [&](uint32_t primIdx) {
+            hitInstance = static_cast<uint32_t>(static_cast<BVHInstance const*>(bvh.top->prims[primIdx]) - bvh.instances.data());
+        });
+        if (hit) {
+            if (t) *t = tt;
+            if (instance) *instance = hitInstance;
+        }
+        return hit;
+    }
+
+    bool intersectBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        FlatBVH const& bvh,
+        float* t) noexcept {
+        if (bvh.nodes.empty()) return false;
+        glm::vec3 const invDir = 1.0f / rayDir;
+        FlatBVHNode const* nodes = bvh.nodes.data();
+        BVHTraversalStack<uint32_t> stack;
+        uint32_t nodeIdx = 0;
+        bool hit = false;
+        float tt = t ? *t : INFINITY;
+        while (1) {
+            FlatBVHNode const& node = nodes[nodeIdx];
+            if (node.isLeaf()) {
+                BVHPrimitive* const* prims = bvh.prims.data() + node.offset;
+                for (uint32_t i = 0; i < node.primCount; ++i) {
+                    if (prims[i]->intersect(rayOrigin, rayDir, &tt)) {
+                        hit = true;
+                    }
+                }
+                if (stack.empty()) break;
+                nodeIdx = stack.pop();
+                continue;
+            }
+
+            uint32_t child1 = nodeIdx + 1;
+            uint32_t child2 = node.offset;
+            float t1 = intersectSlab(rayOrigin, invDir, nodes[child1].min, nodes[child1].max, tt);
+            float t2 = intersectSlab(rayOrigin, invDir, nodes[child2].min, nodes[child2].max, tt);
+
+            if (t1 > t2) {
+                std::swap(t1, t2);
+                std::swap(child1, child2);
+            }
+
+            if (t1 == INFINITY) {
+                if (stack.empty()) break;
+                nodeIdx = stack.pop();
+            }
+            else {
+                nodeIdx = child1;
+                if (t2 != INFINITY) {
+                    stack.push(child2);
                 }
             }
         }
+        if (hit && t) {
+            *t = tt;
+        }
+        return hit;
+    }
+
+    // children are not ordered, any hit ends the query
+    bool occludedBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        FlatBVH const& bvh,
+        float tMax) noexcept {
+        if (bvh.nodes.empty()) return false;
+        glm::vec3 const invDir = 1.0f / rayDir;
+        FlatBVHNode const* nodes = bvh.nodes.data();
+        if (intersectSlab(rayOrigin, invDir, nodes[0].min, nodes[0].max, tMax) == INFINITY) return false;
+        BVHTraversalStack<uint32_t> stack;
+        stack.push(0);
+        while (!stack.empty()) {
+            FlatBVHNode const& node = nodes[stack.pop()];
+            if (node.isLeaf()) {
+                BVHPrimitive* const* prims = bvh.prims.data() + node.offset;
+                for (uint32_t i = 0; i < node.primCount; ++i) {
+                    float tt = tMax;
+                    if (prims[i]->intersect(rayOrigin, rayDir, &tt)) return true;
+                }
+                continue;
+            }
+
+            uint32_t const child1 = static_cast<uint32_t>(&node - nodes) + 1;
+            uint32_t const child2 = node.offset;
+            if (intersectSlab(rayOrigin, invDir, nodes[child2].min, nodes[child2].max, tMax) != INFINITY) stack.push(child2);
+            if (intersectSlab(rayOrigin, invDir, nodes[child1].min, nodes[child1].max, tMax) != INFINITY) stack.push(child1);
+        }
+        return false;
+    }
+
+    /*
+    *   Test a ray against the 4 children of a node, near and far planes are picked by the ray direction sign
+    *   so that inverted boxes of empty slots never hit, returns the hit mask and writes the entry distances
+    */
+    static inline uint32_t intersectBVH4Node(
+        BVH4Node const& node,
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& invDir,
+        bool const negative[3],
+        float tFar,
+        float tEntry[4]) noexcept {
+        float const* nearX = negative[0] ? node.maxX : node.minX;
+        float const* farX  = negative[0] ? node.minX : node.maxX;
+        float const* nearY = negative[1] ? node.maxY : node.minY;
+        float const* farY  = negative[1] ? node.minY : node.maxY;
+        float const* nearZ = negative[2] ? node.maxZ : node.minZ;
+        float const* farZ  = negative[2] ? node.minZ : node.maxZ;
+#if defined(SGL_UTILITY_INTERSECT_SSE)
+        __m128 const ox = _mm_set1_ps(rayOrigin.x);
+        __m128 const oy = _mm_set1_ps(rayOrigin.y);
+        __m128 const oz = _mm_set1_ps(rayOrigin.z);
+        __m128 const ix = _mm_set1_ps(invDir.x);
+        __m128 const iy = _mm_set1_ps(invDir.y);
+        __m128 const iz = _mm_set1_ps(invDir.z);
+
+        __m128 const tNearX = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearX), ox), ix);
+        __m128 const tNearY = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearY), oy), iy);
+        __m128 const tNearZ = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearZ), oz), iz);
+        __m128 const tFarX = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(farX), ox), ix);
+        __m128 const tFarY = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(farY), oy), iy);
+        __m128 const tFarZ = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(farZ), oz), iz);
+
+        __m128 const tmin = _mm_max_ps(tNearX, _mm_max_ps(tNearY, tNearZ));
+        __m128 const tmax = _mm_min_ps(tFarX, _mm_min_ps(tFarY, tFarZ));
+
+        __m128 mask = _mm_cmple_ps(tmin, tmax);
+        mask = _mm_and_ps(mask, _mm_cmpgt_ps(tmax, _mm_setzero_ps()));
+        mask = _mm_and_ps(mask, _mm_cmplt_ps(tmin, _mm_set1_ps(tFar)));
+
+        _mm_storeu_ps(tEntry, tmin);
+        return static_cast<uint32_t>(_mm_movemask_ps(mask));
+#else
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < 4; ++i) {
+            float tmin = std::max(std::max(
+                (nearX[i] - rayOrigin.x) * invDir.x,
+                (nearY[i] - rayOrigin.y) * invDir.y),
+                (nearZ[i] - rayOrigin.z) * invDir.z);
+            float tmax = std::min(std::min(
+                (farX[i] - rayOrigin.x) * invDir.x,
+                (farY[i] - rayOrigin.y) * invDir.y),
+                (farZ[i] - rayOrigin.z) * invDir.z);
+            tEntry[i] = tmin;
+            if (tmin <= tmax && tmax > 0 && tmin < tFar) {
+                mask |= 1U << i;
+            }
+        }
+        return mask;
+#endif
+    }
+
+    bool intersectBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        BVH4 const& bvh,
+        float* t) noexcept {
+        if (bvh.nodes.empty()) return false;
+
+        struct Entry {
+            uint32_t index;
+            uint32_t primCount;
+            float t;
+        };
+
+        glm::vec3 const invDir = 1.0f / rayDir;
+        bool const negative[3] = { invDir.x < 0.0f, invDir.y < 0.0f, invDir.z < 0.0f };
+        BVHTraversalStack<Entry> stack;
+        stack.push({ 0, 0, -INFINITY });
+        bool hit = false;
+        float tt = t ? *t : INFINITY;
+
+        while (!stack.empty()) {
+            Entry entry = stack.pop();
+            if (entry.t >= tt) continue;
+
+            if (entry.primCount > 0) {
+                BVHPrimitive* const* prims = bvh.prims.data() + entry.index;
+                for (uint32_t i = 0; i < entry.primCount; ++i) {
+                    if (prims[i]->intersect(rayOrigin, rayDir, &tt)) {
+                        hit = true;
+                    }
+                }
+                continue;
+            }
+
+            BVH4Node const& node = bvh.nodes[entry.index];
+            float tEntry[4];
+            uint32_t mask = intersectBVH4Node(node, rayOrigin, invDir, negative, tt, tEntry);
+
+            // order hit children far to near, so the nearest one is popped first
+            Entry hits[4];
+            uint32_t hitCount = 0;
+            for (uint32_t i = 0; i < 4; ++i) {
+                if (!(mask & (1U << i))) continue;
+                Entry child = { node.child[i], node.primCount[i], tEntry[i] };
+                uint32_t j = hitCount++;
+                while (j > 0 && hits[j - 1].t < child.t) {
+                    hits[j] = hits[j - 1];
+                    --j;
+                }
+                hits[j] = child;
+            }
+            for (uint32_t i = 0; i < hitCount; ++i) {
+                stack.push(hits[i]);
+            }
+        }
+        if (hit && t) {
+            *t = tt;
+        }
+        return hit;
+    }
+
+    /*
+    *   Closest hit traversal of a TriangleBVH, intersectLeaf tests one pack and shortens tt on a hit
+    */
+    template<typename LeafFunc>
+    static bool traverseTriangleBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        TriangleBVH const& bvh,
+        float& tt,
+        LeafFunc const& intersectLeaf) noexcept {
+        if (bvh.nodes.empty()) return false;
+        glm::vec3 const invDir = 1.0f / rayDir;
+        FlatBVHNode const* nodes = bvh.nodes.data();
+        BVHTraversalStack<uint32_t> stack;
+        uint32_t nodeIdx = 0;
+        bool hit = false;
+        while (1) {
+            FlatBVHNode const& node = nodes[nodeIdx];
+            if (node.isLeaf()) {
+                for (uint32_t i = node.offset; i < node.offset + node.primCount; ++i) {
+                    if (intersectLeaf(bvh.packs[i], tt)) {
+                        hit = true;
+                    }
+                }
+                if (stack.empty()) break;
+                nodeIdx = stack.pop();
+                continue;
+            }
+
+            uint32_t child1 = nodeIdx + 1;
+            uint32_t child2 = node.offset;
+            float t1 = intersectSlab(rayOrigin, invDir, nodes[child1].min, nodes[child1].max, tt);
+            float t2 = intersectSlab(rayOrigin, invDir, nodes[child2].min, nodes[child2].max, tt);
+
+            if (t1 > t2) {
+                std::swap(t1, t2);
+                std::swap(child1, child2);
+            }
+
+            if (t1 == INFINITY) {
+                if (stack.empty()) break;
+                nodeIdx = stack.pop();
+            }
+            else {
+                nodeIdx = child1;
+                if (t2 != INFINITY) {
+                    stack.push(child2);
+                }
+            }
+        }
+        return hit;
+    }
+
+    bool intersectBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        TriangleBVH const& bvh,
+        float* t,
+        uint32_t* triangle,
+        glm::vec2* barycentric) noexcept {
+        float tt = t ? *t : INFINITY;
+        uint32_t hitTriangle = 0;
+        glm::vec2 hitBarycentric;
+        bool hit = traverseTriangleBVH(rayOrigin, rayDir, bvh, tt, [&](BVHTriangle4 const& tris, float& tFar) {
+            return intersectTriangle4(rayOrigin, rayDir, tris, &tFar, &hitBarycentric, &hitTriangle);
+        });
+        if (hit) {
+            if (t) *t = tt;
+            if (triangle) *triangle = hitTriangle;
+            if (barycentric) *barycentric = hitBarycentric;
+        }
+        return hit;
+    }
+
+    bool intersectBVHWatertight(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        TriangleBVH const& bvh,
+        float* t,
+        uint32_t* triangle,
+        glm::vec2* barycentric) noexcept {
+        WatertightRay const ray(rayOrigin, rayDir);
+        float tt = t ? *t : INFINITY;
+        uint32_t hitTriangle = 0;
+        glm::vec2 hitBarycentric;
+        bool hit = traverseTriangleBVH(rayOrigin, rayDir, bvh, tt, [&](BVHTriangle4 const& tris, float& tFar) {
+            return intersectTriangle4(ray, tris, &tFar, &hitBarycentric, &hitTriangle);
+        });
+        if (hit) {
+            if (t) *t = tt;
+            if (triangle) *triangle = hitTriangle;
+            if (barycentric) *barycentric = hitBarycentric;
+        }
         return hit;
     }
 
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "SimpleGL/Utility/BVH.h"
+#include "SimpleGL/Utility/WideBVH.h"
+#include "SimpleGL/Utility/TwoLevelBVH.h"
+#include "SimpleGL/Utility/TriangleBVH.h"
 #include "glm/glm.hpp"
 
 namespace SGL::Utility {
@@ -13,16 +16,139 @@ namespace SGL::Utility {
         glm::vec3 const& v2,
         float* t = nullptr) noexcept;
 
+    /*
+    *   Closest hit among the 4 triangles of a pack, t is only shortened on a hit
+    *       barycentric receives the weights of v1 and v2, triangle the index stored in the pack
+    *       hits no farther than tMin are ignored
+    */
+    bool intersectTriangle4(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        BVHTriangle4 const& tris,
+        float* t = nullptr,
+        glm::vec2* barycentric = nullptr,
+        uint32_t* triangle = nullptr,
+        float tMin = 0.0f) noexcept;
+
+    /*
+    *   Watertight variant, rays through shared edges or vertices hit one of the triangles
+    */
+    bool intersectTriangle4(
+        WatertightRay const& ray,
+        BVHTriangle4 const& tris,
+        float* t = nullptr,
+        glm::vec2* barycentric = nullptr,
+        uint32_t* triangle = nullptr,
+        float tMin = 0.0f) noexcept;
+
+    bool intersectSphere(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        glm::vec3 const& center,
+        float radius,
+        float* t = nullptr) noexcept;
+
+    /*
+    *   Segment from p0 to p1 swept by a sphere of radius
+    *   From an origin inside it reports where the ray leaves, as intersectSphere does
+    */
+    bool intersectCapsule(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        glm::vec3 const& p0,
+        glm::vec3 const& p1,
+        float radius,
+        float* t = nullptr) noexcept;
+
     bool intersectAABB(
         glm::vec3 const& rayOrigin,
         glm::vec3 const& rayDir,
         BoundingBoxAABB const& box,
         float* t = nullptr) noexcept;
 
+    /*
+    *   Slab test with precomputed inverse direction, returns the entry distance or INFINITY on miss
+    */
+    inline float intersectSlab(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& invDir,
+        glm::vec3 const& boxMin,
+        glm::vec3 const& boxMax,
+        float tFar) noexcept {
+        glm::vec3 t1 = (boxMin - rayOrigin) * invDir;
+        glm::vec3 t2 = (boxMax - rayOrigin) * invDir;
+        glm::vec3 tNear = glm::min(t1, t2);
+        glm::vec3 tFarV = glm::max(t1, t2);
+        float tmin = std::max(std::max(tNear.x, tNear.y), tNear.z);
+        float tmax = std::min(std::min(tFarV.x, tFarV.y), tFarV.z);
+        if (tmin <= tmax && tmax > 0 && tmin < tFar) {
+            return tmin;
+        }
+        return INFINITY;
+    }
+
+    /*
+    *   if prim is provided, the index in bvh.prims of the closest primitive hit will be stored in it
+    */
     bool intersectBVH(
         glm::vec3 const& rayOrigin,
         glm::vec3 const& rayDir,
         BVH const& bvh,
+        float* t = nullptr,
+        uint32_t* prim = nullptr) noexcept;
+
+    bool intersectBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        FlatBVH const& bvh,
         float* t = nullptr) noexcept;
 
+    /*
+    *   Any hit query for shadow and visibility rays, returns as soon as a primitive is hit closer than tMax
+    */
+    bool occludedBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        BVH const& bvh,
+        float tMax = INFINITY) noexcept;
+
+    bool occludedBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        FlatBVH const& bvh,
+        float tMax = INFINITY) noexcept;
+
+    bool intersectBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        BVH4 const& bvh,
+        float* t = nullptr) noexcept;
+
+    /*
+    *   Rays are moved into the object space of each instance, t stays in world space
+    *       if instance is provided, the index of the closest instance hit will be stored in it
+    */
+    bool intersectBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        TwoLevelBVH const& bvh,
+        float* t = nullptr,
+        uint32_t* instance = nullptr) noexcept;
+
+    bool intersectBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        TriangleBVH const& bvh,
+        float* t = nullptr,
+        uint32_t* triangle = nullptr,
+        glm::vec2* barycentric = nullptr) noexcept;
+
+    bool intersectBVHWatertight(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        TriangleBVH const& bvh,
+        float* t = nullptr,
+        uint32_t* triangle = nullptr,
+        glm::vec2* barycentric = nullptr) noexcept;
+
 }
@@ -0,0 +1,470 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/BVH.h"
+#include "SimpleGL/Core/ThreadPool.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace SGL::Utility {
+
+    static constexpr uint32_t LBVH_PARALLEL_GRAIN = 1 << 14;
+    static constexpr uint32_t LBVH_RADIX_BITS = 8;
+    static constexpr uint32_t LBVH_RADIX_SIZE = 1 << LBVH_RADIX_BITS;
+    /*
+    *   Leaves per treelet, 7 keeps the subset table at 128 entries
+    */
+    static constexpr uint32_t LBVH_TREELET_SIZE = 7;
+
+    static inline uint32_t countLeadingZeros(uint64_t x) noexcept {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, x);
+        return 63 - static_cast<uint32_t>(index);
+#else
+        return static_cast<uint32_t>(__builtin_clzll(x));
+#endif
+    }
+
+    // spread the lower 10 bits so that there are two zero bits between each
+    static inline uint32_t expandBits30(uint32_t v) noexcept {
+        v = (v * 0x00010001U) & 0xFF0000FFU;
+        v = (v * 0x00000101U) & 0x0F00F00FU;
+        v = (v * 0x00000011U) & 0xC30C30C3U;
+        v = (v * 0x00000005U) & 0x49249249U;
+        return v;
+    }
+
+    // spread the lower 21 bits so that there are two zero bits between each
+    static inline uint64_t expandBits63(uint64_t v) noexcept {
+        v &= 0x1FFFFFULL;
+        v = (v | v << 32) & 0x1F00000000FFFFULL;
+        v = (v | v << 16) & 0x1F0000FF0000FFULL;
+        v = (v | v << 8) & 0x100F00F00F00F00FULL;
+        v = (v | v << 4) & 0x10C30C30C30C30C3ULL;
+        v = (v | v << 2) & 0x1249249249249249ULL;
+        return v;
+    }
+
+    struct LBVHContext {
+        ThreadPool* pool;
+
+        void forEach(uint32_t count, uint32_t grain, std::function<void(uint32_t, uint32_t)> const& func) const noexcept {
+            if (pool) {
+                pool->parallelFor(0, count, grain, func);
+                return;
+            }
+            // same chunks as the parallel path, per chunk results are indexed by begin / grain
+            for (uint32_t begin = 0; begin < count; begin += grain) {
+                func(begin, std::min(begin + grain, count));
+            }
+        }
+    };
+
+    /*
+    *   Stable LSD radix sort of the keys carrying the primitive indices along, 8 bits per pass
+    *   Every chunk histograms its keys, then scatters behind the chunks before it in the same bucket
+    */
+    template<typename Key>
+    static void radixSort(LBVHContext const& ctx, std::vector<Key>& keys, std::vector<uint32_t>& values, uint32_t keyBits) noexcept {
+        uint32_t const count = static_cast<uint32_t>(keys.size());
+        uint32_t const chunkCount = (count + LBVH_PARALLEL_GRAIN - 1) / LBVH_PARALLEL_GRAIN;
+        std::vector<Key> keysTemp(count);
+        std::vector<uint32_t> valuesTemp(count);
+        std::vector<std::array<uint32_t, LBVH_RADIX_SIZE>> offsets(chunkCount);
+
+        for (uint32_t shift = 0; shift < keyBits; shift += LBVH_RADIX_BITS) {
+            ctx.forEach(count, LBVH_PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end) {
+                auto& histogram = offsets[begin / LBVH_PARALLEL_GRAIN];
+                histogram.fill(0);
+                for (uint32_t i = begin; i < end; ++i) {
+                    ++histogram[(keys[i] >> shift) & (LBVH_RADIX_SIZE - 1)];
+                }
+            });
+
+            uint32_t sum = 0;
+            bool uniform = false;
+            for (uint32_t b = 0; b < LBVH_RADIX_SIZE; ++b) {
+                uint32_t bucketStart = sum;
+                for (uint32_t c = 0; c < chunkCount; ++c) {
+                    uint32_t n = offsets[c][b];
+                    offsets[c][b] = sum;
+                    sum += n;
+                }
+                if (sum - bucketStart == count) uniform = true;
+            }
+            // every key shares this digit, the pass would not move anything
+            if (uniform) continue;
+
+            ctx.forEach(count, LBVH_PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end) {
+                auto& offset = offsets[begin / LBVH_PARALLEL_GRAIN];
+                for (uint32_t i = begin; i < end; ++i) {
+                    uint32_t dst = offset[(keys[i] >> shift) & (LBVH_RADIX_SIZE - 1)]++;
+                    keysTemp[dst] = keys[i];
+                    valuesTemp[dst] = values[i];
+                }
+            });
+            keys.swap(keysTemp);
+            values.swap(valuesTemp);
+        }
+    }
+
+    /*
+    *   Radix tree over the sorted codes, internal nodes are [0, n - 1), leaf k is node n - 1 + k
+    */
+    struct LBVHTree {
+        uint32_t leafOffset = 0;
+        std::vector<uint32_t> left, right;
+        std::vector<uint32_t> parent;
+        std::vector<BoundingBoxAABB> bound;
+        std::vector<uint32_t> primCount;
+        /*
+        *   SAH cost of the subtree with the cheaper of leaf or split chosen at every node
+        */
+        std::vector<float> cost;
+        std::vector<uint8_t> collapse;
+
+        bool isLeaf(uint32_t node) const noexcept { return node >= leafOffset; }
+    };
+
+    /*
+    *   Karras 2012, every internal node finds its key range and split position independently
+    */
+    template<typename Key>
+    static void buildRadixTree(LBVHContext const& ctx, std::vector<Key> const& keys, LBVHTree& tree) noexcept {
+        int64_t const count = static_cast<int64_t>(keys.size());
+
+        // length of the common prefix, equal keys fall back to their position
+        auto delta = [&](int64_t i, int64_t j) -> int32_t {
+            if (j < 0 || j >= count) return -1;
+            uint64_t x = static_cast<uint64_t>(keys[i] ^ keys[j]);
+            if (x == 0) {
+                return 64 + static_cast<int32_t>(countLeadingZeros(static_cast<uint64_t>(i ^ j)));
+            }
+            return static_cast<int32_t>(countLeadingZeros(x));
+        };
+
+        ctx.forEach(static_cast<uint32_t>(count - 1), LBVH_PARALLEL_GRAIN / 4, [&](uint32_t begin, uint32_t end) {
+            for (int64_t i = begin; i < end; ++i) {
+                int64_t const d = delta(i, i + 1) > delta(i, i - 1) ? 1 : -1;
+                int32_t const deltaMin = delta(i, i - d);
+
+                int64_t lengthMax = 2;
+                while (delta(i, i + lengthMax * d) > deltaMin) {
+                    lengthMax *= 2;
+                }
+                int64_t length = 0;
+                for (int64_t step = lengthMax / 2; step >= 1; step /= 2) {
+                    if (delta(i, i + (length + step) * d) > deltaMin) length += step;
+                }
+                int64_t const j = i + length * d;
+
+                int32_t const deltaNode = delta(i, j);
+                int64_t split = 0;
+                int64_t step = length;
+                do {
+                    step = (step + 1) / 2;
+                    if (delta(i, i + (split + step) * d) > deltaNode) split += step;
+                } while (step > 1);
+                int64_t const gamma = i + split * d + std::min<int64_t>(d, 0);
+
+                uint32_t l = static_cast<uint32_t>(gamma);
+                uint32_t r = static_cast<uint32_t>(gamma + 1);
+                if (std::min(i, j) == gamma) l += tree.leafOffset;
+                if (std::max(i, j) == gamma + 1) r += tree.leafOffset;
+
+                tree.left[i] = l;
+                tree.right[i] = r;
+                tree.parent[l] = static_cast<uint32_t>(i);
+                tree.parent[r] = static_cast<uint32_t>(i);
+            }
+        });
+    }
+
+    static void updateInternalNode(LBVHTree& tree, uint32_t node, BVHBuildOption const& option) noexcept {
+        uint32_t l = tree.left[node];
+        uint32_t r = tree.right[node];
+        BoundingBoxAABB bound = tree.bound[l];
+        bound.append(tree.bound[r]);
+        uint32_t count = tree.primCount[l] + tree.primCount[r];
+        float area = bound.getArea();
+
+        float leafCost = option.intersectCost * count * area;
+        float splitCost = option.traversalCost * area + tree.cost[l] + tree.cost[r];
+        bool collapse = count <= std::max(option.minLeafSize, 1U)
+            || (count <= option.maxLeafSize && leafCost <= splitCost);
+
+        tree.bound[node] = bound;
+        tree.primCount[node] = count;
+        tree.cost[node] = collapse ? leafCost : splitCost;
+        tree.collapse[node] = collapse ? 1 : 0;
+    }
+
+    /*
+    *   Karras and Aila 2013, find the best topology for up to 7 treelet leaves below the root by dynamic programming over leaf subsets
+    *   and rebuild the treelet in place, the interior nodes of the old treelet are reused
+    */
+    static void optimizeTreelet(LBVHTree& tree, uint32_t root, BVHBuildOption const& option) noexcept {
+        uint32_t leaves[LBVH_TREELET_SIZE];
+        uint32_t interiors[LBVH_TREELET_SIZE - 1];
+        uint32_t leafCount = 0;
+        uint32_t interiorCount = 0;
+
+        leaves[leafCount++] = tree.left[root];
+        leaves[leafCount++] = tree.right[root];
+        // open the largest treelet leaf until there are enough of them
+        while (leafCount < LBVH_TREELET_SIZE) {
+            int best = -1;
+            float bestArea = -1.0f;
+            for (uint32_t i = 0; i < leafCount; ++i) {
+                if (tree.isLeaf(leaves[i])) continue;
+                float area = tree.bound[leaves[i]].getArea();
+                if (area > bestArea) {
+                    best = static_cast<int>(i);
+                    bestArea = area;
+                }
+            }
+            if (best < 0) break;
+            uint32_t opened = leaves[best];
+            interiors[interiorCount++] = opened;
+            leaves[best] = tree.left[opened];
+            leaves[leafCount++] = tree.right[opened];
+        }
+        if (leafCount < 3) return;
+
+        uint32_t const subsetCount = 1U << leafCount;
+        float cost[1 << LBVH_TREELET_SIZE];
+        float area[1 << LBVH_TREELET_SIZE];
+        uint32_t primCount[1 << LBVH_TREELET_SIZE];
+        uint8_t partition[1 << LBVH_TREELET_SIZE];
+
+        for (uint32_t s = 1; s < subsetCount; ++s) {
+            BoundingBoxAABB bound;
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < leafCount; ++i) {
+                if (!(s & (1U << i))) continue;
+                bound.append(tree.bound[leaves[i]]);
+                count += tree.primCount[leaves[i]];
+            }
+            area[s] = bound.getArea();
+            primCount[s] = count;
+        }
+        for (uint32_t i = 0; i < leafCount; ++i) {
+            cost[1U << i] = tree.cost[leaves[i]];
+        }
+
+        // subsets are visited in increasing order, so every proper subset is already solved
+        for (uint32_t s = 1; s < subsetCount; ++s) {
+            if ((s & (s - 1)) == 0) continue;
+
+            float bestSplit = std::numeric_limits<float>::max();
+            uint32_t bestPartition = 0;
+            // the lowest leaf always goes left, so each partition is only tried once
+            uint32_t lowest = s & (~s + 1);
+            for (uint32_t p = (s - 1) & s; p > 0; p = (p - 1) & s) {
+                if (!(p & lowest)) continue;
+                float c = cost[p] + cost[s ^ p];
+                if (c < bestSplit) {
+                    bestSplit = c;
+                    bestPartition = p;
+                }
+            }
+
+            float splitCost = option.traversalCost * area[s] + bestSplit;
+            float leafCost = option.intersectCost * primCount[s] * area[s];
+            bool collapse = primCount[s] <= std::max(option.minLeafSize, 1U)
+                || (primCount[s] <= option.maxLeafSize && leafCost <= splitCost);
+            cost[s] = collapse ? leafCost : splitCost;
+            partition[s] = static_cast<uint8_t>(bestPartition);
+        }
+
+        if (cost[subsetCount - 1] >= tree.cost[root]) return;
+
+        // rebuild top-down from the partitions, then refresh the reused nodes bottom-up
+        uint32_t nextInterior = 0;
+        std::function<uint32_t(uint32_t, uint32_t)> emit = [&](uint32_t s, uint32_t node) -> uint32_t {
+            if ((s & (s - 1)) == 0) {
+                uint32_t i = 0;
+                while (!(s & (1U << i))) ++i;
+                return leaves[i];
+            }
+            uint32_t p = partition[s];
+            uint32_t l = emit(p, (p & (p - 1)) ? interiors[nextInterior++] : 0);
+            uint32_t r = emit(s ^ p, ((s ^ p) & ((s ^ p) - 1)) ? interiors[nextInterior++] : 0);
+            tree.left[node] = l;
+            tree.right[node] = r;
+            tree.parent[l] = node;
+            tree.parent[r] = node;
+            updateInternalNode(tree, node, option);
+            return node;
+        };
+        emit(subsetCount - 1, root);
+    }
+
+    /*
+    *   Gather the primitives of a subtree in depth first order, so collapsed subtrees become one contiguous leaf
+    */
+    static void gatherPrims(LBVHTree const& tree, uint32_t node, std::vector<uint32_t> const& sorted, std::vector<uint32_t>& order) noexcept {
+        BVHTraversalStack<uint32_t> stack;
+        stack.push(node);
+        while (!stack.empty()) {
+            uint32_t n = stack.pop();
+            if (tree.isLeaf(n)) {
+                order.push_back(sorted[n - tree.leafOffset]);
+                continue;
+            }
+            stack.push(tree.right[n]);
+            stack.push(tree.left[n]);
+        }
+    }
+
+    void buildLinearBVHNodes(
+        std::vector<BoundingBoxAABB> const& bounds,
+        BVHBuildOption const& option,
+        std::vector<BVHNode>& nodes,
+        std::vector<uint32_t>& order) noexcept {
+        uint32_t const primCount = static_cast<uint32_t>(bounds.size());
+        nodes.clear();
+        order.clear();
+        if (primCount == 0) return;
+
+        LBVHContext ctx{ option.parallel ? &ThreadPool::instance() : nullptr };
+
+        std::vector<glm::vec3> centers(primCount);
+        uint32_t const chunkCount = (primCount + LBVH_PARALLEL_GRAIN - 1) / LBVH_PARALLEL_GRAIN;
+        std::vector<BoundingBoxAABB> chunkBounds(chunkCount);
+        ctx.forEach(primCount, LBVH_PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end) {
+            auto& chunkBound = chunkBounds[begin / LBVH_PARALLEL_GRAIN];
+            for (uint32_t i = begin; i < end; ++i) {
+                centers[i] = bounds[i].getCenter();
+                chunkBound.append(centers[i]);
+            }
+        });
+        BoundingBoxAABB centroidBound;
+        for (auto const& chunkBound : chunkBounds) {
+            centroidBound.append(chunkBound);
+        }
+
+        std::vector<uint32_t> sorted(primCount);
+        LBVHTree tree;
+        tree.leafOffset = primCount - 1;
+
+        // quantise centroids into the grid spanned by the centroid bound
+        auto buildTree = [&](auto keyType, uint32_t axisBits, auto const& encode) {
+            using Key = decltype(keyType);
+            float const cells = static_cast<float>((1U << axisBits) - 1);
+            glm::vec3 const extent = centroidBound.max - centroidBound.min;
+            glm::vec3 scale;
+            for (int a = 0; a < 3; ++a) {
+                scale[a] = extent[a] > 0.0f ? cells / extent[a] : 0.0f;
+            }
+
+            std::vector<Key> keys(primCount);
+            ctx.forEach(primCount, LBVH_PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) {
+                    glm::vec3 q = glm::clamp((centers[i] - centroidBound.min) * scale, 0.0f, cells);
+                    keys[i] = encode(q);
+                    sorted[i] = i;
+                }
+            });
+            radixSort(ctx, keys, sorted, axisBits * 3);
+
+            if (primCount == 1) return;
+            tree.left.resize(primCount - 1);
+            tree.right.resize(primCount - 1);
+            tree.parent.resize(primCount * 2 - 1);
+            buildRadixTree(ctx, keys, tree);
+        };
+
+        if (option.mortonBits > 30) {
+            buildTree(uint64_t(), 21, [](glm::vec3 const& q) {
+                return expandBits63(static_cast<uint64_t>(q.x)) << 2
+                    | expandBits63(static_cast<uint64_t>(q.y)) << 1
+                    | expandBits63(static_cast<uint64_t>(q.z));
+            });
+        }
+        else {
+            buildTree(uint32_t(), 10, [](glm::vec3 const& q) {
+                return expandBits30(static_cast<uint32_t>(q.x)) << 2
+                    | expandBits30(static_cast<uint32_t>(q.y)) << 1
+                    | expandBits30(static_cast<uint32_t>(q.z));
+            });
+        }
+
+        if (primCount == 1) {
+            BVHNode root;
+            root.bound = bounds[0];
+            root.left = root.right = 0;
+            root.firstPrim = 0;
+            root.primCount = 1;
+            nodes.push_back(root);
+            order.push_back(0);
+            return;
+        }
+
+        uint32_t const nodeCount = primCount * 2 - 1;
+        tree.bound.resize(nodeCount);
+        tree.primCount.resize(nodeCount);
+        tree.cost.resize(nodeCount);
+        tree.collapse.resize(nodeCount);
+
+        // bottom-up from every leaf, the second child to arrive at a node finishes it and moves on
+        std::vector<std::atomic<uint32_t>> visits(primCount - 1);
+        ctx.forEach(primCount, LBVH_PARALLEL_GRAIN / 4, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t k = begin; k < end; ++k) {
+                uint32_t leaf = tree.leafOffset + k;
+                tree.bound[leaf] = bounds[sorted[k]];
+                tree.primCount[leaf] = 1;
+                tree.cost[leaf] = option.intersectCost * tree.bound[leaf].getArea();
+                tree.collapse[leaf] = 1;
+
+                uint32_t node = tree.parent[leaf];
+                while (visits[node].fetch_add(1, std::memory_order_acq_rel) == 1) {
+                    updateInternalNode(tree, node, option);
+                    if (option.treeletOptimize && tree.primCount[node] > option.maxLeafSize) {
+                        optimizeTreelet(tree, node, option);
+                    }
+                    if (node == 0) break;
+                    node = tree.parent[node];
+                }
+            }
+        });
+
+        // emit nodes in the same layout as the top-down builder, children as adjacent pairs after their parent
+        nodes.reserve(nodeCount);
+        order.reserve(primCount);
+        std::vector<uint32_t> source = { 0 };
+        nodes.emplace_back();
+
+        BVHTraversalStack<uint32_t> stack;
+        stack.push(0);
+        while (!stack.empty()) {
+            uint32_t idx = stack.pop();
+            uint32_t n = source[idx];
+            BVHNode& node = nodes[idx];
+            node.bound = tree.bound[n];
+            node.left = node.right = 0;
+            node.firstPrim = 0;
+            node.primCount = 0;
+
+            if (tree.collapse[n]) {
+                node.firstPrim = static_cast<uint32_t>(order.size());
+                node.primCount = tree.primCount[n];
+                gatherPrims(tree, n, sorted, order);
+                continue;
+            }
+
+            uint32_t leftIdx = static_cast<uint32_t>(nodes.size());
+            node.left = leftIdx;
+            node.right = leftIdx + 1;
+            nodes.emplace_back();
+            nodes.emplace_back();
+            source.push_back(tree.left[n]);
+            source.push_back(tree.right[n]);
+            stack.push(leftIdx + 1);
+            stack.push(leftIdx);
+        }
+    }
+
+}
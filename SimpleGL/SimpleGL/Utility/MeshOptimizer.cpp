@@ -0,0 +1,299 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/MeshOptimizer.h"
+
+namespace SGL::Utility {
+
+    static constexpr uint32_t NO_VERTEX = ~0U;
+
+    VertexCacheStats analyzeVertexCache(std::vector<uint32_t> const& indices, uint32_t vertexCount, uint32_t cacheSize) noexcept {
+        VertexCacheStats stats;
+        stats.triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        // a vertex stays cached until cacheSize more vertices are transformed after it
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        uint32_t time = cacheSize + 1;
+        for (size_t i = 0; i < stats.triangleCount * 3; ++i) {
+            uint32_t const v = indices[i];
+            if (v >= vertexCount) continue;
+            if (!referenced[v]) {
+                referenced[v] = true;
+                ++stats.vertexCount;
+            }
+            if (time - cacheTime[v] > cacheSize) {
+                cacheTime[v] = time++;
+                ++stats.transformCount;
+            }
+        }
+        return stats;
+    }
+
+    void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>* clusters) noexcept {
+        uint32_t const triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        if (clusters) clusters->clear();
+        if (triangleCount == 0) return;
+
+        // triangles around each vertex, live counts the ones not emitted yet
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (uint32_t i = 0; i < triangleCount * 3; ++i) {
+            ++adjacencyOffsets[indices[i] + 1];
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        std::vector<uint32_t> live(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            live[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+        }
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (uint32_t i = 0; i < triangleCount * 3; ++i) {
+                adjacency[fill[indices[i]]++] = i / 3;
+            }
+        }
+
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEnds;
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> output;
+        output.reserve(triangleCount * 3);
+        uint32_t time = cacheSize + 1;
+        uint32_t cursor = 0;
+
+        // most recent vertex with triangles left, then the input order
+        auto skipDeadEnd = [&]() {
+            while (!deadEnds.empty()) {
+                uint32_t const v = deadEnds.back();
+                deadEnds.pop_back();
+                if (live[v] > 0) return v;
+            }
+            while (cursor < vertexCount) {
+                if (live[cursor] > 0) return cursor++;
+                ++cursor;
+            }
+            return NO_VERTEX;
+        };
+
+        uint32_t fan = skipDeadEnd();
+        bool jumped = true;
+        while (fan != NO_VERTEX) {
+            candidates.clear();
+            for (uint32_t a = adjacencyOffsets[fan]; a < adjacencyOffsets[fan + 1]; ++a) {
+                uint32_t const t = adjacency[a];
+                if (emitted[t]) continue;
+                if (jumped && clusters) clusters->push_back(static_cast<uint32_t>(output.size() / 3));
+                jumped = false;
+                for (uint32_t k = 0; k < 3; ++k) {
+                    uint32_t const v = indices[t * 3 + k];
+                    output.push_back(v);
+                    deadEnds.push_back(v);
+                    candidates.push_back(v);
+                    --live[v];
+                    if (time - cacheTime[v] > cacheSize) {
+                        cacheTime[v] = time++;
+                    }
+                }
+                emitted[t] = true;
+            }
+
+            // the candidate that stays in the cache while its remaining fan is emitted, the oldest of those first
+            uint32_t next = NO_VERTEX;
+            int64_t bestPriority = -1;
+            for (uint32_t v : candidates) {
+                if (live[v] == 0) continue;
+                int64_t priority = 0;
+                if (time - cacheTime[v] + 2 * live[v] <= cacheSize) {
+                    priority = time - cacheTime[v];
+                }
+                if (priority > bestPriority) {
+                    bestPriority = priority;
+                    next = v;
+                }
+            }
+            if (next == NO_VERTEX) {
+                next = skipDeadEnd();
+                jumped = true;
+            }
+            fan = next;
+        }
+
+        indices.swap(output);
+    }
+
+    /*
+    *   Sander et al. 2007, fast linear clustering, a split flushes the cache so it is only made once the cost of the flush is paid back
+    */
+    static std::vector<uint32_t> splitClusters(std::vector<uint32_t> const& indices, uint32_t vertexCount, std::vector<uint32_t> const& clusters, uint32_t cacheSize, float threshold) noexcept {
+        uint32_t const triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+        auto flush = [&]() { time += cacheSize + 1; };
+        auto misses = [&](uint32_t t) {
+            uint32_t count = 0;
+            for (uint32_t k = 0; k < 3; ++k) {
+                uint32_t const v = indices[t * 3 + k];
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                    ++count;
+                }
+            }
+            return count;
+        };
+
+        std::vector<uint32_t> split;
+        for (size_t c = 0; c < clusters.size(); ++c) {
+            uint32_t const begin = clusters[c];
+            uint32_t const end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+            flush();
+            uint32_t clusterMisses = 0;
+            for (uint32_t t = begin; t < end; ++t) {
+                clusterMisses += misses(t);
+            }
+            float const limit = threshold * clusterMisses / std::max(end - begin, 1U);
+
+            split.push_back(begin);
+            flush();
+            uint32_t start = begin;
+            uint32_t runMisses = 0;
+            for (uint32_t t = begin; t < end; ++t) {
+                runMisses += misses(t);
+                if (t + 1 < end && runMisses <= limit * (t + 1 - start)) {
+                    split.push_back(t + 1);
+                    flush();
+                    start = t + 1;
+                    runMisses = 0;
+                }
+            }
+        }
+        return split;
+    }
+
+    void optimizeOverdraw(
+        std::vector<uint32_t>& indices,
+        uint32_t vertexCount,
+        std::vector<uint32_t> const& hardClusters,
+        void const* positions,
+        uint32_t stride,
+        uint32_t cacheSize,
+        float threshold) noexcept {
+        uint32_t const triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        if (hardClusters.empty() || triangleCount < 2) return;
+        std::vector<uint32_t> const clusters = splitClusters(indices, vertexCount, hardClusters, cacheSize, threshold);
+        if (clusters.size() < 2) return;
+
+        auto position = [&](uint32_t v) {
+            glm::vec3 p;
+            std::memcpy(&p, static_cast<uint8_t const*>(positions) + static_cast<size_t>(v) * stride, sizeof(glm::vec3));
+            return p;
+        };
+
+        struct Cluster {
+            uint32_t begin;
+            uint32_t end;
+            glm::vec3 normal;
+            glm::vec3 centroid;
+            float area;
+            float sortKey;
+        };
+        std::vector<Cluster> sorted(clusters.size());
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        for (size_t c = 0; c < clusters.size(); ++c) {
+            Cluster& cluster = sorted[c];
+            cluster.begin = clusters[c];
+            cluster.end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+            cluster.normal = glm::vec3(0.0f);
+            cluster.centroid = glm::vec3(0.0f);
+            cluster.area = 0.0f;
+            glm::vec3 average(0.0f);
+            for (uint32_t t = cluster.begin; t < cluster.end; ++t) {
+                glm::vec3 const v0 = position(indices[t * 3 + 0]);
+                glm::vec3 const v1 = position(indices[t * 3 + 1]);
+                glm::vec3 const v2 = position(indices[t * 3 + 2]);
+                glm::vec3 const n = glm::cross(v1 - v0, v2 - v0);
+                float const area = glm::length(n);
+                glm::vec3 const center = (v0 + v1 + v2) / 3.0f;
+                cluster.normal += n;
+                cluster.centroid += center * area;
+                cluster.area += area;
+                average += center;
+            }
+            // degenerate clusters fall back to the plain average of their triangle centers
+            cluster.centroid = cluster.area > 0.0f ? cluster.centroid / cluster.area : average / static_cast<float>(std::max(cluster.end - cluster.begin, 1U));
+            meshCentroid += cluster.centroid * cluster.area;
+            meshArea += cluster.area;
+        }
+        if (meshArea <= 0.0f) return;
+        meshCentroid /= meshArea;
+
+        for (auto& cluster : sorted) {
+            float const length = glm::length(cluster.normal);
+            cluster.sortKey = length > 0.0f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / length) : 0.0f;
+        }
+        std::stable_sort(sorted.begin(), sorted.end(), [](Cluster const& a, Cluster const& b) { return a.sortKey > b.sortKey; });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+        for (auto const& cluster : sorted) {
+            output.insert(output.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+        }
+        // a trailing partial triangle is kept as it was
+        output.insert(output.end(), indices.begin() + triangleCount * 3, indices.end());
+        indices.swap(output);
+    }
+
+    void optimizeVertexFetch(void* vertices, uint32_t vertexCount, uint32_t stride, std::vector<uint32_t>& indices) noexcept {
+        std::vector<uint32_t> remap(vertexCount, NO_VERTEX);
+        uint32_t next = 0;
+        for (uint32_t v : indices) {
+            if (remap[v] == NO_VERTEX) remap[v] = next++;
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            if (remap[v] == NO_VERTEX) remap[v] = next++;
+        }
+
+        auto bytes = static_cast<uint8_t*>(vertices);
+        std::vector<uint8_t> reordered(static_cast<size_t>(vertexCount) * stride);
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            std::memcpy(reordered.data() + static_cast<size_t>(remap[v]) * stride, bytes + static_cast<size_t>(v) * stride, stride);
+        }
+        std::memcpy(bytes, reordered.data(), reordered.size());
+        for (auto& v : indices) {
+            v = remap[v];
+        }
+    }
+
+    MeshOptimizeStats optimizeMesh(
+        void* vertices,
+        uint32_t vertexCount,
+        uint32_t stride,
+        uint32_t positionOffset,
+        std::vector<uint32_t>& indices,
+        MeshOptimizeOption const& option) noexcept {
+        MeshOptimizeStats stats;
+        stats.before = analyzeVertexCache(indices, vertexCount, option.cacheSize);
+        stats.after = stats.before;
+        if (indices.size() < 3 || indices.size() % 3 != 0) return stats;
+        for (uint32_t v : indices) {
+            if (v >= vertexCount) {
+                SGL_LOG_WARN("Index {0} out of {1} vertices, mesh not optimized", v, vertexCount);
+                return stats;
+            }
+        }
+
+        std::vector<uint32_t> clusters;
+        optimizeVertexCache(indices, vertexCount, option.cacheSize, option.optimizeOverdraw ? &clusters : nullptr);
+        if (option.optimizeOverdraw) {
+            optimizeOverdraw(indices, vertexCount, clusters, static_cast<uint8_t const*>(vertices) + positionOffset, stride, option.cacheSize, option.overdrawThreshold);
+        }
+        if (option.optimizeVertexFetch) {
+            optimizeVertexFetch(vertices, vertexCount, stride, indices);
+        }
+
+        stats.after = analyzeVertexCache(indices, vertexCount, option.cacheSize);
+        return stats;
+    }
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+namespace SGL::Utility {
+
+    /*
+    *   Vertex shader invocations of a triangle list under a FIFO post-transform cache
+    *       ACMR, average cache miss ratio, is transforms per triangle, 0.5 is the ideal of a large regular grid
+    *       ATVR, average transform to vertex ratio, is transforms per referenced vertex, 1 is ideal
+    */
+    struct VertexCacheStats {
+
+        uint32_t triangleCount = 0;
+        uint32_t vertexCount = 0;
+        uint32_t transformCount = 0;
+
+        float getACMR() const noexcept { return triangleCount ? static_cast<float>(transformCount) / triangleCount : 0.0f; }
+        float getATVR() const noexcept { return vertexCount ? static_cast<float>(transformCount) / vertexCount : 0.0f; }
+
+        void append(VertexCacheStats const& other) noexcept {
+            triangleCount += other.triangleCount;
+            vertexCount += other.vertexCount;
+            transformCount += other.transformCount;
+        }
+
+    };
+
+    struct MeshOptimizeStats {
+
+        VertexCacheStats before;
+        VertexCacheStats after;
+
+        void append(MeshOptimizeStats const& other) noexcept {
+            before.append(other.before);
+            after.append(other.after);
+        }
+
+    };
+
+    struct MeshOptimizeOption {
+        /*
+        *   Cache entries assumed by the triangle order and used for the stats, 16 to 32 on current GPUs
+        */
+        uint32_t cacheSize = 16;
+        /*
+        *   Sort clusters of the cache order so outward facing ones are drawn first and early depth testing rejects more of the rest,
+        *   clusters are cut small enough for that while their ACMR stays within about overdrawThreshold times that of the cache order
+        */
+        bool optimizeOverdraw = true;
+        float overdrawThreshold = 1.05f;
+        /*
+        *   Renumber the vertices in order of first use, so vertex fetch walks the buffer forward
+        */
+        bool optimizeVertexFetch = true;
+    };
+
+    /*
+    *   FIFO cache simulation of a triangle list
+    */
+    VertexCacheStats analyzeVertexCache(std::vector<uint32_t> const& indices, uint32_t vertexCount, uint32_t cacheSize = 16) noexcept;
+
+    /*
+    *   Tipsify, Sander et al. 2007, reorders the triangles for the post-transform cache in linear time
+    *   clusters receives the first triangle of each run started from a dead end, the points where reordering is free for the cache
+    *   Indices have to be below vertexCount
+    */
+    void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16, std::vector<uint32_t>* clusters = nullptr) noexcept;
+
+    /*
+    *   Sorts clusters by how far their area weighted normal points away from the mesh centroid, so the outside of the mesh is drawn first
+    *   The clusters of optimizeVertexCache are split further where the ACMR since the last split has come back down to
+    *   threshold times that of the whole cluster, so sorting costs at most that factor of cache efficiency
+    *   The position of vertex i is 3 floats at positions + i * stride bytes, front faces are counter clockwise
+    */
+    void optimizeOverdraw(
+        std::vector<uint32_t>& indices,
+        uint32_t vertexCount,
+        std::vector<uint32_t> const& clusters,
+        void const* positions,
+        uint32_t stride,
+        uint32_t cacheSize = 16,
+        float threshold = 1.05f) noexcept;
+
+    /*
+    *   Moves the vertices into the order of their first use in indices and remaps indices, unreferenced vertices move to the end
+    */
+    void optimizeVertexFetch(void* vertices, uint32_t vertexCount, uint32_t stride, std::vector<uint32_t>& indices) noexcept;
+
+    /*
+    *   All of the above in order for a triangle list of interleaved vertices, positions are 3 floats at positionOffset bytes
+    */
+    MeshOptimizeStats optimizeMesh(
+        void* vertices,
+        uint32_t vertexCount,
+        uint32_t stride,
+        uint32_t positionOffset,
+        std::vector<uint32_t>& indices,
+        MeshOptimizeOption const& option = MeshOptimizeOption()) noexcept;
+
+}
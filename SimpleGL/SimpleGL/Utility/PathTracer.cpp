@@ -0,0 +1,142 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/PathTracer.h"
+#include "SimpleGL/Utility/RayQuery.h"
+#include "SimpleGL/Utility/Sampling.h"
+#include "SimpleGL/Core/Model.h"
+#include "SimpleGL/Core/ThreadPool.h"
+#include "SimpleGL/Core/Timer.h"
+#include "tinyexr/tinyexr.h"
+
+namespace SGL::Utility {
+
+    static glm::vec3 traceRadiance(TriangleBVH const& scene, PathTracerOption const& option, Ray ray, HashSampler& sampler) noexcept {
+        bool const hasSun = option.sunRadiance != glm::vec3(0.0f);
+        glm::vec3 radiance(0.0f);
+        glm::vec3 throughput(1.0f);
+        for (uint32_t depth = 0; depth < option.maxDepth; ++depth) {
+            RayHit hit;
+            if (!intersect(scene, ray, hit)) {
+                radiance += throughput * option.environment;
+                break;
+            }
+
+            glm::vec3 const normal = glm::dot(hit.normal, ray.dir) > 0.0f ? -hit.normal : hit.normal;
+            glm::vec3 const origin = offsetRayOrigin(ray.origin + ray.dir * hit.t, normal);
+            throughput *= option.albedo;
+
+            if (hasSun) {
+                float const cosSun = glm::dot(normal, option.sunDirection);
+                if (cosSun > 0.0f && !occluded(scene, { origin, option.sunDirection })) {
+                    radiance += throughput * option.sunRadiance * (cosSun / glm::pi<float>());
+                }
+            }
+
+            // cosine sampling cancels the cosine and pi of the Lambertian BRDF, leaving the albedo
+            float const u1 = sampler.next();
+            float const u2 = sampler.next();
+            ray = { origin, sampleCosineHemisphere(normal, u1, u2) };
+        }
+        return radiance;
+    }
+
+    std::unique_ptr<PathTracer> PathTracer::build(std::vector<glm::vec3> const& vertices, PathTracerOption const& option) noexcept {
+        auto tracer = std::make_unique<PathTracer>();
+        tracer->option = option;
+        tracer->scene = TriangleBVH::build(vertices);
+        tracer->reset();
+        return tracer;
+    }
+
+    std::unique_ptr<PathTracer> PathTracer::build(Model const& model, PathTracerOption const& option) noexcept {
+        std::vector<glm::vec3> vertices;
+        model.getRetainedTriangles(vertices, model.transform);
+        if (vertices.empty()) {
+            SGL_LOG_WARN("Path tracer found no triangles, load the model with retainGeometry");
+        }
+        return build(vertices, option);
+    }
+
+    void PathTracer::reset() noexcept {
+        accumulation.assign(static_cast<size_t>(option.width) * option.height, glm::vec3(0.0f));
+        stats = PathTracerStats();
+    }
+
+    void PathTracer::render(PerspCamera const& camera, uint32_t samplesPerPixel) noexcept {
+        if (option.width == 0 || option.height == 0) return;
+        if (accumulation.size() != static_cast<size_t>(option.width) * option.height) {
+            reset();
+        }
+
+        Timer timer;
+        glm::mat3 const basis = camera.getBasis();
+        float const tanHalfFov = std::tan(camera.fov * 0.5f);
+        float const aspect = static_cast<float>(option.width) / static_cast<float>(option.height);
+        uint32_t const tileSize = std::max(option.tileSize, 1U);
+        uint32_t const tilesX = (option.width + tileSize - 1) / tileSize;
+        uint32_t const tilesY = (option.height + tileSize - 1) / tileSize;
+        uint32_t const firstSample = stats.samplesPerPixel;
+        uint32_t const seedHash = hashPCG(option.seed);
+
+        auto renderTiles = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t tile = begin; tile < end; ++tile) {
+                uint32_t const x0 = (tile % tilesX) * tileSize;
+                uint32_t const y0 = (tile / tilesX) * tileSize;
+                uint32_t const x1 = std::min(x0 + tileSize, option.width);
+                uint32_t const y1 = std::min(y0 + tileSize, option.height);
+                for (uint32_t y = y0; y < y1; ++y) {
+                    for (uint32_t x = x0; x < x1; ++x) {
+                        uint32_t const pixel = y * option.width + x;
+                        glm::vec3 sum(0.0f);
+                        for (uint32_t s = 0; s < samplesPerPixel; ++s) {
+                            HashSampler sampler{ hashPCG(pixel + hashPCG(firstSample + s + seedHash)) };
+                            float const px = (x + sampler.next()) / option.width * 2.0f - 1.0f;
+                            float const py = 1.0f - (y + sampler.next()) / option.height * 2.0f;
+                            glm::vec3 const dir = glm::normalize(basis * glm::vec3(px * aspect * tanHalfFov, py * tanHalfFov, 1.0f));
+                            sum += traceRadiance(*scene, option, { camera.eye, dir }, sampler);
+                        }
+                        accumulation[pixel] += sum;
+                    }
+                }
+            }
+        };
+
+        if (option.parallel) {
+            ThreadPool::instance().parallelFor(0, tilesX * tilesY, 1, renderTiles);
+            stats.threadCount = ThreadPool::instance().getThreadCount() + 1;
+        }
+        else {
+            renderTiles(0, tilesX * tilesY);
+            stats.threadCount = 1;
+        }
+
+        timer.update();
+        stats.samplesPerPixel += samplesPerPixel;
+        stats.renderTime = timer.getDeltaTime();
+        double const samples = static_cast<double>(option.width) * option.height * samplesPerPixel;
+        stats.samplesPerSecondPerCore = samples / std::max(stats.renderTime, 1e-9) / stats.threadCount;
+    }
+
+    void PathTracer::resolve(std::vector<float>& rgb) const noexcept {
+        rgb.resize(accumulation.size() * 3);
+        float const scale = stats.samplesPerPixel > 0 ? 1.0f / stats.samplesPerPixel : 0.0f;
+        for (size_t i = 0; i < accumulation.size(); ++i) {
+            rgb[i * 3 + 0] = accumulation[i].r * scale;
+            rgb[i * 3 + 1] = accumulation[i].g * scale;
+            rgb[i * 3 + 2] = accumulation[i].b * scale;
+        }
+    }
+
+    bool PathTracer::saveEXR(std::string const& path) const noexcept {
+        std::vector<float> rgb;
+        resolve(rgb);
+        char const* err = nullptr;
+        if (SaveEXR(rgb.data(), static_cast<int>(option.width), static_cast<int>(option.height), 3, 0, path.c_str(), &err) != TINYEXR_SUCCESS) {
+            SGL_LOG_ERROR("Failed to save EXR {0}: {1}", path, err ? err : "unknown error");
+            if (err) FreeEXRErrorMessage(err);
+            return false;
+        }
+        return true;
+    }
+
+}
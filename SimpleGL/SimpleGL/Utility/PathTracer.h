@@ -0,0 +1,105 @@
+#pragma once
+
+#include "SimpleGL/Utility/TriangleBVH.h"
+#include "SimpleGL/Utility/Camera.h"
+
+namespace SGL {
+
+    struct Model;
+
+}
+
+namespace SGL::Utility {
+
+    struct PathTracerOption {
+        uint32_t width = 512;
+        uint32_t height = 512;
+        /*
+        *   Tiles are the unit of work scheduled on ThreadPool::instance()
+        */
+        uint32_t tileSize = 32;
+        uint32_t maxDepth = 4;
+        /*
+        *   Diffuse reflectance of every surface, materials are not read from the model
+        */
+        glm::vec3 albedo = glm::vec3(0.8f);
+        /*
+        *   Radiance of rays escaping the scene
+        */
+        glm::vec3 environment = glm::vec3(1.0f);
+        /*
+        *   Directional light sampled with a shadow ray at every bounce, off while sunRadiance is zero
+        */
+        glm::vec3 sunDirection = glm::normalize(glm::vec3(1.0f, 2.0f, 1.0f));
+        glm::vec3 sunRadiance = glm::vec3(0.0f);
+        /*
+        *   Random numbers depend on the pixel, the sample index and the seed only, so images are reproducible
+        */
+        uint32_t seed = 0;
+        bool parallel = true;
+    };
+
+    struct PathTracerStats {
+        uint32_t samplesPerPixel = 0;
+        uint32_t threadCount = 1;
+        /*
+        *   Of the last render call
+        */
+        double renderTime = 0.0;
+        double samplesPerSecondPerCore = 0.0;
+    };
+
+    /*
+    *   CPU reference renderer, Lambertian surfaces lit by a constant environment and an optional sun
+    *   It uses no GL, headless callers build it from triangles directly
+    */
+    struct PathTracer {
+
+        PathTracerOption option;
+        std::unique_ptr<TriangleBVH> scene;
+        /*
+        *   Radiance summed over all samples, row major from the top left pixel
+        */
+        std::vector<glm::vec3> accumulation;
+
+        PathTracerStats stats;
+
+        PathTracer() = default;
+        ~PathTracer() = default;
+
+        PathTracer(PathTracer const&) = delete;
+        PathTracer(PathTracer&& other) = delete;
+
+        PathTracer& operator=(PathTracer const&) = delete;
+        PathTracer& operator=(PathTracer&& other) = delete;
+
+        /*
+        *   Triangles are given as world space vertex triples
+        */
+        static std::unique_ptr<PathTracer> build(std::vector<glm::vec3> const& vertices, PathTracerOption const& option = PathTracerOption()) noexcept;
+
+        /*
+        *   Uses the retained geometry of the model meshes, see ModelLoadOption::retainGeometry
+        */
+        static std::unique_ptr<PathTracer> build(Model const& model, PathTracerOption const& option = PathTracerOption()) noexcept;
+
+        /*
+        *   Add samplesPerPixel samples to every pixel, call it repeatedly to refine the image progressively
+        */
+        void render(PerspCamera const& camera, uint32_t samplesPerPixel = 1) noexcept;
+
+        /*
+        *   Drop the accumulated samples, needed after the camera or the options change
+        */
+        void reset() noexcept;
+
+        /*
+        *   Average of the accumulated samples as RGB floats
+        */
+        void resolve(std::vector<float>& rgb) const noexcept;
+
+        bool saveEXR(std::string const& path) const noexcept;
+
+    };
+
+}
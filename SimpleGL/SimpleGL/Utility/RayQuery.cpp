@@ -0,0 +1,376 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/RayQuery.h"
+#include "SimpleGL/Utility/Intersect.h"
+#include "SimpleGL/Core/ThreadPool.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SGL_UTILITY_RAY_QUERY_SSE
+#include <immintrin.h>
+#endif
+
+namespace SGL::Utility {
+
+    /*
+    *   Slab test of the masked rays against one box, returns the hit mask and the nearest entry distance among them
+    */
+    template<uint32_t N>
+    static inline uint32_t intersectPacketBox(RayPacket<N> const& packet, FlatBVHNode const& node, uint32_t mask, float& tNearest) noexcept {
+        uint32_t hitMask = 0;
+#if defined(SGL_UTILITY_RAY_QUERY_SSE)
+        __m128 const minX = _mm_set1_ps(node.min.x);
+        __m128 const minY = _mm_set1_ps(node.min.y);
+        __m128 const minZ = _mm_set1_ps(node.min.z);
+        __m128 const maxX = _mm_set1_ps(node.max.x);
+        __m128 const maxY = _mm_set1_ps(node.max.y);
+        __m128 const maxZ = _mm_set1_ps(node.max.z);
+        __m128 const inf = _mm_set1_ps(INFINITY);
+        __m128 nearest = inf;
+
+        for (uint32_t g = 0; g < N / 4; ++g) {
+            uint32_t const groupMask = (mask >> (g * 4)) & 0xF;
+            if (groupMask == 0) continue;
+
+            uint32_t const i = g * 4;
+            __m128 const ox = _mm_load_ps(packet.originX + i);
+            __m128 const oy = _mm_load_ps(packet.originY + i);
+            __m128 const oz = _mm_load_ps(packet.originZ + i);
+            __m128 const ix = _mm_load_ps(packet.invDirX + i);
+            __m128 const iy = _mm_load_ps(packet.invDirY + i);
+            __m128 const iz = _mm_load_ps(packet.invDirZ + i);
+
+            __m128 const tx1 = _mm_mul_ps(_mm_sub_ps(minX, ox), ix);
+            __m128 const tx2 = _mm_mul_ps(_mm_sub_ps(maxX, ox), ix);
+            __m128 const ty1 = _mm_mul_ps(_mm_sub_ps(minY, oy), iy);
+            __m128 const ty2 = _mm_mul_ps(_mm_sub_ps(maxY, oy), iy);
+            __m128 const tz1 = _mm_mul_ps(_mm_sub_ps(minZ, oz), iz);
+            __m128 const tz2 = _mm_mul_ps(_mm_sub_ps(maxZ, oz), iz);
+
+            __m128 const tmin = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)), _mm_min_ps(tz1, tz2));
+            __m128 const tmax = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)), _mm_max_ps(tz1, tz2));
+
+            // rays outside the mask must not steer the nearest distance either
+            __m128 const laneMask = _mm_castsi128_ps(_mm_cmpgt_epi32(
+                _mm_and_si128(_mm_set1_epi32(static_cast<int>(groupMask)), _mm_setr_epi32(1, 2, 4, 8)), _mm_setzero_si128()));
+            __m128 m = _mm_and_ps(laneMask, _mm_cmple_ps(tmin, tmax));
+            m = _mm_and_ps(m, _mm_cmpgt_ps(tmax, _mm_setzero_ps()));
+            m = _mm_and_ps(m, _mm_cmplt_ps(tmin, _mm_load_ps(packet.t + i)));
+
+            uint32_t const bits = static_cast<uint32_t>(_mm_movemask_ps(m));
+            if (bits == 0) continue;
+            hitMask |= bits << i;
+            nearest = _mm_min_ps(nearest, _mm_or_ps(_mm_and_ps(m, tmin), _mm_andnot_ps(m, inf)));
+        }
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, nearest);
+        tNearest = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+#else
+        tNearest = INFINITY;
+        for (uint32_t i = 0; i < N; ++i) {
+            if (!(mask & (1U << i))) continue;
+            glm::vec3 const origin(packet.originX[i], packet.originY[i], packet.originZ[i]);
+            glm::vec3 const invDir(packet.invDirX[i], packet.invDirY[i], packet.invDirZ[i]);
+            float tEntry = intersectSlab(origin, invDir, node.min, node.max, packet.t[i]);
+            if (tEntry == INFINITY) continue;
+            hitMask |= 1U << i;
+            tNearest = std::min(tNearest, tEntry);
+        }
+#endif
+        return hitMask;
+    }
+
+    /*
+    *   Single ray traversal of the subtree under root, onHit(pack, triangle, barycentric) is called whenever a triangle shortens tt
+    *       with AnyHit the traversal stops at the first triangle hit
+    */
+    template<bool AnyHit, typename HitFunc>
+    static bool traverseSubtree(
+        TriangleBVH const& bvh,
+        glm::vec3 const& origin,
+        glm::vec3 const& dir,
+        glm::vec3 const& invDir,
+        float tMin,
+        float& tt,
+        uint32_t root,
+        HitFunc const& onHit) noexcept {
+        FlatBVHNode const* nodes = bvh.nodes.data();
+        BVHTraversalStack<uint32_t> stack;
+        uint32_t nodeIdx = root;
+        bool hit = false;
+        while (1) {
+            FlatBVHNode const& node = nodes[nodeIdx];
+            if (node.isLeaf()) {
+                for (uint32_t p = node.offset; p < node.offset + node.primCount; ++p) {
+                    uint32_t triangle;
+                    glm::vec2 barycentric;
+                    if (intersectTriangle4(origin, dir, bvh.packs[p], &tt, &barycentric, &triangle, tMin)) {
+                        if constexpr (AnyHit) return true;
+                        hit = true;
+                        onHit(bvh.packs[p], triangle, barycentric);
+                    }
+                }
+                if (stack.empty()) break;
+                nodeIdx = stack.pop();
+                continue;
+            }
+
+            uint32_t child1 = nodeIdx + 1;
+            uint32_t child2 = node.offset;
+            float t1 = intersectSlab(origin, invDir, nodes[child1].min, nodes[child1].max, tt);
+            float t2 = intersectSlab(origin, invDir, nodes[child2].min, nodes[child2].max, tt);
+            if (t1 > t2) {
+                std::swap(t1, t2);
+                std::swap(child1, child2);
+            }
+            if (t1 == INFINITY) {
+                if (stack.empty()) break;
+                nodeIdx = stack.pop();
+            }
+            else {
+                nodeIdx = child1;
+                if (t2 != INFINITY) stack.push(child2);
+            }
+        }
+        return hit;
+    }
+
+    bool intersect(TriangleBVH const& bvh, Ray const& ray, RayHit& hit) noexcept {
+        if (bvh.nodes.empty()) return false;
+        float tt = ray.tMax;
+        BVHTriangle4 const* hitPack = nullptr;
+        uint32_t hitTriangle = 0;
+        glm::vec2 hitBarycentric;
+        bool const isHit = traverseSubtree<false>(bvh, ray.origin, ray.dir, 1.0f / ray.dir, ray.tMin, tt, 0,
+            [&](BVHTriangle4 const& pack, uint32_t triangle, glm::vec2 const& barycentric) {
+                hitPack = &pack;
+                hitTriangle = triangle;
+                hitBarycentric = barycentric;
+            });
+        if (!isHit) return false;
+        hit.t = tt;
+        hit.barycentric = hitBarycentric;
+        hit.normal = hitPack->getNormal(hitTriangle);
+        hit.primitive = hitTriangle;
+        return true;
+    }
+
+    bool occluded(TriangleBVH const& bvh, Ray const& ray) noexcept {
+        if (bvh.nodes.empty()) return false;
+        float tt = ray.tMax;
+        return traverseSubtree<true>(bvh, ray.origin, ray.dir, 1.0f / ray.dir, ray.tMin, tt, 0,
+            [](BVHTriangle4 const&, uint32_t, glm::vec2 const&) {});
+    }
+
+    // primitives only take a far distance, so the ray starts at tMin instead
+    bool intersect(BVH const& bvh, Ray const& ray, RayHit& hit) noexcept {
+        float tt = ray.tMax - ray.tMin;
+        uint32_t prim = 0;
+        if (!intersectBVH(ray.origin + ray.dir * ray.tMin, ray.dir, bvh, &tt, &prim)) return false;
+        hit.t = tt + ray.tMin;
+        hit.barycentric = glm::vec2(0.0f);
+        hit.normal = glm::vec3(0.0f);
+        hit.primitive = prim;
+        return true;
+    }
+
+    bool occluded(BVH const& bvh, Ray const& ray) noexcept {
+        return occludedBVH(ray.origin + ray.dir * ray.tMin, ray.dir, bvh, ray.tMax - ray.tMin);
+    }
+
+    template<uint32_t N>
+    static inline void setPacketHit(RayPacket<N>& packet, uint32_t i, BVHTriangle4 const& pack, uint32_t triangle, glm::vec2 const& barycentric) noexcept {
+        glm::vec3 const normal = pack.getNormal(triangle);
+        packet.u[i] = barycentric.x;
+        packet.v[i] = barycentric.y;
+        packet.normalX[i] = normal.x;
+        packet.normalY[i] = normal.y;
+        packet.normalZ[i] = normal.z;
+        packet.triangle[i] = triangle;
+    }
+
+    template<uint32_t N>
+    uint32_t intersectPacket(TriangleBVH const& bvh, RayPacket<N>& packet, uint32_t activeMask) noexcept {
+        if (bvh.nodes.empty()) return 0;
+        if constexpr (N < 32) activeMask &= (1U << N) - 1;
+
+        struct Entry {
+            uint32_t node;
+            uint32_t mask;
+        };
+
+        FlatBVHNode const* nodes = bvh.nodes.data();
+        float tEntry;
+        uint32_t rootMask = intersectPacketBox(packet, nodes[0], activeMask, tEntry);
+        if (rootMask == 0) return 0;
+
+        BVHTraversalStack<Entry> stack;
+        stack.push({ 0, rootMask });
+        uint32_t hitMask = 0;
+
+        while (!stack.empty()) {
+            Entry entry = stack.pop();
+            FlatBVHNode const& node = nodes[entry.node];
+
+            // a single active ray gains nothing from the packet, finish its subtree without the mask bookkeeping
+            if ((entry.mask & (entry.mask - 1)) == 0) {
+                uint32_t i = 0;
+                while (!(entry.mask & (1U << i))) ++i;
+                glm::vec3 const origin(packet.originX[i], packet.originY[i], packet.originZ[i]);
+                glm::vec3 const dir(packet.dirX[i], packet.dirY[i], packet.dirZ[i]);
+                glm::vec3 const invDir(packet.invDirX[i], packet.invDirY[i], packet.invDirZ[i]);
+                bool const isHit = traverseSubtree<false>(bvh, origin, dir, invDir, packet.tMin[i], packet.t[i], entry.node,
+                    [&](BVHTriangle4 const& pack, uint32_t triangle, glm::vec2 const& barycentric) {
+                        setPacketHit(packet, i, pack, triangle, barycentric);
+                    });
+                if (isHit) hitMask |= entry.mask;
+                continue;
+            }
+
+            if (node.isLeaf()) {
+                for (uint32_t i = 0; i < N; ++i) {
+                    if (!(entry.mask & (1U << i))) continue;
+                    glm::vec3 const origin(packet.originX[i], packet.originY[i], packet.originZ[i]);
+                    glm::vec3 const dir(packet.dirX[i], packet.dirY[i], packet.dirZ[i]);
+                    for (uint32_t p = node.offset; p < node.offset + node.primCount; ++p) {
+                        uint32_t triangle;
+                        glm::vec2 barycentric;
+                        if (intersectTriangle4(origin, dir, bvh.packs[p], &packet.t[i], &barycentric, &triangle, packet.tMin[i])) {
+                            setPacketHit(packet, i, bvh.packs[p], triangle, barycentric);
+                            hitMask |= 1U << i;
+                        }
+                    }
+                }
+                continue;
+            }
+
+            uint32_t child1 = entry.node + 1;
+            uint32_t child2 = node.offset;
+            float t1, t2;
+            uint32_t mask1 = intersectPacketBox(packet, nodes[child1], entry.mask, t1);
+            uint32_t mask2 = intersectPacketBox(packet, nodes[child2], entry.mask, t2);
+
+            // the child entered first by any ray is visited first
+            if (t1 > t2) {
+                std::swap(child1, child2);
+                std::swap(mask1, mask2);
+            }
+            if (mask2) stack.push({ child2, mask2 });
+            if (mask1) stack.push({ child1, mask1 });
+        }
+        return hitMask;
+    }
+
+    template uint32_t intersectPacket<4>(TriangleBVH const&, RayPacket<4>&, uint32_t) noexcept;
+    template uint32_t intersectPacket<8>(TriangleBVH const&, RayPacket<8>&, uint32_t) noexcept;
+    template uint32_t intersectPacket<16>(TriangleBVH const&, RayPacket<16>&, uint32_t) noexcept;
+    template uint32_t intersectPacket<32>(TriangleBVH const&, RayPacket<32>&, uint32_t) noexcept;
+
+    // spread the lower 9 bits so that there are two zero bits between each
+    static inline uint32_t expandBits27(uint32_t v) noexcept {
+        v &= 0x1FFU;
+        v = (v * 0x00010001U) & 0xFF0000FFU;
+        v = (v * 0x00000101U) & 0x0F00F00FU;
+        v = (v * 0x00000011U) & 0xC30C30C3U;
+        v = (v * 0x00000005U) & 0x49249249U;
+        return v;
+    }
+
+    /*
+    *   27 bit Morton code of the normalized direction
+    */
+    static inline uint32_t getDirectionCode(glm::vec3 const& dir) noexcept {
+        float length = glm::length(dir);
+        glm::vec3 q = length > 0.0f ? (dir / length * 0.5f + 0.5f) * 511.0f : glm::vec3(0.0f);
+        q = glm::clamp(q, 0.0f, 511.0f);
+        return expandBits27(static_cast<uint32_t>(q.x)) << 2
+            | expandBits27(static_cast<uint32_t>(q.y)) << 1
+            | expandBits27(static_cast<uint32_t>(q.z));
+    }
+
+    void intersectStream(TriangleBVH const& bvh, std::vector<Ray> const& rays, std::vector<RayHit>& hits, RayStreamOption const& option) noexcept {
+        constexpr uint32_t packetSize = 8;
+        uint32_t const count = static_cast<uint32_t>(rays.size());
+        hits.assign(count, RayHit());
+
+        std::vector<uint32_t> order(count);
+        auto getOctant = [](glm::vec3 const& dir) {
+            return (dir.x < 0.0f ? 1U : 0U) | (dir.y < 0.0f ? 2U : 0U) | (dir.z < 0.0f ? 4U : 0U);
+        };
+        switch (option.sortMode) {
+        case RaySortMode::None:
+            for (uint32_t i = 0; i < count; ++i) {
+                order[i] = i;
+            }
+            break;
+        case RaySortMode::Octant: {
+            // counting sort, stable so coherent input stays coherent
+            uint32_t offsets[9] = {};
+            for (uint32_t i = 0; i < count; ++i) {
+                ++offsets[getOctant(rays[i].dir) + 1];
+            }
+            for (uint32_t o = 0; o < 8; ++o) {
+                offsets[o + 1] += offsets[o];
+            }
+            for (uint32_t i = 0; i < count; ++i) {
+                order[offsets[getOctant(rays[i].dir)]++] = i;
+            }
+            break;
+        }
+        case RaySortMode::Direction: {
+            std::vector<uint32_t> keys(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                order[i] = i;
+                keys[i] = getOctant(rays[i].dir) << 27 | getDirectionCode(rays[i].dir);
+            }
+            std::sort(order.begin(), order.end(), [&](uint32_t l, uint32_t r) {
+                return keys[l] < keys[r] || (keys[l] == keys[r] && l < r);
+            });
+            break;
+        }
+        }
+
+        auto traceRange = [&](uint32_t begin, uint32_t end) {
+            RayPacket<packetSize> packet;
+            for (uint32_t first = begin; first < end; first += packetSize) {
+                uint32_t n = std::min(packetSize, end - first);
+                for (uint32_t i = 0; i < n; ++i) {
+                    packet.setRay(i, rays[order[first + i]]);
+                }
+                for (uint32_t i = n; i < packetSize; ++i) {
+                    packet.clearRay(i);
+                }
+                intersectPacket(bvh, packet, (1U << n) - 1);
+                for (uint32_t i = 0; i < n; ++i) {
+                    hits[order[first + i]] = packet.getHit(i);
+                }
+            }
+        };
+
+        // keep chunks whole packets, so the split does not depend on the thread count
+        uint32_t chunkSize = std::max(option.chunkSize / packetSize, 1U) * packetSize;
+        if (option.parallel) {
+            ThreadPool::instance().parallelFor(0, count, chunkSize, traceRange);
+        }
+        else {
+            traceRange(0, count);
+        }
+    }
+
+    void occludedStream(TriangleBVH const& bvh, std::vector<Ray> const& rays, std::vector<uint8_t>& occluded, RayStreamOption const& option) noexcept {
+        uint32_t const count = static_cast<uint32_t>(rays.size());
+        occluded.assign(count, 0);
+        auto traceRange = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                occluded[i] = Utility::occluded(bvh, rays[i]) ? 1 : 0;
+            }
+        };
+        if (option.parallel) {
+            ThreadPool::instance().parallelFor(0, count, std::max(option.chunkSize, 1U), traceRange);
+        }
+        else {
+            traceRange(0, count);
+        }
+    }
+
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "SimpleGL/Utility/TriangleBVH.h"
+
+namespace SGL::Utility {
+
+    struct Ray {
+
+        glm::vec3 origin;
+        glm::vec3 dir;
+        /*
+        *   Only hits within (tMin, tMax) count, a small tMin keeps secondary rays off the surface they start on
+        */
+        float tMin = 0.0f;
+        float tMax = INFINITY;
+
+    };
+
+    struct RayHit {
+
+        float t = INFINITY;
+        /*
+        *   Weights of v1 and v2 of the hit triangle
+        */
+        glm::vec2 barycentric = glm::vec2(0.0f);
+        /*
+        *   Unit geometric normal following the triangle winding, zero when the primitive does not provide one
+        */
+        glm::vec3 normal = glm::vec3(0.0f);
+        /*
+        *   Triangle index for a TriangleBVH, index in bvh.prims for a BVH
+        */
+        uint32_t primitive = ~0U;
+
+        bool isHit() const noexcept { return primitive != ~0U; }
+
+    };
+
+    /*
+    *   N rays in SoA form traced together, N is a multiple of 4 so every group of 4 rays is one SSE register
+    */
+    template<uint32_t N>
+    struct alignas(16) RayPacket {
+
+        static_assert(N % 4 == 0 && N <= 32, "RayPacket holds 4, 8, 16 or 32 rays");
+
+        float originX[N], originY[N], originZ[N];
+        float dirX[N], dirY[N], dirZ[N];
+        float invDirX[N], invDirY[N], invDirZ[N];
+        float tMin[N];
+        /*
+        *   Closest hit so far, starts at the end of the ray interval
+        */
+        float t[N];
+        float u[N], v[N];
+        float normalX[N], normalY[N], normalZ[N];
+        uint32_t triangle[N];
+
+        void setRay(uint32_t i, Ray const& ray) noexcept {
+            originX[i] = ray.origin.x;
+            originY[i] = ray.origin.y;
+            originZ[i] = ray.origin.z;
+            dirX[i] = ray.dir.x;
+            dirY[i] = ray.dir.y;
+            dirZ[i] = ray.dir.z;
+            invDirX[i] = 1.0f / ray.dir.x;
+            invDirY[i] = 1.0f / ray.dir.y;
+            invDirZ[i] = 1.0f / ray.dir.z;
+            tMin[i] = ray.tMin;
+            t[i] = ray.tMax;
+            u[i] = v[i] = 0.0f;
+            normalX[i] = normalY[i] = normalZ[i] = 0.0f;
+            triangle[i] = ~0U;
+        }
+
+        /*
+        *   Idle lane of a partial packet, a zero ray whose box tests never hit
+        */
+        void clearRay(uint32_t i) noexcept {
+            originX[i] = originY[i] = originZ[i] = 0.0f;
+            dirX[i] = dirY[i] = dirZ[i] = 0.0f;
+            invDirX[i] = invDirY[i] = invDirZ[i] = 0.0f;
+            tMin[i] = t[i] = 0.0f;
+            u[i] = v[i] = 0.0f;
+            normalX[i] = normalY[i] = normalZ[i] = 0.0f;
+            triangle[i] = ~0U;
+        }
+
+        RayHit getHit(uint32_t i) const noexcept {
+            RayHit hit;
+            if (triangle[i] != ~0U) {
+                hit.t = t[i];
+                hit.barycentric = glm::vec2(u[i], v[i]);
+                hit.normal = glm::vec3(normalX[i], normalY[i], normalZ[i]);
+                hit.primitive = triangle[i];
+            }
+            return hit;
+        }
+
+    };
+
+    /*
+    *   Closest hit within the ray interval, hit is only written on a hit
+    */
+    bool intersect(TriangleBVH const& bvh, Ray const& ray, RayHit& hit) noexcept;
+
+    /*
+    *   Primitives only report a distance, so the normal is left zero
+    */
+    bool intersect(BVH const& bvh, Ray const& ray, RayHit& hit) noexcept;
+
+    /*
+    *   Any hit within the ray interval, traversal stops at the first one found
+    */
+    bool occluded(TriangleBVH const& bvh, Ray const& ray) noexcept;
+
+    bool occluded(BVH const& bvh, Ray const& ray) noexcept;
+
+    /*
+    *   Trace the rays of activeMask together, a node is visited while any of them hits its box
+    *   Returns the mask of rays that hit, their t, barycentrics and triangle are updated in the packet
+    */
+    template<uint32_t N>
+    uint32_t intersectPacket(TriangleBVH const& bvh, RayPacket<N>& packet, uint32_t activeMask = ~0U) noexcept;
+
+    enum struct RaySortMode {
+        None,
+        /*
+        *   Group rays by the signs of their direction, keeping their order within a group
+        */
+        Octant,
+        /*
+        *   Group by octant, then order by a Morton code of the direction, for incoherent input
+        */
+        Direction,
+    };
+
+    struct RayStreamOption {
+        /*
+        *   Reorder rays before packing, so packets stay coherent
+        */
+        RaySortMode sortMode = RaySortMode::Octant;
+        /*
+        *   Trace chunks of rays on ThreadPool::instance()
+        */
+        bool parallel = true;
+        uint32_t chunkSize = 1024;
+    };
+
+    /*
+    *   Trace an array of rays in 8 ray packets, hits[i] belongs to rays[i]
+    */
+    void intersectStream(TriangleBVH const& bvh, std::vector<Ray> const& rays, std::vector<RayHit>& hits, RayStreamOption const& option = RayStreamOption()) noexcept;
+
+    /*
+    *   Any hit query for an array of rays, occluded[i] is 1 if rays[i] is blocked
+    *       rays are traced one by one in chunks, sortMode is not used
+    */
+    void occludedStream(TriangleBVH const& bvh, std::vector<Ray> const& rays, std::vector<uint8_t>& occluded, RayStreamOption const& option = RayStreamOption()) noexcept;
+
+}
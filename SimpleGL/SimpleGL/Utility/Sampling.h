@@ -0,0 +1,50 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "glm/gtc/constants.hpp"
+
+namespace SGL::Utility {
+
+    // PCG hash, Jarzynski and Olano 2020
+    inline uint32_t hashPCG(uint32_t v) noexcept {
+        uint32_t state = v * 747796405U + 2891336453U;
+        uint32_t word = ((state >> ((state >> 28U) + 4U)) ^ state) * 277803737U;
+        return (word >> 22U) ^ word;
+    }
+
+    /*
+    *   Stateless generator seeded per sample, so results do not depend on which thread draws them
+    */
+    struct HashSampler {
+
+        uint32_t state;
+
+        float next() noexcept {
+            state = hashPCG(state);
+            return (state >> 8) * (1.0f / 16777216.0f);
+        }
+
+    };
+
+    // Duff et al. 2017, orthonormal basis without branches on the normal direction
+    inline glm::vec3 sampleCosineHemisphere(glm::vec3 const& n, float u1, float u2) noexcept {
+        float const sign = std::copysign(1.0f, n.z);
+        float const a = -1.0f / (sign + n.z);
+        float const b = n.x * n.y * a;
+        glm::vec3 const tangent(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+        glm::vec3 const bitangent(b, sign + n.y * n.y * a, -n.y);
+
+        float const r = std::sqrt(u1);
+        float const phi = 2.0f * glm::pi<float>() * u2;
+        return tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) + n * std::sqrt(std::max(0.0f, 1.0f - u1));
+    }
+
+    /*
+    *   Offset a surface point along its normal, scaled with the position so large scenes do not self intersect
+    */
+    inline glm::vec3 offsetRayOrigin(glm::vec3 const& point, glm::vec3 const& normal) noexcept {
+        float const scale = std::max(1.0f, std::max(std::max(std::abs(point.x), std::abs(point.y)), std::abs(point.z)));
+        return point + normal * (1e-4f * scale);
+    }
+
+}
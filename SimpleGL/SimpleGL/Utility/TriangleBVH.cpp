@@ -0,0 +1,158 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/TriangleBVH.h"
+#include "SimpleGL/Utility/BVHCache.h"
+#include "SimpleGL/Core/MappedFile.h"
+#include "SimpleGL/Core/Timer.h"
+
+namespace SGL::Utility {
+
+    void BVHTriangle4::setTriangle(uint32_t lane, glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c, uint32_t triangle) noexcept {
+        for (int axis = 0; axis < 3; ++axis) {
+            v0[axis][lane] = a[axis];
+            v1[axis][lane] = b[axis];
+            v2[axis][lane] = c[axis];
+            e1[axis][lane] = b[axis] - a[axis];
+            e2[axis][lane] = c[axis] - a[axis];
+        }
+        index[lane] = triangle;
+    }
+
+    glm::vec3 BVHTriangle4::getNormal(uint32_t triangle) const noexcept {
+        for (uint32_t lane = 0; lane < 4; ++lane) {
+            if (index[lane] != triangle) continue;
+            glm::vec3 const a(e1[0][lane], e1[1][lane], e1[2][lane]);
+            glm::vec3 const b(e2[0][lane], e2[1][lane], e2[2][lane]);
+            return glm::normalize(glm::cross(a, b));
+        }
+        return glm::vec3(0.0f);
+    }
+
+    WatertightRay::WatertightRay(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir) noexcept
+        : origin(rayOrigin)
+        , dir(rayDir) {
+        glm::vec3 absDir = glm::abs(rayDir);
+        kz = absDir.x > absDir.y ? (absDir.x > absDir.z ? 0 : 2) : (absDir.y > absDir.z ? 1 : 2);
+        kx = (kz + 1) % 3;
+        ky = (kx + 1) % 3;
+        // keep the winding of the triangle
+        if (rayDir[kz] < 0.0f) std::swap(kx, ky);
+        sx = rayDir[kx] / rayDir[kz];
+        sy = rayDir[ky] / rayDir[kz];
+        sz = 1.0f / rayDir[kz];
+    }
+
+    static bool loadCachedTriangleBVH(Filepath const& directory, uint64_t key, uint32_t triangleCount, TriangleBVH& bvh) noexcept {
+        BVHCacheHeader header;
+        auto file = openBVHCache(directory, key, BVHCacheKind::TriangleBVH, sizeof(FlatBVHNode), sizeof(BVHTriangle4), header);
+        if (!file || header.inputCount != triangleCount || header.nodeCount == 0) return false;
+
+        auto bytes = static_cast<uint8_t const*>(file->data);
+        // every child in range and referenced once, never the root, so traversal from the root stays a tree
+        auto nodes = reinterpret_cast<FlatBVHNode const*>(bytes + header.nodeOffset);
+        std::vector<uint8_t> referenced(header.nodeCount, 0);
+        referenced[0] = 1;
+        bool valid = true;
+        for (uint64_t i = 0; i < header.nodeCount && valid; ++i) {
+            FlatBVHNode const& node = nodes[i];
+            if (node.isLeaf()) {
+                valid = node.offset <= header.primCount && node.primCount <= header.primCount - node.offset;
+                continue;
+            }
+            for (uint64_t child : { i + 1, static_cast<uint64_t>(node.offset) }) {
+                valid = valid && child < header.nodeCount && !referenced[child];
+                if (valid) referenced[child] = 1;
+            }
+        }
+        if (!valid) {
+            SGL_LOG_WARN("Ignoring damaged BVH cache {0:x}", key);
+            return false;
+        }
+
+        bvh.nodes.assign(file, nodes, header.nodeCount);
+        bvh.packs.assign(file, reinterpret_cast<BVHTriangle4 const*>(bytes + header.primOffset), header.primCount);
+        bvh.stats.sahCost = header.sahCost;
+        bvh.stats.nodeCount = static_cast<uint32_t>(header.nodeCount);
+        bvh.stats.leafCount = header.leafCount;
+        bvh.stats.maxDepth = header.maxDepth;
+        return true;
+    }
+
+    std::unique_ptr<TriangleBVH> TriangleBVH::build(std::vector<glm::vec3> const& vertices, BVHBuildOption const& option) noexcept {
+        Timer timer;
+        auto bvh = std::make_unique<TriangleBVH>();
+        uint32_t const triangleCount = static_cast<uint32_t>(vertices.size() / 3);
+
+        bool const useCache = !option.cacheDirectory.empty() && triangleCount > 0;
+        uint64_t const cacheKey = useCache ? getBVHCacheKey(BVHCacheKind::TriangleBVH, vertices.data(), triangleCount * 3 * sizeof(glm::vec3), option) : 0;
+        if (useCache && loadCachedTriangleBVH(option.cacheDirectory, cacheKey, triangleCount, *bvh)) {
+            timer.update();
+            bvh->stats.buildTime = timer.getDeltaTime();
+            return bvh;
+        }
+
+        std::vector<BoundingBoxAABB> bounds(triangleCount);
+        for (uint32_t i = 0; i < triangleCount; ++i) {
+            bounds[i].append(vertices[i * 3 + 0]);
+            bounds[i].append(vertices[i * 3 + 1]);
+            bounds[i].append(vertices[i * 3 + 2]);
+        }
+
+        std::vector<BVHNode> binary;
+        std::vector<uint32_t> order;
+        buildBVHNodes(bounds, option, binary, order);
+
+        std::vector<FlatBVHNode> nodes;
+        std::vector<uint32_t> flatOrder;
+        flattenBVHNodes(binary, nodes, flatOrder);
+
+        // leaves are visited in flat order, so their primitive ranges follow each other
+        std::vector<BVHTriangle4> packs;
+        packs.reserve((triangleCount + 3) / 4 + nodes.size() / 2);
+        for (auto& node : nodes) {
+            if (!node.isLeaf()) continue;
+            uint32_t first = node.offset;
+            uint32_t count = node.primCount;
+            node.offset = static_cast<uint32_t>(packs.size());
+            node.primCount = (count + 3) / 4;
+
+            for (uint32_t i = 0; i < node.primCount; ++i) {
+                BVHTriangle4 pack;
+                for (uint32_t lane = 0; lane < 4; ++lane) {
+                    uint32_t j = i * 4 + lane;
+                    if (j < count) {
+                        uint32_t triangle = order[flatOrder[first + j]];
+                        pack.setTriangle(lane, vertices[triangle * 3 + 0], vertices[triangle * 3 + 1], vertices[triangle * 3 + 2], triangle);
+                    }
+                    else {
+                        pack.setTriangle(lane, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), ~0U);
+                    }
+                }
+                packs.push_back(pack);
+            }
+        }
+        bvh->nodes.assign(std::move(nodes));
+        bvh->packs.assign(std::move(packs));
+
+        timer.update();
+        bvh->stats = computeBVHStats(binary, option);
+        bvh->stats.buildTime = timer.getDeltaTime();
+
+        if (useCache) {
+            BVHCacheHeader header;
+            header.kind = BVHCacheKind::TriangleBVH;
+            header.key = cacheKey;
+            header.inputCount = triangleCount;
+            header.nodeSize = sizeof(FlatBVHNode);
+            header.nodeCount = bvh->nodes.size();
+            header.primSize = sizeof(BVHTriangle4);
+            header.primCount = bvh->packs.size();
+            header.sahCost = bvh->stats.sahCost;
+            header.leafCount = bvh->stats.leafCount;
+            header.maxDepth = bvh->stats.maxDepth;
+            saveBVHCache(option.cacheDirectory, header, bvh->nodes.data(), bvh->packs.data());
+        }
+        return bvh;
+    }
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "SimpleGL/Utility/BVH.h"
+
+namespace SGL::Utility {
+
+    /*
+    *   Four triangles in SoA form, [axis][lane], edges are precomputed for Moller Trumbore,
+    *   vertices are kept for the watertight test, which needs them exact to close shared edges
+    *   Unused lanes hold a degenerate triangle and never hit
+    */
+    struct alignas(64) BVHTriangle4 {
+
+        float v0[3][4];
+        float e1[3][4];
+        float e2[3][4];
+        float v1[3][4];
+        float v2[3][4];
+        /*
+        *   Index of the triangle in the build input, ~0 for unused lanes
+        */
+        uint32_t index[4];
+
+        void setTriangle(uint32_t lane, glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c, uint32_t triangle) noexcept;
+
+        /*
+        *   Unit geometric normal of the lane holding triangle, following its winding
+        */
+        glm::vec3 getNormal(uint32_t triangle) const noexcept;
+
+        void getVertices(uint32_t lane, glm::vec3& a, glm::vec3& b, glm::vec3& c) const noexcept {
+            a = glm::vec3(v0[0][lane], v0[1][lane], v0[2][lane]);
+            b = glm::vec3(v1[0][lane], v1[1][lane], v1[2][lane]);
+            c = glm::vec3(v2[0][lane], v2[1][lane], v2[2][lane]);
+        }
+
+    };
+
+    static_assert(sizeof(BVHTriangle4) == 256, "BVHTriangle4 should span four cache lines");
+
+    /*
+    *   Ray prepared for the watertight test (Woop et al. 2013), the axis with the largest direction becomes z
+    *   and the other two are sheared so the ray points along it
+    */
+    struct WatertightRay {
+
+        glm::vec3 origin;
+        glm::vec3 dir;
+        int kx, ky, kz;
+        float sx, sy, sz;
+
+        WatertightRay(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir) noexcept;
+
+    };
+
+    /*
+    *   Flat BVH whose leaves index packs of 4 triangles, primCount of a leaf counts packs
+    *   Both arrays are used in place when loaded from a cache file, see BVHBuildOption::cacheDirectory
+    */
+    struct TriangleBVH {
+
+        BVHArray<FlatBVHNode> nodes;
+        BVHArray<BVHTriangle4> packs;
+
+        BVHBuildStats stats;
+
+        TriangleBVH() = default;
+        ~TriangleBVH() = default;
+
+        TriangleBVH(TriangleBVH const&) = delete;
+        TriangleBVH(TriangleBVH&& other) = delete;
+
+        TriangleBVH& operator=(TriangleBVH const&) = delete;
+        TriangleBVH& operator=(TriangleBVH&& other) = delete;
+
+        /*
+        *   A pack is tested at about the cost of one triangle, so leaves hold at least 4 triangles and intersection is cheaper
+        */
+        static BVHBuildOption getDefaultBuildOption() noexcept {
+            BVHBuildOption option;
+            option.minLeafSize = 4;
+            option.maxLeafSize = 16;
+            option.intersectCost = 0.5f;
+            return option;
+        }
+
+        /*
+        *   Triangles are given as vertex triples, the index stored in the packs is the triangle number
+        */
+        static std::unique_ptr<TriangleBVH> build(std::vector<glm::vec3> const& vertices, BVHBuildOption const& option = getDefaultBuildOption()) noexcept;
+
+    };
+
+}
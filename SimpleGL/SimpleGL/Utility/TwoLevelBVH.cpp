@@ -0,0 +1,66 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/TwoLevelBVH.h"
+#include "SimpleGL/Utility/Intersect.h"
+
+namespace SGL::Utility {
+
+    BVHInstance::BVHInstance(BVH const* blas, glm::mat4 const& transform) noexcept
+        : blas(blas) {
+        setTransform(transform);
+    }
+
+    void BVHInstance::setTransform(glm::mat4 const& t) noexcept {
+        transform = t;
+        invTransform = glm::inverse(t);
+    }
+
+    BoundingBoxAABB BVHInstance::getBound() const noexcept {
+        BoundingBoxAABB bound;
+        if (!blas || blas->nodes.empty()) return bound;
+
+        auto const& local = blas->nodes[0].bound;
+        for (int i = 0; i < 8; ++i) {
+            glm::vec3 corner(
+                (i & 1) ? local.max.x : local.min.x,
+                (i & 2) ? local.max.y : local.min.y,
+                (i & 4) ? local.max.z : local.min.z);
+            bound.append(glm::vec3(transform * glm::vec4(corner, 1.0f)));
+        }
+        return bound;
+    }
+
+    bool BVHInstance::intersect(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, float* t) const noexcept {
+        if (!blas) return false;
+        glm::vec3 localOrigin = glm::vec3(invTransform * glm::vec4(rayOrigin, 1.0f));
+        glm::vec3 localDir = glm::vec3(invTransform * glm::vec4(rayDir, 0.0f));
+        return intersectBVH(localOrigin, localDir, *blas, t);
+    }
+
+    uint32_t TwoLevelBVH::addInstance(BVH const* blas, glm::mat4 const& transform) noexcept {
+        instances.emplace_back(blas, transform);
+        return static_cast<uint32_t>(instances.size() - 1);
+    }
+
+    void TwoLevelBVH::setTransform(uint32_t instance, glm::mat4 const& transform) noexcept {
+        instances[instance].setTransform(transform);
+    }
+
+    void TwoLevelBVH::build(BVHBuildOption const& option) noexcept {
+        std::vector<BVHPrimitive*> prims(instances.size());
+        for (size_t i = 0; i < instances.size(); ++i) {
+            prims[i] = &instances[i];
+        }
+        top = BVH::build(prims, option);
+    }
+
+    void TwoLevelBVH::refit(BVHRefitOption const& refitOption) noexcept {
+        // instances added since the last build are not in the top level yet
+        if (!top || top->prims.size() != instances.size()) {
+            build(top ? top->option : BVHBuildOption());
+            return;
+        }
+        top->refit(refitOption);
+    }
+
+}
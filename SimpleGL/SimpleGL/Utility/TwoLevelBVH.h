@@ -0,0 +1,69 @@
+#pragma once
+
+#include "SimpleGL/Utility/BVH.h"
+
+namespace SGL::Utility {
+
+    /*
+    *   Placement of a bottom level BVH in world space, the BVH is not owned and can be shared by any number of instances
+    */
+    struct BVHInstance : BVHPrimitive {
+
+        BVH const* blas = nullptr;
+        glm::mat4 transform = glm::mat4(1.0f);
+        glm::mat4 invTransform = glm::mat4(1.0f);
+
+        BVHInstance(BVH const* blas, glm::mat4 const& transform) noexcept;
+
+        void setTransform(glm::mat4 const& transform) noexcept;
+
+        /*
+        *   World space bound of the transformed root box of the bottom level BVH
+        */
+        BoundingBoxAABB getBound() const noexcept override;
+
+        /*
+        *   The ray direction is not normalized after the transform, so t is the same in object and world space
+        */
+        bool intersect(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, float* t = nullptr) const noexcept override;
+
+    };
+
+    /*
+    *   Top level BVH over instances of bottom level BVHs, e.g. one per unique mesh placed by Model::transform
+    *   Moving an instance only needs the top level to be refit or rebuilt
+    */
+    struct TwoLevelBVH {
+
+        std::vector<BVHInstance> instances;
+        std::unique_ptr<BVH> top;
+
+        TwoLevelBVH() = default;
+        ~TwoLevelBVH() = default;
+
+        TwoLevelBVH(TwoLevelBVH const&) = delete;
+        TwoLevelBVH(TwoLevelBVH&& other) = delete;
+
+        TwoLevelBVH& operator=(TwoLevelBVH const&) = delete;
+        TwoLevelBVH& operator=(TwoLevelBVH&& other) = delete;
+
+        /*
+        *   Returns the instance index, the top level has to be built again before the next query
+        */
+        uint32_t addInstance(BVH const* blas, glm::mat4 const& transform = glm::mat4(1.0f)) noexcept;
+
+        /*
+        *   Only updates the instance, call refit or build afterwards
+        */
+        void setTransform(uint32_t instance, glm::mat4 const& transform) noexcept;
+
+        void build(BVHBuildOption const& option = BVHBuildOption()) noexcept;
+
+        /*
+        *   Refit the top level after transforms changed, degraded parts of it are rebuilt as in BVH::refit
+        */
+        void refit(BVHRefitOption const& refitOption = BVHRefitOption()) noexcept;
+
+    };
+
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "SimpleGL/Utility/Intersect.h"
+#include "SimpleGL/Core/Timer.h"
+#include "SimpleGL/Core/ThreadPool.h"
+
+namespace SGL::Utility {
+
+    /*
+    *   Primitives for TypedBVH, any type with the same non virtual getBound and intersect as BVHPrimitive works
+    */
+    struct BVHTriangle {
+
+        glm::vec3 v0, v1, v2;
+
+        BoundingBoxAABB getBound() const noexcept {
+            BoundingBoxAABB bound;
+            bound.append(v0);
+            bound.append(v1);
+            bound.append(v2);
+            return bound;
+        }
+
+        bool intersect(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, float* t = nullptr) const noexcept {
+            return intersectTriangle(rayOrigin, rayDir, v0, v1, v2, t);
+        }
+
+    };
+
+    struct BVHSphere {
+
+        glm::vec3 center;
+        float radius;
+
+        BoundingBoxAABB getBound() const noexcept {
+            BoundingBoxAABB bound;
+            bound.append(center - radius);
+            bound.append(center + radius);
+            return bound;
+        }
+
+        bool intersect(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, float* t = nullptr) const noexcept {
+            return intersectSphere(rayOrigin, rayDir, center, radius, t);
+        }
+
+    };
+
+    struct BVHBox {
+
+        BoundingBoxAABB bound;
+
+        BoundingBoxAABB getBound() const noexcept {
+            return bound;
+        }
+
+        /*
+        *   Solid box, a ray starting inside hits at distance 0
+        */
+        bool intersect(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, float* t = nullptr) const noexcept {
+            float tt = INFINITY;
+            if (!intersectAABB(rayOrigin, rayDir, bound, &tt)) return false;
+            tt = std::max(tt, 0.0f);
+            if (t) {
+                if (tt < *t) {
+                    *t = tt;
+                    return true;
+                }
+                return false;
+            }
+            return true;
+        }
+
+    };
+
+    /*
+    *   Line segment picked within radius, e.g. for debug lines or hair strands
+    */
+    struct BVHSegment {
+
+        glm::vec3 p0, p1;
+        float radius;
+
+        BoundingBoxAABB getBound() const noexcept {
+            BoundingBoxAABB bound;
+            bound.append(glm::min(p0, p1) - radius);
+            bound.append(glm::max(p0, p1) + radius);
+            return bound;
+        }
+
+        bool intersect(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, float* t = nullptr) const noexcept {
+            return intersectCapsule(rayOrigin, rayDir, p0, p1, radius, t);
+        }
+
+    };
+
+    /*
+    *   Adapter for storing existing BVHPrimitive objects in a TypedBVH
+    */
+    struct BVHPrimitiveRef {
+
+        BVHPrimitive const* prim;
+
+        BoundingBoxAABB getBound() const noexcept {
+            return prim->getBound();
+        }
+
+        bool intersect(glm::vec3 const& rayOrigin, glm::vec3 const& rayDir, float* t = nullptr) const noexcept {
+            return prim->intersect(rayOrigin, rayDir, t);
+        }
+
+    };
+
+    /*
+    *   Flat BVH storing primitives by value in leaf order, bound and intersection calls are resolved at compile time
+    */
+    template<typename Prim>
+    struct TypedBVH {
+
+        std::vector<FlatBVHNode> nodes;
+        std::vector<Prim> prims;
+        /*
+        *   Index of each primitive in the array passed to build
+        */
+        std::vector<uint32_t> primIndices;
+
+        BVHBuildStats stats;
+
+        TypedBVH() = default;
+        ~TypedBVH() = default;
+
+        TypedBVH(TypedBVH const&) = delete;
+        TypedBVH(TypedBVH&& other) = delete;
+
+        TypedBVH& operator=(TypedBVH const&) = delete;
+        TypedBVH& operator=(TypedBVH&& other) = delete;
+
+        static std::unique_ptr<TypedBVH> build(std::vector<Prim> const& input, BVHBuildOption const& option = BVHBuildOption()) noexcept {
+            Timer timer;
+            auto bvh = std::make_unique<TypedBVH>();
+            uint32_t const primCount = static_cast<uint32_t>(input.size());
+
+            std::vector<BoundingBoxAABB> bounds(primCount);
+            auto computeBounds = [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) {
+                    bounds[i] = input[i].getBound();
+                }
+            };
+            if (option.parallel) {
+                ThreadPool::instance().parallelFor(0, primCount, 1 << 14, computeBounds);
+            }
+            else {
+                computeBounds(0, primCount);
+            }
+
+            std::vector<BVHNode> binary;
+            std::vector<uint32_t> order;
+            buildBVHNodes(bounds, option, binary, order);
+
+            std::vector<uint32_t> flatOrder;
+            flattenBVHNodes(binary, bvh->nodes, flatOrder);
+            bvh->primIndices.resize(flatOrder.size());
+            bvh->prims.reserve(flatOrder.size());
+            for (size_t i = 0; i < flatOrder.size(); ++i) {
+                bvh->primIndices[i] = order[flatOrder[i]];
+                bvh->prims.push_back(input[bvh->primIndices[i]]);
+            }
+
+            timer.update();
+            bvh->stats = computeBVHStats(binary, option);
+            bvh->stats.buildTime = timer.getDeltaTime();
+            return bvh;
+        }
+
+    };
+
+    /*
+    *   if primIndex is provided, the build input index of the closest primitive hit will be stored in it
+    */
+    template<typename Prim>
+    bool intersectBVH(
+        glm::vec3 const& rayOrigin,
+        glm::vec3 const& rayDir,
+        TypedBVH<Prim> const& bvh,
+        float* t = nullptr,
+        uint32_t* primIndex = nullptr) noexcept {
+        if (bvh.nodes.empty()) return false;
+        glm::vec3 const invDir = 1.0f / rayDir;
+        FlatBVHNode const* nodes = bvh.nodes.data();
+        Prim const* prims = bvh.prims.data();
+        BVHTraversalStack<uint32_t> stack;
+        uint32_t nodeIdx = 0;
+        uint32_t hitPrim = 0;
+        bool hit = false;
+        float tt = t ? *t : INFINITY;
+        while (1) {
+            FlatBVHNode const& node = nodes[nodeIdx];
+            if (node.isLeaf()) {
+                for (uint32_t i = node.offset; i < node.offset + node.primCount; ++i) {
+                    if (prims[i].intersect(rayOrigin, rayDir, &tt)) {
+                        hit = true;
+                        hitPrim = i;
+                    }
+                }
+                if (stack.empty()) break;
+                nodeIdx = stack.pop();
+                continue;
+            }
+
+            uint32_t child1 = nodeIdx + 1;
+            uint32_t child2 = node.offset;
+            float t1 = intersectSlab(rayOrigin, invDir, nodes[child1].min, nodes[child1].max, tt);
+            float t2 = intersectSlab(rayOrigin, invDir, nodes[child2].min, nodes[child2].max, tt);
+
+            if (t1 > t2) {
+                std::swap(t1, t2);
+                std::swap(child1, child2);
+            }
+
+            if (t1 == INFINITY) {
+                if (stack.empty()) break;
+                nodeIdx = stack.pop();
+            }
+            else {
+                nodeIdx = child1;
+                if (t2 != INFINITY) {
+                    stack.push(child2);
+                }
+            }
+        }
+        if (hit) {
+            if (t) *t = tt;
+            if (primIndex) *primIndex = bvh.primIndices[hitPrim];
+        }
+        return hit;
+    }
+
+}
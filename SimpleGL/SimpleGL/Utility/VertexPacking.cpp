@@ -0,0 +1,98 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/VertexPacking.h"
+#include "SimpleGL/Core/Shader.h"
+#include "glm/gtc/packing.hpp"
+
+namespace SGL::Utility {
+
+    static char const* const vertexPackingSource = R"GLSL(
+#ifndef SGL_VERTEX_PACKING_GLSL
+#define SGL_VERTEX_PACKING_GLSL
+
+vec3 sglDecodeOctahedral(vec2 e) {
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+    return normalize(v);
+}
+
+// aNormal of a packed vertex
+vec3 sglUnpackNormal(vec2 normal) {
+    return sglDecodeOctahedral(normal);
+}
+
+// aTangent of a packed vertex, xyz is the tangent and w the sign of the bitangent
+vec4 sglUnpackTangent(vec4 tangent) {
+    return vec4(sglDecodeOctahedral(tangent.xy), tangent.w < 0.0 ? -1.0 : 1.0);
+}
+
+vec3 sglGetBitangent(vec3 normal, vec4 tangent) {
+    return cross(normal, tangent.xyz) * tangent.w;
+}
+
+#endif
+)GLSL";
+
+    void addVertexPackingShaderInclude() noexcept {
+        static bool const added = (Shader::addInclude(VertexPackingShaderInclude, vertexPackingSource), true);
+        (void)added;
+    }
+
+    char const* getVertexPackingShaderSource() noexcept {
+        return vertexPackingSource;
+    }
+
+    glm::vec2 encodeOctahedral(glm::vec3 const& v) noexcept {
+        float const l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        if (l1 <= 0.0f) return glm::vec2(0.0f);
+        glm::vec2 p = glm::vec2(v.x, v.y) / l1;
+        if (v.z < 0.0f) {
+            glm::vec2 const folded = 1.0f - glm::abs(glm::vec2(p.y, p.x));
+            p.x = p.x >= 0.0f ? folded.x : -folded.x;
+            p.y = p.y >= 0.0f ? folded.y : -folded.y;
+        }
+        return p;
+    }
+
+    glm::vec3 decodeOctahedral(glm::vec2 const& e) noexcept {
+        glm::vec3 v(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+        float const t = std::max(-v.z, 0.0f);
+        v.x += v.x >= 0.0f ? -t : t;
+        v.y += v.y >= 0.0f ? -t : t;
+        return glm::normalize(v);
+    }
+
+    uint32_t packNormal(glm::vec3 const& normal) noexcept {
+        return glm::packSnorm2x16(encodeOctahedral(normal));
+    }
+
+    glm::vec3 unpackNormal(uint32_t packed) noexcept {
+        return decodeOctahedral(glm::unpackSnorm2x16(packed));
+    }
+
+    uint32_t packTangent(glm::vec3 const& normal, glm::vec3 const& tangent, glm::vec3 const& bitangent) noexcept {
+        float const sign = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+        return glm::packSnorm3x10_1x2(glm::vec4(encodeOctahedral(tangent), 0.0f, sign));
+    }
+
+    glm::vec4 unpackTangent(uint32_t packed) noexcept {
+        glm::vec4 const v = glm::unpackSnorm3x10_1x2(packed);
+        return glm::vec4(decodeOctahedral(glm::vec2(v.x, v.y)), v.w < 0.0f ? -1.0f : 1.0f);
+    }
+
+    DataType getTexcoordType(glm::vec2 const& min, glm::vec2 const& max) noexcept {
+        bool const unit = min.x >= 0.0f && min.y >= 0.0f && max.x <= 1.0f && max.y <= 1.0f;
+        return unit ? DataType::UShort2N : DataType::Half2;
+    }
+
+    uint32_t packTexcoord(glm::vec2 const& texcoord, DataType type) noexcept {
+        return type == DataType::UShort2N ? glm::packUnorm2x16(texcoord) : glm::packHalf2x16(texcoord);
+    }
+
+    glm::vec2 unpackTexcoord(uint32_t packed, DataType type) noexcept {
+        return type == DataType::UShort2N ? glm::unpackUnorm2x16(packed) : glm::unpackHalf2x16(packed);
+    }
+
+}
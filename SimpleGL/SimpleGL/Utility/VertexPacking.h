@@ -0,0 +1,43 @@
+#pragma once
+
+#include "SimpleGL/Core/Types.h"
+#include "glm/glm.hpp"
+
+namespace SGL::Utility {
+
+    /*
+    *   Shader include with the GLSL side of the functions below, registered by addVertexPackingShaderInclude
+    */
+    static constexpr char const* VertexPackingShaderInclude = "SimpleGL/VertexPacking.glsl";
+
+    void addVertexPackingShaderInclude() noexcept;
+    char const* getVertexPackingShaderSource() noexcept;
+
+    /*
+    *   Octahedral map of a direction to [-1, 1]^2, Cigolle et al. 2014, the lower hemisphere is folded over the diagonals
+    *   The zero vector maps to the center and comes back as +z
+    */
+    glm::vec2 encodeOctahedral(glm::vec3 const& v) noexcept;
+    glm::vec3 decodeOctahedral(glm::vec2 const& e) noexcept;
+
+    /*
+    *   Short2N octahedral normal
+    */
+    uint32_t packNormal(glm::vec3 const& normal) noexcept;
+    glm::vec3 unpackNormal(uint32_t packed) noexcept;
+
+    /*
+    *   Int2101010N, octahedral tangent in x and y, w is 1 if bitangent is on the side of cross(normal, tangent) and -1 otherwise
+    *   The shader rebuilds the bitangent as cross(normal, tangent) * w
+    */
+    uint32_t packTangent(glm::vec3 const& normal, glm::vec3 const& tangent, glm::vec3 const& bitangent) noexcept;
+    glm::vec4 unpackTangent(uint32_t packed) noexcept;
+
+    /*
+    *   UShort2N keeps 16 bits over [0, 1], Half2 covers tiled texcoords with less precision away from 0, both reach the shader as vec2
+    */
+    DataType getTexcoordType(glm::vec2 const& min, glm::vec2 const& max) noexcept;
+    uint32_t packTexcoord(glm::vec2 const& texcoord, DataType type) noexcept;
+    glm::vec2 unpackTexcoord(uint32_t packed, DataType type) noexcept;
+
+}
@@ -0,0 +1,86 @@
+#include "PCH.h"
+
+#include "SimpleGL/Utility/WideBVH.h"
+
+namespace SGL::Utility {
+
+    void BVH4Node::setChild(uint32_t slot, BoundingBoxAABB const& bound, uint32_t index, uint32_t count) noexcept {
+        minX[slot] = bound.min.x;
+        minY[slot] = bound.min.y;
+        minZ[slot] = bound.min.z;
+        maxX[slot] = bound.max.x;
+        maxY[slot] = bound.max.y;
+        maxZ[slot] = bound.max.z;
+        child[slot] = index;
+        primCount[slot] = count;
+    }
+
+    static uint32_t collapseNode(BVH const& bvh, uint32_t nodeIdx, BVH4& wide) noexcept {
+        uint32_t wideIdx = static_cast<uint32_t>(wide.nodes.size());
+        wide.nodes.emplace_back();
+
+        BVH4Node node;
+        for (uint32_t i = 0; i < 4; ++i) {
+            node.setChild(i, BoundingBoxAABB(), 0, 0);
+        }
+
+        uint32_t children[4];
+        uint32_t childCount = 0;
+        auto const& binary = bvh.nodes[nodeIdx];
+        if (binary.isLeaf()) {
+            children[childCount++] = nodeIdx;
+        }
+        else {
+            children[childCount++] = binary.left;
+            children[childCount++] = binary.right;
+        }
+
+        // pull grandchildren up, largest surface area first
+        while (childCount < 4) {
+            int best = -1;
+            float bestArea = -1.0f;
+            for (uint32_t i = 0; i < childCount; ++i) {
+                auto const& child = bvh.nodes[children[i]];
+                if (child.isLeaf()) continue;
+                float area = child.bound.getArea();
+                if (area > bestArea) {
+                    best = static_cast<int>(i);
+                    bestArea = area;
+                }
+            }
+            if (best < 0) break;
+
+            auto const& opened = bvh.nodes[children[best]];
+            for (uint32_t i = childCount; i > static_cast<uint32_t>(best) + 1; --i) {
+                children[i] = children[i - 1];
+            }
+            children[best] = opened.left;
+            children[best + 1] = opened.right;
+            ++childCount;
+        }
+
+        for (uint32_t i = 0; i < childCount; ++i) {
+            auto const& child = bvh.nodes[children[i]];
+            if (child.isLeaf()) {
+                node.setChild(i, child.bound, child.firstPrim, child.primCount);
+            }
+            else {
+                node.setChild(i, child.bound, collapseNode(bvh, children[i], wide), 0);
+            }
+        }
+
+        wide.nodes[wideIdx] = node;
+        return wideIdx;
+    }
+
+    std::unique_ptr<BVH4> BVH4::collapse(BVH const& bvh) noexcept {
+        auto wide = std::make_unique<BVH4>();
+        if (bvh.nodes.empty()) return wide;
+
+        wide->prims = bvh.prims;
+        wide->nodes.reserve(bvh.nodes.size() / 2 + 1);
+        collapseNode(bvh, 0, *wide);
+        return wide;
+    }
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "SimpleGL/Utility/BVH.h"
+
+namespace SGL::Utility {
+
+    /*
+    *   Four children per node with bounds stored as SoA, so one SSE sequence tests all of them
+    *   Unused slots hold an inverted box and never hit
+    */
+    struct alignas(64) BVH4Node {
+
+        float minX[4], minY[4], minZ[4];
+        float maxX[4], maxY[4], maxZ[4];
+        /*
+        *   Index of the child node, or the first primitive if the child is a leaf
+        */
+        uint32_t child[4];
+        /*
+        *   Primitive count of leaf children, 0 for interior children
+        */
+        uint32_t primCount[4];
+
+        void setChild(uint32_t slot, BoundingBoxAABB const& bound, uint32_t index, uint32_t count) noexcept;
+
+    };
+
+    static_assert(sizeof(BVH4Node) == 128, "BVH4Node should span two cache lines");
+
+    struct BVH4 {
+
+        std::vector<BVH4Node> nodes;
+        std::vector<BVHPrimitive*> prims;
+
+        BVH4() = default;
+        ~BVH4() = default;
+
+        BVH4(BVH4 const&) = delete;
+        BVH4(BVH4&& other) = delete;
+
+        BVH4& operator=(BVH4 const&) = delete;
+        BVH4& operator=(BVH4&& other) = delete;
+
+        /*
+        *   Collapse a binary BVH by repeatedly opening the largest interior child until a node has 4 children
+        */
+        static std::unique_ptr<BVH4> collapse(BVH const& bvh) noexcept;
+
+    };
+
+}